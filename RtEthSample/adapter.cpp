@@ -11,11 +11,14 @@
 
 #include "precomp.h"
 
+#include <stdlib.h>
+
 #include <preview/netadapteroffload.h>
 #include <preview/netadaptercx.h>
 
 #include "trace.h"
 #include "device.h"
+#include "statistics.h"
 #include "adapter.h"
 #include "txqueue.h"
 #include "rxqueue.h"
@@ -75,6 +78,12 @@ Return Value:
     GOTO_IF_NOT_NT_SUCCESS(Exit, status,
         WdfSpinLockCreate(&attributes, &adapter->Lock));
 
+    GOTO_IF_NOT_NT_SUCCESS(Exit, status,
+        RtAdapterInitializeTally(adapter));
+
+    GOTO_IF_NOT_NT_SUCCESS(Exit, status,
+        GigaMacInitialize(adapter));
+
 Exit:
     TraceExitResult(status);
 
@@ -107,6 +116,53 @@ RtAdapterUpdateHardwareChecksum(
     }
 
     adapter->CSRAddress->CPCR = cpcr;
+
+    RtAdapterUpdateRxChecksumTable(adapter);
+}
+
+void
+RtAdapterUpdateHardwareVlan(
+    _In_ RT_ADAPTER *adapter
+    )
+{
+    // The hardware strips any 802.1Q tag it receives and reports it in the
+    // receive descriptor; insertion is requested per transmit descriptor.
+    if (adapter->PriorityVlanTag != RtPriorityVlanTagDisabled)
+    {
+        adapter->CSRAddress->CPCR |= CPCR_RX_VLAN;
+    }
+    else
+    {
+        adapter->CSRAddress->CPCR &= ~CPCR_RX_VLAN;
+    }
+}
+
+void
+RtAdapterUpdateJumboFrames(
+    _In_ RT_ADAPTER *adapter
+    )
+{
+    // Frames above the standard size are dropped unless the chip's jumbo
+    // enables are set; where they live differs between chip generations.
+    UCHAR const config4Enable = adapter->ChipType == RTL8168E
+        ? CONFIG4_Jumbo_En1_8168E
+        : CONFIG4_Jumbo_En1;
+
+    // enable cr9346 before writing config registers
+    RtAdapterEnableCR9346Write(adapter); {
+
+        if (adapter->JumboPacket > RT_MAX_PACKET_SIZE)
+        {
+            adapter->CSRAddress->CONFIG3 |= CONFIG3_Jumbo_En0;
+            adapter->CSRAddress->CONFIG4 |= config4Enable;
+        }
+        else
+        {
+            adapter->CSRAddress->CONFIG3 &= ~CONFIG3_Jumbo_En0;
+            adapter->CSRAddress->CONFIG4 &= ~config4Enable;
+        }
+
+    } RtAdapterDisableCR9346Write(adapter);
 }
 
 void
@@ -114,9 +170,6 @@ RtAdapterQueryHardwareCapabilities(
     _Out_ NDIS_OFFLOAD *hardwareCaps
     )
 {
-    // TODO: when vlan is implemented, each of TCP_OFFLOAD's encapsulation
-    // type has to be updated to include NDIS_ENCAPSULATION_IEEE_802_3_P_AND_Q_IN_OOB
-
     RtlZeroMemory(hardwareCaps, sizeof(*hardwareCaps));
 
     hardwareCaps->Header.Type = NDIS_OBJECT_TYPE_OFFLOAD;
@@ -124,14 +177,14 @@ RtAdapterQueryHardwareCapabilities(
     hardwareCaps->Header.Revision = NDIS_OFFLOAD_REVISION_5;
 
     // IPv4 checksum offloads supported
-    hardwareCaps->Checksum.IPv4Transmit.Encapsulation = NDIS_ENCAPSULATION_IEEE_802_3;
+    hardwareCaps->Checksum.IPv4Transmit.Encapsulation = NDIS_ENCAPSULATION_IEEE_802_3 | NDIS_ENCAPSULATION_IEEE_802_3_P_AND_Q_IN_OOB;
     hardwareCaps->Checksum.IPv4Transmit.IpChecksum = NDIS_OFFLOAD_SUPPORTED;
     hardwareCaps->Checksum.IPv4Transmit.IpOptionsSupported = NDIS_OFFLOAD_SUPPORTED;
     hardwareCaps->Checksum.IPv4Transmit.TcpChecksum = NDIS_OFFLOAD_SUPPORTED;
     hardwareCaps->Checksum.IPv4Transmit.TcpOptionsSupported = NDIS_OFFLOAD_SUPPORTED;
     hardwareCaps->Checksum.IPv4Transmit.UdpChecksum = NDIS_OFFLOAD_SUPPORTED;
 
-    hardwareCaps->Checksum.IPv4Receive.Encapsulation = NDIS_ENCAPSULATION_IEEE_802_3;
+    hardwareCaps->Checksum.IPv4Receive.Encapsulation = NDIS_ENCAPSULATION_IEEE_802_3 | NDIS_ENCAPSULATION_IEEE_802_3_P_AND_Q_IN_OOB;
     hardwareCaps->Checksum.IPv4Receive.IpChecksum = NDIS_OFFLOAD_SUPPORTED;
     hardwareCaps->Checksum.IPv4Receive.IpOptionsSupported = NDIS_OFFLOAD_SUPPORTED;
     hardwareCaps->Checksum.IPv4Receive.TcpChecksum = NDIS_OFFLOAD_SUPPORTED;
@@ -139,13 +192,13 @@ RtAdapterQueryHardwareCapabilities(
     hardwareCaps->Checksum.IPv4Receive.UdpChecksum = NDIS_OFFLOAD_SUPPORTED;
 
     // IPv6 checksum offloads supported
-    hardwareCaps->Checksum.IPv6Transmit.Encapsulation = NDIS_ENCAPSULATION_IEEE_802_3;
+    hardwareCaps->Checksum.IPv6Transmit.Encapsulation = NDIS_ENCAPSULATION_IEEE_802_3 | NDIS_ENCAPSULATION_IEEE_802_3_P_AND_Q_IN_OOB;
     hardwareCaps->Checksum.IPv6Transmit.IpExtensionHeadersSupported = NDIS_OFFLOAD_SUPPORTED;
     hardwareCaps->Checksum.IPv6Transmit.TcpChecksum = NDIS_OFFLOAD_SUPPORTED;
     hardwareCaps->Checksum.IPv6Transmit.TcpOptionsSupported = NDIS_OFFLOAD_SUPPORTED;
     hardwareCaps->Checksum.IPv6Transmit.UdpChecksum = NDIS_OFFLOAD_SUPPORTED;
 
-    hardwareCaps->Checksum.IPv6Receive.Encapsulation = NDIS_ENCAPSULATION_IEEE_802_3;
+    hardwareCaps->Checksum.IPv6Receive.Encapsulation = NDIS_ENCAPSULATION_IEEE_802_3 | NDIS_ENCAPSULATION_IEEE_802_3_P_AND_Q_IN_OOB;
     hardwareCaps->Checksum.IPv6Receive.IpExtensionHeadersSupported = NDIS_OFFLOAD_SUPPORTED;
     hardwareCaps->Checksum.IPv6Receive.TcpChecksum = NDIS_OFFLOAD_SUPPORTED;
     hardwareCaps->Checksum.IPv6Receive.TcpOptionsSupported = NDIS_OFFLOAD_SUPPORTED;
@@ -159,12 +212,12 @@ RtAdapterQueryHardwareCapabilities(
     hardwareCaps->LsoV1.IPv4.IpOptions = NDIS_OFFLOAD_NOT_SUPPORTED;
 
     // LSOv2 IPv4 offload supported
-    hardwareCaps->LsoV2.IPv4.Encapsulation = NDIS_ENCAPSULATION_IEEE_802_3;
+    hardwareCaps->LsoV2.IPv4.Encapsulation = NDIS_ENCAPSULATION_IEEE_802_3 | NDIS_ENCAPSULATION_IEEE_802_3_P_AND_Q_IN_OOB;
     hardwareCaps->LsoV2.IPv4.MaxOffLoadSize = RT_LSO_OFFLOAD_MAX_SIZE;
     hardwareCaps->LsoV2.IPv4.MinSegmentCount = RT_LSO_OFFLOAD_MIN_SEGMENT_COUNT;
 
     // LSOv2 IPv6 offload supported
-    hardwareCaps->LsoV2.IPv6.Encapsulation = NDIS_ENCAPSULATION_IEEE_802_3;
+    hardwareCaps->LsoV2.IPv6.Encapsulation = NDIS_ENCAPSULATION_IEEE_802_3 | NDIS_ENCAPSULATION_IEEE_802_3_P_AND_Q_IN_OOB;
     hardwareCaps->LsoV2.IPv6.MaxOffLoadSize = RT_LSO_OFFLOAD_MAX_SIZE;
     hardwareCaps->LsoV2.IPv6.MinSegmentCount = RT_LSO_OFFLOAD_MIN_SEGMENT_COUNT;
     hardwareCaps->LsoV2.IPv6.IpExtensionHeadersSupported = NDIS_OFFLOAD_SUPPORTED;
@@ -211,39 +264,49 @@ EvtAdapterCreateTxQueue(
 #pragma endregion
 
 #pragma region Get packet extension offsets
-    RT_TXQUEUE *tx = RtGetTxQueueContext(txQueue);
-    NET_EXTENSION_QUERY extension;
-    NET_EXTENSION_QUERY_INIT(
-        &extension,
-        NET_PACKET_EXTENSION_CHECKSUM_NAME,
-        NET_PACKET_EXTENSION_CHECKSUM_VERSION_1,
-        NetExtensionTypePacket);
-    
-    NetTxQueueGetExtension(txQueue, &extension, &tx->ChecksumExtension);
-
-    NET_EXTENSION_QUERY_INIT(
-        &extension,
-        NET_PACKET_EXTENSION_LSO_NAME,
-        NET_PACKET_EXTENSION_LSO_VERSION_1,
-        NetExtensionTypePacket);
-
-    NetTxQueueGetExtension(txQueue, &extension, &tx->LsoExtension);
-
-    NET_EXTENSION_QUERY_INIT(
-        &extension,
-        NET_FRAGMENT_EXTENSION_VIRTUAL_ADDRESS_NAME,
-        NET_FRAGMENT_EXTENSION_VIRTUAL_ADDRESS_VERSION_1,
-        NetExtensionTypeFragment);
-
-    NetTxQueueGetExtension(txQueue, &extension, &tx->VirtualAddressExtension);
-
-    NET_EXTENSION_QUERY_INIT(
-        &extension,
-        NET_FRAGMENT_EXTENSION_LOGICAL_ADDRESS_NAME,
-        NET_FRAGMENT_EXTENSION_LOGICAL_ADDRESS_VERSION_1,
-        NetExtensionTypeFragment);
-
-    NetTxQueueGetExtension(txQueue, &extension, &tx->LogicalAddressExtension);
+    {
+        RT_TXQUEUE *tx = RtGetTxQueueContext(txQueue);
+        NET_EXTENSION_QUERY extension;
+        NET_EXTENSION_QUERY_INIT(
+            &extension,
+            NET_PACKET_EXTENSION_CHECKSUM_NAME,
+            NET_PACKET_EXTENSION_CHECKSUM_VERSION_1,
+            NetExtensionTypePacket);
+
+        NetTxQueueGetExtension(txQueue, &extension, &tx->ChecksumExtension);
+
+        NET_EXTENSION_QUERY_INIT(
+            &extension,
+            NET_PACKET_EXTENSION_LSO_NAME,
+            NET_PACKET_EXTENSION_LSO_VERSION_1,
+            NetExtensionTypePacket);
+
+        NetTxQueueGetExtension(txQueue, &extension, &tx->LsoExtension);
+
+        NET_EXTENSION_QUERY_INIT(
+            &extension,
+            NET_PACKET_EXTENSION_IEEE8021Q_NAME,
+            NET_PACKET_EXTENSION_IEEE8021Q_VERSION_1,
+            NetExtensionTypePacket);
+
+        NetTxQueueGetExtension(txQueue, &extension, &tx->Ieee8021qExtension);
+
+        NET_EXTENSION_QUERY_INIT(
+            &extension,
+            NET_FRAGMENT_EXTENSION_VIRTUAL_ADDRESS_NAME,
+            NET_FRAGMENT_EXTENSION_VIRTUAL_ADDRESS_VERSION_1,
+            NetExtensionTypeFragment);
+
+        NetTxQueueGetExtension(txQueue, &extension, &tx->VirtualAddressExtension);
+
+        NET_EXTENSION_QUERY_INIT(
+            &extension,
+            NET_FRAGMENT_EXTENSION_LOGICAL_ADDRESS_NAME,
+            NET_FRAGMENT_EXTENSION_LOGICAL_ADDRESS_VERSION_1,
+            NetExtensionTypeFragment);
+
+        NetTxQueueGetExtension(txQueue, &extension, &tx->LogicalAddressExtension);
+    }
 
 #pragma endregion
 
@@ -296,25 +359,35 @@ EvtAdapterCreateRxQueue(
 
 #pragma endregion
 
-    RT_RXQUEUE *rx = RtGetRxQueueContext(rxQueue);
-    NET_EXTENSION_QUERY extension;
-    NET_EXTENSION_QUERY_INIT(
-        &extension,
-        NET_PACKET_EXTENSION_CHECKSUM_NAME,
-        NET_PACKET_EXTENSION_CHECKSUM_VERSION_1,
-        NetExtensionTypePacket);
+    {
+        RT_RXQUEUE *rx = RtGetRxQueueContext(rxQueue);
+        NET_EXTENSION_QUERY extension;
+        NET_EXTENSION_QUERY_INIT(
+            &extension,
+            NET_PACKET_EXTENSION_CHECKSUM_NAME,
+            NET_PACKET_EXTENSION_CHECKSUM_VERSION_1,
+            NetExtensionTypePacket);
+
+        rx->QueueId = queueId;
 
-    rx->QueueId = queueId;
+        NetRxQueueGetExtension(rxQueue, &extension, &rx->ChecksumExtension);
 
-    NetRxQueueGetExtension(rxQueue, &extension, &rx->ChecksumExtension);
+        NET_EXTENSION_QUERY_INIT(
+            &extension,
+            NET_PACKET_EXTENSION_IEEE8021Q_NAME,
+            NET_PACKET_EXTENSION_IEEE8021Q_VERSION_1,
+            NetExtensionTypePacket);
 
-    NET_EXTENSION_QUERY_INIT(
-        &extension,
-        NET_FRAGMENT_EXTENSION_LOGICAL_ADDRESS_NAME,
-        NET_FRAGMENT_EXTENSION_LOGICAL_ADDRESS_VERSION_1,
-        NetExtensionTypeFragment);
+        NetRxQueueGetExtension(rxQueue, &extension, &rx->Ieee8021qExtension);
 
-    NetRxQueueGetExtension(rxQueue, &extension, &rx->LogicalAddressExtension);
+        NET_EXTENSION_QUERY_INIT(
+            &extension,
+            NET_FRAGMENT_EXTENSION_LOGICAL_ADDRESS_NAME,
+            NET_FRAGMENT_EXTENSION_LOGICAL_ADDRESS_VERSION_1,
+            NetExtensionTypeFragment);
+
+        NetRxQueueGetExtension(rxQueue, &extension, &rx->LogicalAddressExtension);
+    }
 
 #pragma region Initialize RTL8168D Receive Queue
 
@@ -358,11 +431,8 @@ RtReceiveScalingEnable(
         }
     }
 
-    if (! GigaMacRssSetControl(adapter, controlBitsEnable))
-    {
-        WdfDeviceSetFailed(adapter->WdfDevice, WdfDeviceFailedAttemptRestart);
-        return STATUS_UNSUCCESSFUL;
-    }
+    // Failure to program the hardware is reported by failing the device
+    GigaMacRssSetControl(adapter, controlBitsEnable);
 
     // TBD restart rx queue
 
@@ -378,12 +448,13 @@ RtReceiveScalingSetHashSecretKey(
 {
     const UINT32 * key = (const UINT32 *)hashSecretKey->Key;
     const size_t keySize = hashSecretKey->Length / sizeof(*key);
-    if (! GigaMacRssSetHashSecretKey(adapter, key, keySize))
+    if (keySize == 0 || keySize > RSS_KEY_DW)
     {
-        WdfDeviceSetFailed(adapter->WdfDevice, WdfDeviceFailedAttemptRestart);
-        return STATUS_UNSUCCESSFUL;
+        return STATUS_INVALID_PARAMETER;
     }
 
+    GigaMacRssSetHashSecretKey(adapter, key, keySize);
+
     return STATUS_SUCCESS;
 }
 
@@ -419,10 +490,7 @@ EvtAdapterReceiveScalingDisable(
 {
     RT_ADAPTER *adapter = RtGetAdapterContext(netAdapter);
 
-    if (! GigaMacRssSetControl(adapter, RSS_MULTI_CPU_DISABLE))
-    {
-        WdfDeviceSetFailed(adapter->WdfDevice, WdfDeviceFailedAttemptRestart);
-    }
+    GigaMacRssSetControl(adapter, RSS_MULTI_CPU_DISABLE);
 }
 
 static
@@ -444,31 +512,70 @@ EvtAdapterReceiveScalingSetIndirectionEntries(
 {
     RT_ADAPTER * adapter = RtGetAdapterContext(netAdapter);
 
-    for (size_t i = 0; i < indirectionEntries->Length; i++)
-    {
-        const ULONG queueId = RtGetRxQueueContext(indirectionEntries->Entries[i].PacketQueue)->QueueId;
-        const UINT32 index = indirectionEntries->Entries[i].Index;
+    WdfSpinLockAcquire(adapter->Lock); {
 
-        const size_t bit0 = index >> 5;
-        const size_t bit1 = bit0 + ARRAYSIZE(adapter->RssIndirectionTable) / 2;
-        const UINT32 bitv = 1 << (index & 0x1f);
+        for (size_t i = 0; i < indirectionEntries->Length; i++)
+        {
+            const ULONG queueId = RtGetRxQueueContext(indirectionEntries->Entries[i].PacketQueue)->QueueId;
+            const UINT32 index = indirectionEntries->Entries[i].Index;
 
-        adapter->RssIndirectionTable[bit0] = queueId & 1
-            ? (adapter->RssIndirectionTable[bit0] | bitv)
-            : (adapter->RssIndirectionTable[bit0] & ~bitv);
+            const size_t bit0 = index >> 5;
+            const size_t bit1 = bit0 + ARRAYSIZE(adapter->RssIndirectionTable) / 2;
+            const UINT32 bitv = 1 << (index & 0x1f);
 
-        adapter->RssIndirectionTable[bit1] = queueId & 2
-            ? (adapter->RssIndirectionTable[bit1] | bitv)
-            : (adapter->RssIndirectionTable[bit1] & ~bitv);
-    }
+            adapter->RssIndirectionTable[bit0] = queueId & 1
+                ? (adapter->RssIndirectionTable[bit0] | bitv)
+                : (adapter->RssIndirectionTable[bit0] & ~bitv);
+
+            adapter->RssIndirectionTable[bit1] = queueId & 2
+                ? (adapter->RssIndirectionTable[bit1] | bitv)
+                : (adapter->RssIndirectionTable[bit1] & ~bitv);
+        }
+
+        // The table is written by the ERI work item along with the other
+        // RSS state, so calls that come in before it runs share one pass
+        GigaMacRssUpdateIndirectionTable(adapter);
+
+    } WdfSpinLockRelease(adapter->Lock);
+
+    return STATUS_SUCCESS;
+}
+
+_Use_decl_annotations_
+void
+RtAdapterWriteIndirectionTable(
+    RT_ADAPTER *adapter
+    )
+{
+    // The table holds two bit planes, bit 0 and bit 1 of the queue id of
+    // each entry. Moving a few entries between queues only touches the
+    // dwords holding them, so compare against what the hardware has and
+    // skip the rest.
 
-    // we just blat the entire table, could be optimized further
     for (size_t i = 0; i < ARRAYSIZE(adapter->CSRAddress->RssIndirectionTable); i++)
     {
-        adapter->CSRAddress->RssIndirectionTable[i] = adapter->RssIndirectionTable[i];
+        if (!adapter->RssIndirectionTableShadowValid ||
+            adapter->RssIndirectionTableShadow[i] != adapter->RssIndirectionTable[i])
+        {
+            adapter->CSRAddress->RssIndirectionTable[i] = adapter->RssIndirectionTable[i];
+            adapter->RssIndirectionTableShadow[i] = adapter->RssIndirectionTable[i];
+        }
     }
 
-    return STATUS_SUCCESS;
+    adapter->RssIndirectionTableShadowValid = true;
+    adapter->RssIndirectionTablePending = false;
+}
+
+void
+RtAdapterPushIndirectionTable(
+    _In_ RT_ADAPTER *adapter
+    )
+{
+    WdfSpinLockAcquire(adapter->Lock); {
+
+        RtAdapterWriteIndirectionTable(adapter);
+
+    } WdfSpinLockRelease(adapter->Lock);
 }
 
 NTSTATUS
@@ -593,6 +700,43 @@ RtAdapterSetupCurrentAddress(
     } RtAdapterDisableCR9346Write(adapter);
 }
 
+// The multicast hash is the CRC-32 (polynomial 0x04c11db7) of the address,
+// shifted MSB first with each input byte fed in LSB first, and without the
+// final inversion.
+#define RT_CRC32_POLYNOMIAL 0x04c11db7
+
+typedef struct _RT_CRC32_TABLE
+{
+    // CRC remainder of each possible top byte of the register
+    ULONG Remainder[256];
+    // Each input byte with its bits reversed
+    UCHAR Reflect[256];
+
+    constexpr _RT_CRC32_TABLE() : Remainder(), Reflect()
+    {
+        for (UINT i = 0; i < 256; i++)
+        {
+            ULONG remainder = i << 24;
+            UCHAR reflect = 0;
+
+            for (UINT j = 0; j < 8; j++)
+            {
+                remainder = (remainder & 0x80000000)
+                    ? (remainder << 1) ^ RT_CRC32_POLYNOMIAL
+                    : (remainder << 1);
+
+                reflect |= ((i >> j) & 1) << (7 - j);
+            }
+
+            Remainder[i] = remainder;
+            Reflect[i] = reflect;
+        }
+    }
+} RT_CRC32_TABLE;
+
+static constexpr RT_CRC32_TABLE RtCrc32Table;
+
+constexpr
 ULONG
 ComputeCrc(
     _In_reads_(length) UCHAR const *buffer,
@@ -601,6 +745,26 @@ ComputeCrc(
 {
     ULONG crc = 0xffffffff;
 
+    for (UINT i = 0; i < length; i++)
+    {
+        crc = (crc << 8) ^
+            RtCrc32Table.Remainder[(crc >> 24) ^ RtCrc32Table.Reflect[buffer[i]]];
+    }
+
+    return crc;
+}
+
+// Bit at a time reference for ComputeCrc, only evaluated at compile time
+static
+constexpr
+ULONG
+ComputeCrcBitwise(
+    _In_reads_(length) UCHAR const *buffer,
+         UINT length
+    )
+{
+    ULONG crc = 0xffffffff;
+
     for (UINT i = 0; i < length; i++)
     {
         UCHAR curByte = buffer[i];
@@ -621,28 +785,44 @@ ComputeCrc(
     return crc;
 }
 
-void
+static constexpr UCHAR RtCrcSampleAddresses[][ETH_LENGTH_OF_ADDRESS] =
+{
+    { 0x01, 0x00, 0x5e, 0x00, 0x00, 0x01 }, // IPv4 all hosts
+    { 0x01, 0x00, 0x5e, 0x7f, 0xff, 0xfa }, // IPv4 SSDP
+    { 0x33, 0x33, 0x00, 0x00, 0x00, 0x01 }, // IPv6 all nodes
+    { 0x33, 0x33, 0xff, 0x12, 0x34, 0x56 }, // IPv6 solicited node
+    { 0x01, 0x80, 0xc2, 0x00, 0x00, 0x0e }, // LLDP
+    { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff },
+};
+
+static_assert(
+    ComputeCrc(RtCrcSampleAddresses[0], ETH_LENGTH_OF_ADDRESS) == ComputeCrcBitwise(RtCrcSampleAddresses[0], ETH_LENGTH_OF_ADDRESS) &&
+    ComputeCrc(RtCrcSampleAddresses[1], ETH_LENGTH_OF_ADDRESS) == ComputeCrcBitwise(RtCrcSampleAddresses[1], ETH_LENGTH_OF_ADDRESS) &&
+    ComputeCrc(RtCrcSampleAddresses[2], ETH_LENGTH_OF_ADDRESS) == ComputeCrcBitwise(RtCrcSampleAddresses[2], ETH_LENGTH_OF_ADDRESS) &&
+    ComputeCrc(RtCrcSampleAddresses[3], ETH_LENGTH_OF_ADDRESS) == ComputeCrcBitwise(RtCrcSampleAddresses[3], ETH_LENGTH_OF_ADDRESS) &&
+    ComputeCrc(RtCrcSampleAddresses[4], ETH_LENGTH_OF_ADDRESS) == ComputeCrcBitwise(RtCrcSampleAddresses[4], ETH_LENGTH_OF_ADDRESS) &&
+    ComputeCrc(RtCrcSampleAddresses[5], ETH_LENGTH_OF_ADDRESS) == ComputeCrcBitwise(RtCrcSampleAddresses[5], ETH_LENGTH_OF_ADDRESS),
+    "table driven CRC must match the bitwise multicast hash");
+
+UCHAR
 GetMulticastBit(
-    _In_ NET_ADAPTER_LINK_LAYER_ADDRESS const * address,
-    _Out_ _Post_satisfies_(*byte < MAX_NIC_MULTICAST_REG) UCHAR *byte,
-    _Out_ UCHAR *value
+    _In_reads_bytes_(ETH_LENGTH_OF_ADDRESS) UCHAR const *address
     )
 /*++
 
 Routine Description:
 
-    For a given multicast address, returns the byte and bit in
-    the card multicast registers that it hashes to. Calls
-    ComputeCrc() to determine the CRC value.
+    For a given multicast address, returns the bit in the card
+    multicast registers that it hashes to. Bits 0 - 7 are in MAR0,
+    bits 8 - 15 in MAR1 and so on. Calls ComputeCrc() to determine
+    the CRC value.
 
 --*/
 {
-    ULONG crc = ComputeCrc(address->Address, address->Length);
+    ULONG crc = ComputeCrc(address, ETH_LENGTH_OF_ADDRESS);
 
     // The bit number is now in the 6 most significant bits of CRC.
-    UINT bitNumber = (UINT)((crc >> 26) & 0x3f);
-    *byte = (UCHAR)(bitNumber / 8);
-    *value = (UCHAR)((UCHAR)1 << (bitNumber % 8));
+    return (UCHAR)((crc >> 26) & 0x3f);
 }
 
 void
@@ -652,31 +832,35 @@ RtAdapterSetMulticastReg(
     )
 {
     // The control block stores the multicast registers in descending order.
-    // Write to them using DWORD writes.
+    // Write to them using DWORD writes, skipping the ones that already hold
+    // the right value.
 
+    ULONG const mar[2] =
     {
-        UCHAR mar7_4[4];
+        (ULONG)multicastRegs[7]       | (ULONG)multicastRegs[6] << 8 |
+        (ULONG)multicastRegs[5] << 16 | (ULONG)multicastRegs[4] << 24,
 
-        mar7_4[0] = multicastRegs[7];
-        mar7_4[1] = multicastRegs[6];
-        mar7_4[2] = multicastRegs[5];
-        mar7_4[3] = multicastRegs[4];
-
-        *reinterpret_cast<DWORD volatile *>(&adapter->CSRAddress->MulticastReg7) =
-            *reinterpret_cast<DWORD*>(&mar7_4[0]);
-    }
+        (ULONG)multicastRegs[3]       | (ULONG)multicastRegs[2] << 8 |
+        (ULONG)multicastRegs[1] << 16 | (ULONG)multicastRegs[0] << 24,
+    };
 
+    ULONG volatile * const marReg[2] =
     {
-        UCHAR mar3_0[4];
-
-        mar3_0[0] = multicastRegs[3];
-        mar3_0[1] = multicastRegs[2];
-        mar3_0[2] = multicastRegs[1];
-        mar3_0[3] = multicastRegs[0];
+        reinterpret_cast<ULONG volatile *>(&adapter->CSRAddress->MulticastReg7),
+        reinterpret_cast<ULONG volatile *>(&adapter->CSRAddress->MulticastReg3),
+    };
 
-        *reinterpret_cast<DWORD volatile *>(&adapter->CSRAddress->MulticastReg3) =
-            *reinterpret_cast<DWORD*>(&mar3_0[0]);
+    for (UINT i = 0; i < ARRAYSIZE(mar); i++)
+    {
+        if (!adapter->MulticastRegShadowValid ||
+            adapter->MulticastRegShadow[i] != mar[i])
+        {
+            *marReg[i] = mar[i];
+            adapter->MulticastRegShadow[i] = mar[i];
+        }
     }
+
+    adapter->MulticastRegShadowValid = true;
 }
 
 void RtAdapterPushMulticastList(
@@ -685,19 +869,21 @@ void RtAdapterPushMulticastList(
 {
     UCHAR multicastRegs[MAX_NIC_MULTICAST_REG] = { 0 };
 
-    if (adapter->PacketFilter &
-        (NetPacketFilterFlagPromiscuous | NetPacketFilterFlagAllMulticast))
+    if (adapter->MCListOverflow ||
+        (adapter->PacketFilter &
+        (NetPacketFilterFlagPromiscuous | NetPacketFilterFlagAllMulticast)))
     {
         RtlFillMemory(multicastRegs, MAX_NIC_MULTICAST_REG, 0xFF);
     }
     else
     {
-        // Now turn on the bit for each address in the multicast list.
-        for (UINT i = 0; i < adapter->MCAddressCount; i++)
+        // Now turn on each bit that at least one address hashes to.
+        for (UINT i = 0; i < ARRAYSIZE(adapter->MCHashRefCount); i++)
         {
-            UCHAR byte, bit;
-            GetMulticastBit(&adapter->MCList[i], &byte, &bit);
-            multicastRegs[byte] |= bit;
+            if (adapter->MCHashRefCount[i] != 0)
+            {
+                multicastRegs[i / 8] |= (UCHAR)(1 << (i % 8));
+            }
         }
     }
 
@@ -784,6 +970,137 @@ RtAdapterIssueFullReset(
             break;
         }
     }
+
+    // The reset may have returned the multicast registers and the
+    // indirection table to their default
+    adapter->MulticastRegShadowValid = false;
+    adapter->RssIndirectionTableShadowValid = false;
+}
+
+typedef struct _RT_IM_PROFILE
+{
+    // Minimum load, per millisecond, at which the profile is selected
+    ULONG PacketRate;
+    ULONG ByteRate;
+
+    UCHAR RxTimerNum;
+    UCHAR TxTimerNum;
+} RT_IM_PROFILE;
+
+// Ordered from least to most moderation. Each timer unit is roughly 10us.
+static RT_IM_PROFILE const RtAdaptiveModerationProfiles[] =
+{
+    // packets/ms  bytes/ms  Rx    Tx
+    {    0,             0,   0x00, 0x00 }, // idle or request/response
+    {   16,        10'000,   0x04, 0x10 }, // ~40us
+    {   64,        40'000,   0x0c, 0x20 }, // ~125us
+    {  256,        80'000,   0x18, 0x40 }, // ~250us
+    {  768,       110'000,   0x30, 0x50 }, // ~500us, bulk at line rate
+};
+
+// 1ms, in units of KeQueryInterruptTime
+#define RT_IM_SAMPLE_INTERVAL 10'000
+
+_Requires_lock_held_(adapter->Lock)
+static
+void
+RtAdapterProgramModerationProfile(
+    _In_ RT_ADAPTER *adapter,
+    _In_ ULONG profile
+    )
+{
+    adapter->CSRAddress->IntMiti.RxTimerNum = RtAdaptiveModerationProfiles[profile].RxTimerNum;
+    adapter->CSRAddress->IntMiti.TxTimerNum = RtAdaptiveModerationProfiles[profile].TxTimerNum;
+}
+
+_Requires_lock_held_(adapter->Lock)
+static
+void
+RtAdapterTakeModerationSample(
+    _In_ RT_ADAPTER *adapter
+    )
+{
+    RT_IM_ADAPTIVE *moderation = &adapter->AdaptiveModeration;
+
+    ULONG64 const now = KeQueryInterruptTime();
+    ULONG64 const elapsed = now - moderation->SampleTime;
+
+    if (elapsed < RT_IM_SAMPLE_INTERVAL)
+    {
+        return;
+    }
+
+    RT_STATISTICS statistics;
+    RtAdapterCollectStatistics(adapter, &statistics);
+
+    ULONG64 const packets = statistics.Rx.Packets + statistics.Tx.Packets;
+    ULONG64 const bytes = statistics.Rx.Bytes + statistics.Tx.Bytes;
+
+    // The first sample after (re)configuration only sets the baseline
+    if (moderation->SampleTime != 0)
+    {
+        ULONG64 const packetRate = (packets - moderation->Packets) * RT_IM_SAMPLE_INTERVAL / elapsed;
+        ULONG64 const byteRate = (bytes - moderation->Bytes) * RT_IM_SAMPLE_INTERVAL / elapsed;
+
+        ULONG target = 0;
+        while (target + 1 < ARRAYSIZE(RtAdaptiveModerationProfiles) &&
+            (packetRate >= RtAdaptiveModerationProfiles[target + 1].PacketRate ||
+                byteRate >= RtAdaptiveModerationProfiles[target + 1].ByteRate))
+        {
+            target++;
+        }
+
+        // Drop straight back when the load falls off so latency recovers
+        // right away, but only add delay one profile per interval.
+        ULONG profile = moderation->Profile;
+        if (target < profile)
+        {
+            profile = target;
+        }
+        else if (target > profile)
+        {
+            profile++;
+        }
+
+        if (profile != moderation->Profile)
+        {
+            moderation->Profile = profile;
+            RtAdapterProgramModerationProfile(adapter, profile);
+        }
+    }
+
+    moderation->SampleTime = now;
+    moderation->Packets = packets;
+    moderation->Bytes = bytes;
+}
+
+void
+RtAdapterSampleInterruptModeration(
+    _In_ RT_ADAPTER *adapter
+    )
+{
+    if (adapter->InterruptModerationDisabled ||
+        adapter->InterruptModerationMode == RtInterruptModerationDisabled ||
+        adapter->InterruptModerationLevel != RtInterruptModerationAdaptive)
+    {
+        return;
+    }
+
+    // Every interrupt's DPC samples, so several may find the interval over
+    // at once. This unlocked check keeps the common case off the lock, and
+    // the sample itself repeats it under the lock.
+    ULONG64 const sampleTime = ReadULong64NoFence(&adapter->AdaptiveModeration.SampleTime);
+
+    if (KeQueryInterruptTime() - sampleTime < RT_IM_SAMPLE_INTERVAL)
+    {
+        return;
+    }
+
+    WdfSpinLockAcquire(adapter->Lock); {
+
+        RtAdapterTakeModerationSample(adapter);
+
+    } WdfSpinLockRelease(adapter->Lock);
 }
 
 void 
@@ -824,6 +1141,15 @@ RtAdapterUpdateInterruptModeration(
                 // Tx: Completion isn't time-critical; give it the maximum slack.
                 adapter->CSRAddress->IntMiti.TxTimerNum = 0xf0;
                 break;
+            case RtInterruptModerationAdaptive:
+                timerFlags |= CPCR_INT_MITI_TIMER_UNIT_0;
+                timerFlags |= CPCR_INT_MITI_TIMER_UNIT_1;
+
+                // Start from the least delay and let the interrupt DPC
+                // retune the timers from the observed load.
+                adapter->AdaptiveModeration = {};
+                RtAdapterProgramModerationProfile(adapter, 0);
+                break;
             }
 
         }
@@ -861,6 +1187,50 @@ EvtSetPacketFilter(
     } WdfSpinLockRelease(adapter->Lock);
 }
 
+static
+int
+__cdecl
+RtCompareMulticastEntry(
+    _In_ void const *a,
+    _In_ void const *b
+    )
+{
+    ULONG64 const keyA = static_cast<RT_MCAST_ENTRY const *>(a)->Key;
+    ULONG64 const keyB = static_cast<RT_MCAST_ENTRY const *>(b)->Key;
+
+    return (keyA < keyB) ? -1 : (keyA > keyB) ? 1 : 0;
+}
+
+static
+ULONG64
+RtPackMulticastAddress(
+    _In_reads_bytes_(ETH_LENGTH_OF_ADDRESS) UCHAR const *address
+    )
+{
+    ULONG64 key = 0;
+
+    for (UINT i = 0; i < ETH_LENGTH_OF_ADDRESS; i++)
+    {
+        key = (key << 8) | address[i];
+    }
+
+    return key;
+}
+
+static
+void
+RtUnpackMulticastAddress(
+    _In_ ULONG64 key,
+    _Out_writes_bytes_(ETH_LENGTH_OF_ADDRESS) UCHAR *address
+    )
+{
+    for (UINT i = ETH_LENGTH_OF_ADDRESS; i > 0; i--)
+    {
+        address[i - 1] = (UCHAR)key;
+        key >>= 8;
+    }
+}
+
 void
 EvtSetMulticastList(
     _In_ NETADAPTER NetAdapter,
@@ -870,20 +1240,75 @@ EvtSetMulticastList(
 {
     RT_ADAPTER *adapter = RtGetAdapterContext(NetAdapter);
 
-    WdfSpinLockAcquire(adapter->Lock); {
+    // Multicast list updates are serialized by the framework, so MCList and
+    // MCScratch are only ever written here. The lock covers the hash filter
+    // reference counts and the registers, which EvtSetPacketFilter also uses.
+
+    bool const overflow = MulticastAddressCount > RT_MAX_MCAST_LIST;
+    UINT newCount = 0;
 
-        adapter->MCAddressCount = MulticastAddressCount;
+    if (!overflow)
+    {
+        for (UINT i = 0; i < MulticastAddressCount; i++)
+        {
+            if (MulticastAddressList[i].Length == ETH_LENGTH_OF_ADDRESS)
+            {
+                adapter->MCScratch[newCount].Key =
+                    RtPackMulticastAddress(MulticastAddressList[i].Address);
+                newCount++;
+            }
+        }
 
-        RtlZeroMemory(adapter->MCList,
-        sizeof(NET_ADAPTER_LINK_LAYER_ADDRESS) * RT_MAX_MCAST_LIST);
+        qsort(adapter->MCScratch, newCount, sizeof(RT_MCAST_ENTRY), RtCompareMulticastEntry);
+    }
 
-        if (MulticastAddressCount != 0)
+    WdfSpinLockAcquire(adapter->Lock); {
+
+        // Walk the old and new lists together. Addresses in both keep their
+        // hash bit, addresses that went away release theirs, and only the
+        // addresses that are new get hashed.
+        UINT oldIndex = 0;
+        UINT newIndex = 0;
+
+        while (oldIndex < adapter->MCAddressCount || newIndex < newCount)
         {
-            RtlCopyMemory(adapter->MCList,
-                MulticastAddressList,
-                sizeof(NET_ADAPTER_LINK_LAYER_ADDRESS) * MulticastAddressCount);
+            RT_MCAST_ENTRY const *oldEntry =
+                (oldIndex < adapter->MCAddressCount) ? &adapter->MCList[oldIndex] : nullptr;
+            RT_MCAST_ENTRY *newEntry =
+                (newIndex < newCount) ? &adapter->MCScratch[newIndex] : nullptr;
+
+            if (newEntry == nullptr ||
+                (oldEntry != nullptr && oldEntry->Key < newEntry->Key))
+            {
+                adapter->MCHashRefCount[oldEntry->HashBit]--;
+                oldIndex++;
+            }
+            else if (oldEntry == nullptr || newEntry->Key < oldEntry->Key)
+            {
+                UCHAR address[ETH_LENGTH_OF_ADDRESS];
+                RtUnpackMulticastAddress(newEntry->Key, address);
+
+                newEntry->HashBit = GetMulticastBit(address);
+                adapter->MCHashRefCount[newEntry->HashBit]++;
+                newIndex++;
+            }
+            else
+            {
+                newEntry->HashBit = oldEntry->HashBit;
+                oldIndex++;
+                newIndex++;
+            }
         }
 
+        RtlCopyMemory(adapter->MCList,
+            adapter->MCScratch,
+            sizeof(RT_MCAST_ENTRY) * newCount);
+
+        adapter->MCAddressCount = newCount;
+
+        // Too many addresses to track, fall back to receiving all multicast
+        adapter->MCListOverflow = overflow;
+
         RtAdapterPushMulticastList(adapter);
 
     } WdfSpinLockRelease(adapter->Lock);
@@ -926,7 +1351,7 @@ RtAdapterSetLinkLayerCapabilities(
         EvtSetPacketFilter);
 
     NetAdapterSetLinkLayerCapabilities(adapter->NetAdapter, &linkLayerCapabilities);
-    NetAdapterSetLinkLayerMtuSize(adapter->NetAdapter, RT_MAX_PACKET_SIZE - ETH_LENGTH_OF_HEADER);
+    NetAdapterSetLinkLayerMtuSize(adapter->NetAdapter, adapter->JumboPacket - ETH_LENGTH_OF_HEADER);
     NetAdapterSetPermanentLinkLayerAddress(adapter->NetAdapter, &adapter->PermanentAddress);
     NetAdapterSetCurrentLinkLayerAddress(adapter->NetAdapter, &adapter->CurrentAddress);
     NetAdapterSetPacketFilterCapabilities(adapter->NetAdapter, &packetFilterCapabilities);
@@ -992,11 +1417,19 @@ RtAdapterSetDatapathCapabilities(
     NET_ADAPTER_DMA_CAPABILITIES rxDmaCapabilities;
     NET_ADAPTER_DMA_CAPABILITIES_INIT(&rxDmaCapabilities, adapter->DmaEnabler);
 
+    // Receive buffers hold the largest frame RMS lets through, so every frame
+    // fits a single descriptor. RxIndicateReceives still chains a frame the
+    // hardware spreads over several descriptors, but that path has not been
+    // exercised on hardware.
+    //
+    // Frames are always indicated in place. With system managed buffers a
+    // fragment ring slot and its DMA buffer are returned together, so
+    // copying small frames out would not get the buffer reposted sooner.
     NET_ADAPTER_RX_CAPABILITIES rxCapabilities;
     NET_ADAPTER_RX_CAPABILITIES_INIT_SYSTEM_MANAGED_DMA(
         &rxCapabilities,
         &rxDmaCapabilities,
-        RT_MAX_PACKET_SIZE + FRAME_CRC_SIZE + RSVD_BUF_SIZE,
+        RT_FRAME_SIZE(adapter->JumboPacket) + RSVD_BUF_SIZE,
         1);
 
     rxCapabilities.FragmentBufferAlignment = 64;
@@ -1067,6 +1500,21 @@ RtAdapterSetOffloadCapabilities(
         EvtAdapterOffloadSetLso);
 
     NetAdapterOffloadSetLsoCapabilities(adapter->NetAdapter, &lsoOffloadCapabilities);
+
+    if (adapter->PriorityVlanTag != RtPriorityVlanTagDisabled)
+    {
+        auto const ieee8021qTagFlags = static_cast<NET_ADAPTER_OFFLOAD_IEEE8021Q_TAG_FLAGS>(
+            ((adapter->PriorityVlanTag & RtPriorityTagEnabled) ? NetAdapterOffloadIeee8021PriorityTaggingFlag : 0) |
+            ((adapter->PriorityVlanTag & RtVlanTagEnabled)     ? NetAdapterOffloadIeee8021VlanTaggingFlag     : 0));
+
+        NET_ADAPTER_OFFLOAD_IEEE8021Q_TAG_CAPABILITIES ieee8021qTagOffloadCapabilities;
+
+        NET_ADAPTER_OFFLOAD_IEEE8021Q_TAG_CAPABILITIES_INIT(
+            &ieee8021qTagOffloadCapabilities,
+            ieee8021qTagFlags);
+
+        NetAdapterOffloadSetIeee8021qTagCapabilities(adapter->NetAdapter, &ieee8021qTagOffloadCapabilities);
+    }
 }
 
 _Use_decl_annotations_
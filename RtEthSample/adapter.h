@@ -49,8 +49,31 @@ typedef enum _RT_IM_LEVEL
 {
     RtInterruptModerationLow = 0,
     RtInterruptModerationMedium = 1,
+    RtInterruptModerationAdaptive = 2,
 } RT_IM_LEVEL;
 
+// Adaptive interrupt moderation state, sampled from the interrupt DPCs
+typedef struct _RT_IM_ADAPTIVE
+{
+    // Interrupt time and Rx + Tx totals at the start of the current interval
+    ULONG64 SampleTime;
+    ULONG64 Packets;
+    ULONG64 Bytes;
+
+    // Index into the moderation profile table currently programmed
+    ULONG Profile;
+} RT_IM_ADAPTIVE;
+
+// One multicast list entry. The address is packed into Key most significant
+// byte first, so sorting the keys sorts the addresses.
+typedef struct _RT_MCAST_ENTRY
+{
+    ULONG64 Key;
+
+    // Bit of the multicast hash filter the address maps to, 0 - 63
+    UCHAR HashBit;
+} RT_MCAST_ENTRY;
+
 typedef enum _RT_FLOW_CONTROL
 {
     RtFlowControlDisabled = 0,
@@ -79,8 +102,30 @@ typedef enum _RT_SPEED_DUPLEX_MODE {
 
 } RT_SPEED_DUPLEX_MODE;
 
+typedef enum _RT_PRIORITY_VLAN_TAG
+{
+    RtPriorityVlanTagDisabled = 0,
+    RtPriorityTagEnabled = 1,
+    RtVlanTagEnabled = 2,
+    RtPriorityVlanTagEnabled = 3,
+} RT_PRIORITY_VLAN_TAG;
+
 #pragma endregion
 
+// Pre-decoded receive checksum and layout information, indexed by the
+// compressed receive descriptor status (see RT_RX_CHECKSUM_INDEX_* in
+// rxqueue.cpp). Rebuilt whenever the checksum offload configuration changes.
+typedef struct _RT_RX_CHECKSUM_INFO
+{
+    UINT8 Layer3Type : 4;
+    UINT8 Layer4Type : 4;
+    UINT8 Layer2 : 2;
+    UINT8 Layer3 : 2;
+    UINT8 Layer4 : 2;
+} RT_RX_CHECKSUM_INFO;
+
+#define RT_RX_CHECKSUM_TABLE_SIZE 256
+
 // Context for NETADAPTER
 typedef struct _RT_ADAPTER
 {
@@ -92,9 +137,13 @@ typedef struct _RT_ADAPTER
     NETPACKETQUEUE TxQueue;
     NETPACKETQUEUE RxQueues[RT_NUMBER_OF_QUEUES];
 
-    // Pointer to interrupt object
+    // Interrupt servicing transmit, link change and receive queue 0
     RT_INTERRUPT *Interrupt;
 
+    // Interrupt servicing each receive queue. These all point to Interrupt,
+    // unless the device was granted a message per queue. See RtInterruptCreate.
+    RT_INTERRUPT *RxInterrupt[RT_NUMBER_OF_QUEUES];
+
     // configuration
     NET_ADAPTER_LINK_LAYER_ADDRESS PermanentAddress;
     NET_ADAPTER_LINK_LAYER_ADDRESS CurrentAddress;
@@ -110,36 +159,27 @@ typedef struct _RT_ADAPTER
     USHORT LinkSpeed;
     NET_IF_MEDIA_DUPLEX_STATE DuplexMode;
 
-    // multicast list
+    // multicast list, sorted by Key. MCScratch holds the incoming list
+    // while EvtSetMulticastList merges it against MCList.
     UINT MCAddressCount;
-    NET_ADAPTER_LINK_LAYER_ADDRESS MCList[RT_MAX_MCAST_LIST];
-
-    // Packet counts
-    ULONG64 InUcastOctets;
-    ULONG64 InMulticastOctets;
-    ULONG64 InBroadcastOctets;
-    ULONG64 OutUCastPkts;
-    ULONG64 OutMulticastPkts;
-    ULONG64 OutBroadcastPkts;
-    ULONG64 OutUCastOctets;
-    ULONG64 OutMulticastOctets;
-    ULONG64 OutBroadcastOctets;
-
-    ULONG64 TotalTxErr;
-    ULONG   TotalRxErr;
-
-    ULONG64 HwTotalRxMatchPhy;
-    ULONG64 HwTotalRxBroadcast;
-    ULONG64 HwTotalRxMulticast;
-
-    // Count of transmit errors
-    ULONG TxAbortExcessCollisions;
-    ULONG TxDmaUnderrun;
-    ULONG TxOneRetry;
-    ULONG TxMoreThanOneRetry;
-
-    // Count of receive errors
-    ULONG RcvResourceErrors;
+    RT_MCAST_ENTRY MCList[RT_MAX_MCAST_LIST];
+    RT_MCAST_ENTRY MCScratch[RT_MAX_MCAST_LIST];
+
+    // The list did not fit, the hash filter is opened to all multicast
+    bool MCListOverflow;
+
+    // Number of MCList entries hashing to each bit of the hash filter
+    USHORT MCHashRefCount[MAX_NIC_MULTICAST_REG * 8];
+
+    // Last values written to MAR7 - MAR4 and MAR3 - MAR0. Invalidated by a
+    // full reset, which returns the registers to their default.
+    ULONG MulticastRegShadow[2];
+    bool MulticastRegShadowValid;
+
+    // Packet counts of queues that have already been stopped, and the
+    // hardware tally totals. Running queues keep their own counts;
+    // RtAdapterCollectStatistics adds them in, see statistics.cpp.
+    RT_STATISTICS Statistics;
 
     RT_MAC *volatile CSRAddress;
 
@@ -152,6 +192,12 @@ typedef struct _RT_ADAPTER
     PHYSICAL_ADDRESS TallyPhy;
     RT_TALLY *GTally;
 
+    // Periodic tally dump, see statistics.cpp
+    WDFTIMER TallyTimer;
+    RT_TALLY LastTally;
+    bool TallyDumpPending;
+    bool TallyBaselineValid;
+
     RT_CHIP_TYPE ChipType;
 
     bool LinkAutoNeg;
@@ -159,6 +205,9 @@ typedef struct _RT_ADAPTER
     USHORT ReceiveBuffers;
     USHORT TransmitBuffers;
 
+    // user "*JumboPacket" setting, the largest packet size excluding the CRC
+    ULONG JumboPacket;
+
     BOOLEAN IpHwChkSum;
     BOOLEAN TcpHwChkSum;
     BOOLEAN UdpHwChkSum;
@@ -169,6 +218,8 @@ typedef struct _RT_ADAPTER
     ULONG ChksumErrRxUdpIpv6Cnt;
     ULONG ChksumErrRxUdpIpv4Cnt;
 
+    RT_RX_CHECKSUM_INFO RxChecksumTable[RT_RX_CHECKSUM_TABLE_SIZE];
+
     // Tracks *WakeOnLan Keyword
     bool WakeOnMagicPacketEnabled;
 
@@ -178,6 +229,22 @@ typedef struct _RT_ADAPTER
     RT_IM_LEVEL InterruptModerationLevel;
     // Runtime disablement, controlled by OID
     bool InterruptModerationDisabled;
+    // Used when InterruptModerationLevel is RtInterruptModerationAdaptive
+    RT_IM_ADAPTIVE AdaptiveModeration;
+
+    // Most packets a queue indicates or completes per advance, managed by
+    // INF keyword
+    ULONG PollBudget;
+
+    // Transmitted packets announced to the hardware per TPPoll write,
+    // managed by INF keyword
+    ULONG TxDoorbellThreshold;
+
+    // Returned receive buffers are posted in batches of RxPostBatch, or
+    // right away once the hardware owns fewer than RxPostLowWater
+    // descriptors. Managed by INF keyword.
+    ULONG RxPostBatch;
+    ULONG RxPostLowWater;
 
     // basic detection of concurrent EEPROM use
     bool EEPROMSupported;
@@ -186,8 +253,30 @@ typedef struct _RT_ADAPTER
     // ReceiveScaling
     UINT32 RssIndirectionTable[RT_INDIRECTION_TABLE_SIZE];
 
+    // Last indirection table written to the hardware
+    UINT32 RssIndirectionTableShadow[RT_INDIRECTION_TABLE_SIZE];
+    bool RssIndirectionTableShadowValid;
+
+    // RssIndirectionTable has changes the ERI work item has yet to write
+    bool RssIndirectionTablePending;
+
+    // ERI access engine, see gigamac.cpp. EriLock serializes use of the
+    // ERI registers, the pending RSS writes and EriStarted are protected
+    // by Lock. Pending writes are only queued while EriStarted is set.
+    WDFWAITLOCK EriLock;
+    WDFWORKITEM EriWorkItem;
+    bool EriStarted;
+    UINT32 EriRssKey[RSS_KEY_DW];
+    size_t EriRssKeySize;
+    bool EriRssKeyPending;
+    UINT32 EriRssControl;
+    bool EriRssControlPending;
+
     RT_FLOW_CONTROL FlowControl;
 
+    // user "*PriorityVlanTag" setting
+    RT_PRIORITY_VLAN_TAG PriorityVlanTag;
+
     RT_LSO_OFFLOAD LSOv4;
     RT_LSO_OFFLOAD LSOv6;
     bool RssEnabled;
@@ -230,10 +319,17 @@ RtAdapterStart(
     _In_ RT_ADAPTER *adapter);
 
 void RtAdapterUpdateInterruptModeration(_In_ RT_ADAPTER *adapter);
+void RtAdapterSampleInterruptModeration(_In_ RT_ADAPTER *adapter);
 
 void
 RtAdapterUpdateHardwareChecksum(_In_ RT_ADAPTER *adapter);
 
+void
+RtAdapterUpdateHardwareVlan(_In_ RT_ADAPTER *adapter);
+
+void
+RtAdapterUpdateJumboFrames(_In_ RT_ADAPTER *adapter);
+
 NTSTATUS
 RtAdapterReadAddress(_In_ RT_ADAPTER *adapter);
 
@@ -258,5 +354,12 @@ RtAdapterSetupCurrentAddress(_In_ RT_ADAPTER *adapter);
 void
 RtAdapterPushMulticastList(_In_ RT_ADAPTER *adapter);
 
+void
+RtAdapterPushIndirectionTable(_In_ RT_ADAPTER *adapter);
+
+_Requires_lock_held_(adapter->Lock)
+void
+RtAdapterWriteIndirectionTable(_In_ RT_ADAPTER *adapter);
+
 bool
 RtAdapterQueryChipType(_In_ RT_ADAPTER *adapter, _Out_ RT_CHIP_TYPE *chipType);
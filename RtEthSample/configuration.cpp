@@ -13,6 +13,7 @@
 
 #include "trace.h"
 #include "configuration.h"
+#include "statistics.h"
 #include "adapter.h"
 
 typedef struct _RT_ADVANCED_PROPERTY
@@ -40,9 +41,15 @@ RT_ADVANCED_PROPERTY RtSupportedProperties[] =
     { NDIS_STRING_CONST("*InterruptModeration"),     RT_OFFSET(InterruptModerationMode),  RT_SIZE(InterruptModerationMode),  RtInterruptModerationEnabled,     RtInterruptModerationDisabled,    RtInterruptModerationEnabled },
     { NDIS_STRING_CONST("*FlowControl"),             RT_OFFSET(FlowControl),              RT_SIZE(FlowControl),              RtFlowControlTxRxEnabled,         RtFlowControlDisabled,            RtFlowControlTxRxEnabled },
     { NDIS_STRING_CONST("*RSS"),                     RT_OFFSET(RssEnabled),               RT_SIZE(RssEnabled),               false,                            false,                            true },
+    { NDIS_STRING_CONST("*PriorityVlanTag"),         RT_OFFSET(PriorityVlanTag),          RT_SIZE(PriorityVlanTag),          RtPriorityVlanTagEnabled,         RtPriorityVlanTagDisabled,        RtPriorityVlanTagEnabled },
+    { NDIS_STRING_CONST("*JumboPacket"),             RT_OFFSET(JumboPacket),              RT_SIZE(JumboPacket),              RT_MAX_PACKET_SIZE,               RT_MAX_PACKET_SIZE,               RT_MAX_JUMBO_PACKET_SIZE },
 
     // Custom Keywords
-    { NDIS_STRING_CONST("InterruptModerationLevel"), RT_OFFSET(InterruptModerationLevel), RT_SIZE(InterruptModerationLevel), RtInterruptModerationLow,         RtInterruptModerationLow,         RtInterruptModerationMedium },
+    { NDIS_STRING_CONST("InterruptModerationLevel"), RT_OFFSET(InterruptModerationLevel), RT_SIZE(InterruptModerationLevel), RtInterruptModerationLow,         RtInterruptModerationLow,         RtInterruptModerationAdaptive },
+    { NDIS_STRING_CONST("PollBudget"),               RT_OFFSET(PollBudget),               RT_SIZE(PollBudget),               64,                               1,                                RT_MAX_RX_DESC },
+    { NDIS_STRING_CONST("TxDoorbellThreshold"),      RT_OFFSET(TxDoorbellThreshold),      RT_SIZE(TxDoorbellThreshold),      1,                                1,                                RT_MAX_TCB },
+    { NDIS_STRING_CONST("RxPostBatch"),              RT_OFFSET(RxPostBatch),              RT_SIZE(RxPostBatch),              16,                               1,                                RT_MAX_RX_DESC },
+    { NDIS_STRING_CONST("RxPostLowWater"),           RT_OFFSET(RxPostLowWater),           RT_SIZE(RxPostLowWater),           32,                               1,                                RT_MAX_RX_DESC },
 };
 
 NTSTATUS
@@ -13,12 +13,14 @@
 
 #include "trace.h"
 #include "device.h"
+#include "statistics.h"
 #include "adapter.h"
 #include "configuration.h"
 #include "interrupt.h"
 #include "link.h"
 #include "phy.h"
 #include "eeprom.h"
+#include "gigamac.h"
 
 NTSTATUS
 RtGetResources(
@@ -94,7 +96,7 @@ RtRegisterScatterGatherDma(
     TraceEntryRtAdapter(adapter);
 
     WDF_DMA_ENABLER_CONFIG dmaEnablerConfig;
-    WDF_DMA_ENABLER_CONFIG_INIT(&dmaEnablerConfig, WdfDmaProfileScatterGather64, RT_MAX_PACKET_SIZE);
+    WDF_DMA_ENABLER_CONFIG_INIT(&dmaEnablerConfig, WdfDmaProfileScatterGather64, adapter->JumboPacket);
     dmaEnablerConfig.Flags |= WDF_DMA_ENABLER_CONFIG_REQUIRE_SINGLE_TRANSFER;
     dmaEnablerConfig.WdmDmaVersionOverride = 3;
 
@@ -197,15 +199,8 @@ RtInitializeHardware(
     GOTO_IF_NOT_NT_SUCCESS(Exit, status,
         RtGetResources(adapter, resourcesRaw, resourcesTranslated));
 
-    adapter->Interrupt->Imr[0].Address16 = &adapter->CSRAddress->IMR0;
-    adapter->Interrupt->Imr[1].Address8 = &adapter->CSRAddress->IMR1;
-    adapter->Interrupt->Imr[2].Address8 = &adapter->CSRAddress->IMR2;
-    adapter->Interrupt->Imr[3].Address8 = &adapter->CSRAddress->IMR3;
-
-    adapter->Interrupt->Isr[0].Address16 = &adapter->CSRAddress->ISR0;
-    adapter->Interrupt->Isr[1].Address8 = &adapter->CSRAddress->ISR1;
-    adapter->Interrupt->Isr[2].Address8 = &adapter->CSRAddress->ISR2;
-    adapter->Interrupt->Isr[3].Address8 = &adapter->CSRAddress->ISR3;
+    GOTO_IF_NOT_NT_SUCCESS(Exit, status,
+        RtInterruptCreate(adapter, resourcesRaw, resourcesTranslated));
 
     GOTO_IF_NOT_NT_SUCCESS(Exit, status,
         RtInitializeChipType(adapter));
@@ -233,6 +228,10 @@ RtInitializeHardware(
         RtRegisterScatterGatherDma(adapter),
         TraceLoggingRtAdapter(adapter));
 
+    GOTO_IF_NOT_NT_SUCCESS(Exit, status,
+        RtAdapterAllocateTally(adapter),
+        TraceLoggingRtAdapter(adapter));
+
     // Init the hardware and set up everything
     RtAdapterRefreshCurrentAddress(adapter);
 
@@ -255,6 +254,12 @@ void
 RtReleaseHardware(
     _In_ RT_ADAPTER *adapter)
 {
+    GigaMacFlush(adapter);
+
+    // The framework deletes the interrupts created in RtInitializeHardware
+    adapter->Interrupt = nullptr;
+    RtlZeroMemory(adapter->RxInterrupt, sizeof(adapter->RxInterrupt));
+
     if (adapter->HwTallyMemAlloc)
     {
         WdfObjectDelete(adapter->HwTallyMemAlloc);
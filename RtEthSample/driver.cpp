@@ -13,9 +13,10 @@
 
 #include "trace.h"
 #include "device.h"
+#include "statistics.h"
 #include "adapter.h"
 #include "power.h"
-#include "interrupt.h"
+#include "toeplitz.h"
 
 // {5D364AAF-5B49-41A0-9E03-D3CB2AA2E03E}
 TRACELOGGING_DEFINE_PROVIDER(
@@ -44,6 +45,10 @@ DriverEntry(
 
     TraceEntry(TraceLoggingUnicodeString(registryPath));
 
+#if DBG
+    NT_ASSERTMSG("Toeplitz hash does not match the RSS test vectors", RtToeplitzSelfTest());
+#endif
+
     WDF_DRIVER_CONFIG driverConfig;
     WDF_DRIVER_CONFIG_INIT(&driverConfig, EvtDriverDeviceAdd);
 
@@ -151,16 +156,15 @@ EvtDriverDeviceAdd(
     GOTO_IF_NOT_NT_SUCCESS(Exit, status,
         NetAdapterCreate(adapterInit, &adapterAttributes, &netAdapter));
 
-    RT_ADAPTER *adapter = RtGetAdapterContext(netAdapter);
-    RT_DEVICE *device = RtGetDeviceContext(wdfDevice);
-
-    device->Adapter = adapter;
+    {
+        RT_ADAPTER *adapter = RtGetAdapterContext(netAdapter);
+        RT_DEVICE *device = RtGetDeviceContext(wdfDevice);
 
-    GOTO_IF_NOT_NT_SUCCESS(Exit, status,
-        RtInitializeAdapterContext(adapter, wdfDevice, netAdapter));
+        device->Adapter = adapter;
 
-    GOTO_IF_NOT_NT_SUCCESS(Exit, status,
-        RtInterruptCreate(wdfDevice, adapter, &adapter->Interrupt));
+        GOTO_IF_NOT_NT_SUCCESS(Exit, status,
+            RtInitializeAdapterContext(adapter, wdfDevice, netAdapter));
+    }
 
 Exit:
     if (adapterInit != nullptr)
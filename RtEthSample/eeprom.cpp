@@ -12,6 +12,7 @@
 #include "precomp.h"
 
 #include "eeprom.h"
+#include "statistics.h"
 #include "adapter.h"
 
 // RTL8168D <-> 93C46 EEPROM
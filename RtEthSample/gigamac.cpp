@@ -11,7 +11,10 @@
 
 #include "precomp.h"
 
+#include "trace.h"
 #include "gigamac.h"
+#include "device.h"
+#include "statistics.h"
 #include "adapter.h"
 #include "rxqueue.h"
 
@@ -23,9 +26,9 @@
 #define GIGAMAC_BYTES_4 0x0000f000
 #define GIGAMAC_WRITE_4 (GIGAMAC_WRITE | GIGAMAC_BYTES_4)
 
-#define GIGAMAC_WAIT_TIME 100 // 100us
+#define GIGAMAC_POLL_TIME 5 // 5us
+#define GIGAMAC_POLL_COUNT 200 // 1ms total
 #define GIGAMAC_WAIT_EXIT_TIME 20 // 20us
-#define GIGAMAC_WAIT_COUNT 10
 
 #define GIGAMAC_RSS_KEY_DW 0x0090
 #define GIGAMAC_RSS_CONTROL 0x00b8
@@ -33,52 +36,203 @@
 #define GIGAMAC_RDSAR2 0x00d8
 #define GIGAMAC_RDSAR3 0x00e0
 
+// ERI writes are performed in batches. Receive descriptor addresses are
+// written synchronously, since the queue cannot start without them. RSS
+// writes are recorded in the adapter and performed by a work item, so the
+// NetAdapter callbacks return without waiting on the hardware. If the
+// hardware does not complete a queued write, the work item fails the device.
+//
+// The RSS indirection table is a plain register, not behind ERI, but it is
+// written by the same work item so that back-to-back indirection updates
+// are coalesced into one pass over the table.
+//
+// RSS writes requested outside D0 are only recorded. GigaMacStop stops
+// queueing before D0Exit flushes the work item, and GigaMacStart queues
+// whatever was recorded in the meantime once the device is back in D0.
+
+typedef struct _GIGAMAC_ERI_WRITE
+{
+    UINT32 Access;
+    UINT32 Data;
+} GIGAMAC_ERI_WRITE;
+
 static
-bool
-GigaMacWrite(
-    _In_ RT_ADAPTER *adapter,
-    _In_ UINT32 access,
+GIGAMAC_ERI_WRITE
+GigaMacWrite4(
+    _In_ UINT16 address,
     _In_ UINT32 data
     )
 {
-    WdfSpinLockAcquire(adapter->Lock);
+    // address shall not specify bits indicating part of the write size
+    NT_ASSERT((0xf000 & address) == 0);
+    // address shall not specify lower two bits (double word alignment)
+    NT_ASSERT((0x0003 & address) == 0);
 
-    adapter->CSRAddress->ERIData = data;
-    adapter->CSRAddress->ERIAccess = access;
+    return { GIGAMAC_WRITE_4 | address, data };
+}
 
-    bool completed = false;
-    for (size_t count = 0; count < GIGAMAC_WAIT_COUNT; count++)
+static
+bool
+GigaMacWriteBatch(
+    _In_ RT_ADAPTER *adapter,
+    _In_reads_(count) GIGAMAC_ERI_WRITE const *writes,
+    _In_ size_t count
+    )
+{
+    // Caller holds EriLock. The adapter lock is not needed, nothing else
+    // touches the ERI registers.
+
+    for (size_t i = 0; i < count; i++)
     {
-        KeStallExecutionProcessor(GIGAMAC_WAIT_TIME);
+        adapter->CSRAddress->ERIData = writes[i].Data;
+        adapter->CSRAddress->ERIAccess = writes[i].Access;
 
-        if (GIGAMAC_WRITE_DONE(adapter->CSRAddress->ERIAccess))
+        bool completed = false;
+        for (size_t poll = 0; poll < GIGAMAC_POLL_COUNT; poll++)
         {
-            KeStallExecutionProcessor(GIGAMAC_WAIT_EXIT_TIME);
-            completed = true;
+            KeStallExecutionProcessor(GIGAMAC_POLL_TIME);
+
+            if (GIGAMAC_WRITE_DONE(adapter->CSRAddress->ERIAccess))
+            {
+                KeStallExecutionProcessor(GIGAMAC_WAIT_EXIT_TIME);
+                completed = true;
 
-            break;
+                break;
+            }
         }
-    }
 
-    WdfSpinLockRelease(adapter->Lock);
+        if (! completed)
+        {
+            return false;
+        }
+    }
 
-    return completed;
+    return true;
 }
 
 static
-bool
-GigaMacWrite4(
-    _In_ RT_ADAPTER *adapter,
-    _In_ UINT16 address,
-    _In_ UINT32 data
+void
+EvtGigaMacWorkItem(
+    _In_ WDFWORKITEM workItem
     )
 {
-    // address shall not specify bits indicating part of the write size
-    NT_ASSERT((0xf000 & address) == 0);
-    // address shall not specify lower two bits (double word alignment)
-    NT_ASSERT((0x0003 & address) == 0);
+    RT_ADAPTER *adapter = RtGetDeviceContext(WdfWorkItemGetParentObject(workItem))->Adapter;
+
+    GIGAMAC_ERI_WRITE writes[RSS_KEY_DW + 1];
+    size_t count = 0;
+
+    WdfWaitLockAcquire(adapter->EriLock, nullptr);
+
+    // Only the latest key and control value matter, so requests that came
+    // in while a previous batch was being written are coalesced here.
+    WdfSpinLockAcquire(adapter->Lock); {
+
+        // Leave the writes pending for GigaMacStart if the device left D0
+        // after this work item was queued
+        if (adapter->EriStarted && adapter->EriRssKeyPending)
+        {
+            for (size_t i = 0; i < adapter->EriRssKeySize; i++)
+            {
+                writes[count++] = GigaMacWrite4(
+                    (UINT16)(GIGAMAC_RSS_KEY_DW + i * sizeof(UINT32)),
+                    adapter->EriRssKey[i]);
+            }
+
+            adapter->EriRssKeyPending = false;
+        }
+
+        if (adapter->EriStarted && adapter->EriRssControlPending)
+        {
+            writes[count++] = GigaMacWrite4(GIGAMAC_RSS_CONTROL, adapter->EriRssControl);
+
+            adapter->EriRssControlPending = false;
+        }
+
+        if (adapter->EriStarted && adapter->RssIndirectionTablePending)
+        {
+            RtAdapterWriteIndirectionTable(adapter);
+        }
+
+    } WdfSpinLockRelease(adapter->Lock);
+
+    bool const completed = GigaMacWriteBatch(adapter, writes, count);
+
+    WdfWaitLockRelease(adapter->EriLock);
+
+    if (! completed)
+    {
+        WdfDeviceSetFailed(adapter->WdfDevice, WdfDeviceFailedAttemptRestart);
+    }
+}
+
+_Use_decl_annotations_
+NTSTATUS
+GigaMacInitialize(
+    RT_ADAPTER *adapter
+    )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+
+    WDF_OBJECT_ATTRIBUTES attributes;
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = adapter->WdfDevice;
+
+    GOTO_IF_NOT_NT_SUCCESS(Exit, status,
+        WdfWaitLockCreate(&attributes, &adapter->EriLock));
+
+    WDF_WORKITEM_CONFIG workItemConfig;
+    WDF_WORKITEM_CONFIG_INIT(&workItemConfig, EvtGigaMacWorkItem);
+
+    GOTO_IF_NOT_NT_SUCCESS(Exit, status,
+        WdfWorkItemCreate(&workItemConfig, &attributes, &adapter->EriWorkItem));
+
+Exit:
+    return status;
+}
 
-    return GigaMacWrite(adapter, GIGAMAC_WRITE_4 | address, data);
+_Use_decl_annotations_
+void
+GigaMacStart(
+    RT_ADAPTER *adapter
+    )
+{
+    WdfSpinLockAcquire(adapter->Lock); {
+
+        adapter->EriStarted = true;
+
+        if (adapter->EriRssKeyPending ||
+            adapter->EriRssControlPending ||
+            adapter->RssIndirectionTablePending)
+        {
+            WdfWorkItemEnqueue(adapter->EriWorkItem);
+        }
+
+    } WdfSpinLockRelease(adapter->Lock);
+}
+
+_Use_decl_annotations_
+void
+GigaMacStop(
+    RT_ADAPTER *adapter
+    )
+{
+    WdfSpinLockAcquire(adapter->Lock); {
+
+        adapter->EriStarted = false;
+
+    } WdfSpinLockRelease(adapter->Lock);
+
+    GigaMacFlush(adapter);
+}
+
+_Use_decl_annotations_
+void
+GigaMacFlush(
+    RT_ADAPTER *adapter
+    )
+{
+    // Wait for queued ERI writes to reach the hardware
+    WdfWorkItemFlush(adapter->EriWorkItem);
 }
 
 _Use_decl_annotations_
@@ -110,39 +264,76 @@ GigaMacSetReceiveDescriptorStartAddress(
     }
 
     UINT16 addressHigh = addressLow + sizeof(adapter->CSRAddress->ERIAccess);
-    return GigaMacWrite4(adapter, addressLow, physicalAddress.LowPart) &&
-        GigaMacWrite4(adapter, addressHigh, physicalAddress.HighPart);
+
+    GIGAMAC_ERI_WRITE const writes[] =
+    {
+        GigaMacWrite4(addressLow, physicalAddress.LowPart),
+        GigaMacWrite4(addressHigh, physicalAddress.HighPart),
+    };
+
+    WdfWaitLockAcquire(adapter->EriLock, nullptr);
+
+    bool const completed = GigaMacWriteBatch(adapter, writes, ARRAYSIZE(writes));
+
+    WdfWaitLockRelease(adapter->EriLock);
+
+    return completed;
 }
 
 _Use_decl_annotations_
-bool
+void
 GigaMacRssSetHashSecretKey(
     RT_ADAPTER *adapter,
     const UINT32 hashSecretKey[],
     size_t hashSecretKeySize
     )
 {
-    UINT32 address = GIGAMAC_RSS_KEY_DW;
-    for (size_t i = 0; i < hashSecretKeySize; i++, address += sizeof(address))
-    {
-        NT_ASSERT((0xffff0000 & address) == 0);
-        if (! GigaMacWrite4(adapter, (UINT16)address, hashSecretKey[i]))
+    NT_ASSERT(hashSecretKeySize <= ARRAYSIZE(adapter->EriRssKey));
+
+    WdfSpinLockAcquire(adapter->Lock); {
+
+        RtlCopyMemory(adapter->EriRssKey, hashSecretKey, hashSecretKeySize * sizeof(UINT32));
+        adapter->EriRssKeySize = hashSecretKeySize;
+        adapter->EriRssKeyPending = true;
+
+        if (adapter->EriStarted)
         {
-            return false;
+            WdfWorkItemEnqueue(adapter->EriWorkItem);
         }
-    }
 
-    return true;
+    } WdfSpinLockRelease(adapter->Lock);
 }
 
+_Use_decl_annotations_
+void
+GigaMacRssUpdateIndirectionTable(
+    RT_ADAPTER *adapter
+    )
+{
+    adapter->RssIndirectionTablePending = true;
+
+    if (adapter->EriStarted)
+    {
+        WdfWorkItemEnqueue(adapter->EriWorkItem);
+    }
+}
 
 _Use_decl_annotations_
-bool
+void
 GigaMacRssSetControl(
     RT_ADAPTER *adapter,
     UINT32 controlHashMultiCpu
     )
 {
-    return GigaMacWrite4(adapter, GIGAMAC_RSS_CONTROL, controlHashMultiCpu);
-}
+    WdfSpinLockAcquire(adapter->Lock); {
 
+        adapter->EriRssControl = controlHashMultiCpu;
+        adapter->EriRssControlPending = true;
+
+        if (adapter->EriStarted)
+        {
+            WdfWorkItemEnqueue(adapter->EriWorkItem);
+        }
+
+    } WdfSpinLockRelease(adapter->Lock);
+}
@@ -13,6 +13,26 @@
 
 struct RT_RXQUEUE;
 
+NTSTATUS
+GigaMacInitialize(
+    _In_ RT_ADAPTER *adapter
+    );
+
+void
+GigaMacStart(
+    _In_ RT_ADAPTER *adapter
+    );
+
+void
+GigaMacStop(
+    _In_ RT_ADAPTER *adapter
+    );
+
+void
+GigaMacFlush(
+    _In_ RT_ADAPTER *adapter
+    );
+
 bool
 GigaMacSetReceiveDescriptorStartAddress(
     _In_ RT_ADAPTER *adapter,
@@ -20,14 +40,20 @@ GigaMacSetReceiveDescriptorStartAddress(
     _In_ PHYSICAL_ADDRESS const physicalAddress
     );
 
-bool
+void
 GigaMacRssSetHashSecretKey(
     _In_ RT_ADAPTER *adapter,
     _In_reads_(secretHashKeySize) const UINT32 secretHashKey[],
-    _In_ size_t secretHashKeySize
+    _In_range_(1, RSS_KEY_DW) size_t secretHashKeySize
     );
 
-bool
+_Requires_lock_held_(adapter->Lock)
+void
+GigaMacRssUpdateIndirectionTable(
+    _In_ RT_ADAPTER *adapter
+    );
+
+void
 GigaMacRssSetControl(
     _In_ RT_ADAPTER *adapter,
     _In_ UINT32 controlHashMultiCpu
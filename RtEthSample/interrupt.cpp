@@ -13,9 +13,19 @@
 
 #include "trace.h"
 #include "interrupt.h"
+#include "statistics.h"
 #include "adapter.h"
 #include "link.h"
 
+static
+bool
+RtInterruptServicesQueue(
+    _In_ RT_INTERRUPT const *interrupt,
+    _In_ ULONG queueId)
+{
+    return queueId >= interrupt->QueueBegin && queueId < interrupt->QueueEnd;
+}
+
 static
 UINT32
 RtInterruptIsrGet(
@@ -32,9 +42,20 @@ RtInterruptIsrGet(
         break;
 
     default:
-        if (interrupt->Adapter->RxQueues[queueId])
+        if (interrupt->Adapter->RxQueues[queueId] &&
+            RtInterruptServicesQueue(interrupt, queueId))
         {
-            isr = *interrupt->Isr[queueId].Address8;
+            // A queue with its IMR cleared cannot have raised the
+            // interrupt. Its status stays latched and raises the interrupt
+            // as soon as the queue is armed again.
+            if (interrupt->ImrShadow[queueId] != 0)
+            {
+                isr = *interrupt->Isr[queueId].Address8;
+            }
+            else
+            {
+                interrupt->NumIsrReadsSkipped++;
+            }
         }
         break;
 
@@ -50,14 +71,25 @@ RtInterruptImrPut(
     _In_ ULONG queueId,
     _In_ UINT32 value)
 {
+    UINT16 const imr = (queueId == 0) ? (UINT16)value : (UINT8)value;
+
+    // Skip writes that would not change the register
+    if (interrupt->ImrShadow[queueId] == imr)
+    {
+        interrupt->NumImrWritesSkipped++;
+        return;
+    }
+
+    interrupt->ImrShadow[queueId] = imr;
+
     switch (queueId)
     {
     case 0:
-        *interrupt->Imr[queueId].Address16 = (UINT16)value;
+        *interrupt->Imr[queueId].Address16 = imr;
         return;
     }
 
-    *interrupt->Imr[queueId].Address8 = (UINT8)value;
+    *interrupt->Imr[queueId].Address8 = (UINT8)imr;
 }
 
 static
@@ -90,7 +122,8 @@ RtInterruptSecondaryImrUpdate(
     _In_ UINT32 isr,
     _In_ UINT8 imr)
 {
-    if (interrupt->Adapter->RxQueues[queueId])
+    if (interrupt->Adapter->RxQueues[queueId] &&
+        RtInterruptServicesQueue(interrupt, queueId))
     {
         RtInterruptImrPut(interrupt, queueId, imr);
         if (isr)
@@ -100,35 +133,230 @@ RtInterruptSecondaryImrUpdate(
     }
 }
 
+static
 NTSTATUS
-RtInterruptCreate(
-    _In_ WDFDEVICE wdfDevice,
+RtInterruptCreateForQueues(
     _In_ RT_ADAPTER *adapter,
+    _In_ PCM_PARTIAL_RESOURCE_DESCRIPTOR rawDescriptor,
+    _In_ PCM_PARTIAL_RESOURCE_DESCRIPTOR translatedDescriptor,
+    _In_ ULONG queueBegin,
+    _In_ ULONG queueEnd,
+    _In_opt_ WDFSPINLOCK spinLock,
+    _In_ KIRQL synchronizeIrql,
+    _In_opt_ RT_INTERRUPT *service,
     _Out_ RT_INTERRUPT **interrupt)
 {
-    TraceEntryRtAdapter(adapter);
-
     *interrupt = nullptr;
 
     WDF_OBJECT_ATTRIBUTES attributes;
     WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&attributes, RT_INTERRUPT);
 
+    // Only the interrupt servicing queue 0 has to look at transmit and link
+    // change, the others only ever see their own receive queue.
     WDF_INTERRUPT_CONFIG config;
-    WDF_INTERRUPT_CONFIG_INIT(&config, EvtInterruptIsr, EvtInterruptDpc);
+    if (queueBegin == 0)
+    {
+        WDF_INTERRUPT_CONFIG_INIT(&config, EvtInterruptIsr, EvtInterruptDpc);
+    }
+    else
+    {
+        WDF_INTERRUPT_CONFIG_INIT(&config, EvtInterruptRxIsr, EvtInterruptRxDpc);
+    }
 
     config.EvtInterruptEnable = EvtInterruptEnable;
     config.EvtInterruptDisable = EvtInterruptDisable;
+    config.InterruptRaw = rawDescriptor;
+    config.InterruptTranslated = translatedDescriptor;
+
+    if (spinLock != WDF_NO_HANDLE)
+    {
+        // Interrupts working on the same state are serialized by one lock,
+        // held at the highest level any of them is raised at
+        config.SpinLock = spinLock;
+        config.SynchronizeIrql = synchronizeIrql;
+    }
 
     NTSTATUS status = STATUS_SUCCESS;
 
     WDFINTERRUPT wdfInterrupt;
     GOTO_IF_NOT_NT_SUCCESS(Exit, status,
-        WdfInterruptCreate(wdfDevice, &config, &attributes, &wdfInterrupt));
+        WdfInterruptCreate(adapter->WdfDevice, &config, &attributes, &wdfInterrupt));
 
     *interrupt = RtGetInterruptContext(wdfInterrupt);
 
     (*interrupt)->Adapter = adapter;
     (*interrupt)->Handle = wdfInterrupt;
+    (*interrupt)->QueueBegin = queueBegin;
+    (*interrupt)->QueueEnd = queueEnd;
+    (*interrupt)->Service = service != nullptr ? service : *interrupt;
+
+    for (ULONG queueId = 0; queueId < RT_NUMBER_OF_QUEUES; queueId++)
+    {
+        (*interrupt)->ImrShadow[queueId] = RtImrUnknown;
+    }
+
+    (*interrupt)->Imr[0].Address16 = &adapter->CSRAddress->IMR0;
+    (*interrupt)->Imr[1].Address8 = &adapter->CSRAddress->IMR1;
+    (*interrupt)->Imr[2].Address8 = &adapter->CSRAddress->IMR2;
+    (*interrupt)->Imr[3].Address8 = &adapter->CSRAddress->IMR3;
+
+    (*interrupt)->Isr[0].Address16 = &adapter->CSRAddress->ISR0;
+    (*interrupt)->Isr[1].Address8 = &adapter->CSRAddress->ISR1;
+    (*interrupt)->Isr[2].Address8 = &adapter->CSRAddress->ISR2;
+    (*interrupt)->Isr[3].Address8 = &adapter->CSRAddress->ISR3;
+
+Exit:
+
+    return status;
+}
+
+NTSTATUS
+RtInterruptCreate(
+    _In_ RT_ADAPTER *adapter,
+    _In_ WDFCMRESLIST resourcesRaw,
+    _In_ WDFCMRESLIST resourcesTranslated)
+/*++
+
+Routine Description:
+
+    Creates the interrupt objects from the assigned interrupt resources.
+    Called from EvtDevicePrepareHardware, the framework deletes the objects
+    again once the hardware is released.
+
+    When the device was granted a message per receive queue, each queue gets
+    its own interrupt so its ISR and DPC run independently of the others,
+    on the processor the system steered that message to. Otherwise a single
+    interrupt, line based or message signaled, services all queues.
+
+    The MAC still raises message N for the events in ISR N when fewer
+    messages were granted, so every granted message is connected. The
+    extra ones forward to the interrupt servicing all queues, under the
+    same lock, and queue its DPC.
+
+--*/
+{
+    TraceEntryRtAdapter(adapter);
+
+    NTSTATUS status = STATUS_SUCCESS;
+
+    PCM_PARTIAL_RESOURCE_DESCRIPTOR rawDescriptors[RT_NUMBER_OF_QUEUES] = {};
+    PCM_PARTIAL_RESOURCE_DESCRIPTOR translatedDescriptors[RT_NUMBER_OF_QUEUES] = {};
+    ULONG interruptCount = 0;
+    bool messageSignaled = true;
+
+    ULONG const resourceCount = WdfCmResourceListGetCount(resourcesRaw);
+
+    for (ULONG i = 0; i < resourceCount; i++)
+    {
+        PCM_PARTIAL_RESOURCE_DESCRIPTOR rawDescriptor = WdfCmResourceListGetDescriptor(resourcesRaw, i);
+
+        if (rawDescriptor->Type == CmResourceTypeInterrupt)
+        {
+            if (interruptCount < RT_NUMBER_OF_QUEUES)
+            {
+                rawDescriptors[interruptCount] = rawDescriptor;
+                translatedDescriptors[interruptCount] =
+                    WdfCmResourceListGetDescriptor(resourcesTranslated, i);
+            }
+
+            if (! (rawDescriptor->Flags & CM_RESOURCE_INTERRUPT_MESSAGE))
+            {
+                messageSignaled = false;
+            }
+
+            interruptCount++;
+        }
+    }
+
+    if (interruptCount == 0)
+    {
+        GOTO_IF_NOT_NT_SUCCESS(Exit, status, STATUS_RESOURCE_TYPE_NOT_FOUND);
+    }
+
+    if (messageSignaled && interruptCount >= RT_NUMBER_OF_QUEUES)
+    {
+        // Message N is raised for the events in ISR N
+        for (ULONG queueId = 0; queueId < RT_NUMBER_OF_QUEUES; queueId++)
+        {
+            GOTO_IF_NOT_NT_SUCCESS(Exit, status,
+                RtInterruptCreateForQueues(
+                    adapter,
+                    rawDescriptors[queueId],
+                    translatedDescriptors[queueId],
+                    queueId,
+                    queueId + 1,
+                    WDF_NO_HANDLE,
+                    0,
+                    nullptr,
+                    &adapter->RxInterrupt[queueId]));
+        }
+    }
+    else
+    {
+        ULONG const messageCount = messageSignaled ? interruptCount : 1;
+        WDFSPINLOCK spinLock = WDF_NO_HANDLE;
+        KIRQL synchronizeIrql = 0;
+
+        if (messageCount > 1)
+        {
+            WDF_OBJECT_ATTRIBUTES attributes;
+            WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+            attributes.ParentObject = adapter->WdfDevice;
+
+            GOTO_IF_NOT_NT_SUCCESS(Exit, status,
+                WdfSpinLockCreate(&attributes, &spinLock));
+
+            for (ULONG i = 0; i < messageCount; i++)
+            {
+                synchronizeIrql = max(synchronizeIrql,
+                    (KIRQL)translatedDescriptors[i]->u.MessageInterrupt.Translated.Level);
+            }
+        }
+
+        GOTO_IF_NOT_NT_SUCCESS(Exit, status,
+            RtInterruptCreateForQueues(
+                adapter,
+                rawDescriptors[0],
+                translatedDescriptors[0],
+                0,
+                RT_NUMBER_OF_QUEUES,
+                spinLock,
+                synchronizeIrql,
+                nullptr,
+                &adapter->RxInterrupt[0]));
+
+        for (ULONG queueId = 1; queueId < RT_NUMBER_OF_QUEUES; queueId++)
+        {
+            adapter->RxInterrupt[queueId] = adapter->RxInterrupt[0];
+        }
+
+        // The extra messages service no queue of their own, so their
+        // enable and disable callbacks leave every IMR alone
+        for (ULONG i = 1; i < messageCount; i++)
+        {
+            RT_INTERRUPT *forward;
+            GOTO_IF_NOT_NT_SUCCESS(Exit, status,
+                RtInterruptCreateForQueues(
+                    adapter,
+                    rawDescriptors[i],
+                    translatedDescriptors[i],
+                    0,
+                    0,
+                    spinLock,
+                    synchronizeIrql,
+                    adapter->RxInterrupt[0],
+                    &forward));
+        }
+    }
+
+    adapter->Interrupt = adapter->RxInterrupt[0];
+
+    TraceLoggingWrite(
+        RealtekTraceProvider,
+        "InterruptResources",
+        TraceLoggingUInt32(interruptCount, "InterruptCount"),
+        TraceLoggingBool(messageSignaled, "MessageSignaled"),
+        TraceLoggingBool(adapter->Interrupt != adapter->RxInterrupt[1], "PerQueue"));
 
 Exit:
 
@@ -137,12 +365,17 @@ Exit:
 }
 
 void
-RtInterruptInitialize(_In_ RT_INTERRUPT *interrupt)
+RtInterruptInitialize(_In_ RT_ADAPTER *adapter)
 {
-    RtInterruptImrPut(interrupt, 0, 0);
-    RtInterruptImrPut(interrupt, 1, 0);
-    RtInterruptImrPut(interrupt, 2, 0);
-    RtInterruptImrPut(interrupt, 3, 0);
+    // The IMR contents are unknown after a power transition, so mask
+    // everything regardless of what was last written
+    for (ULONG queueId = 0; queueId < RT_NUMBER_OF_QUEUES; queueId++)
+    {
+        RT_INTERRUPT *interrupt = adapter->RxInterrupt[queueId];
+
+        interrupt->ImrShadow[queueId] = RtImrUnknown;
+        RtInterruptImrPut(interrupt, queueId, 0);
+    }
 }
 
 static
@@ -201,10 +434,10 @@ EvtInterruptEnable(
     // so do not grab the lock internally
 
     RT_INTERRUPT *interrupt = RtGetInterruptContext(wdfInterrupt);
-    RtInterruptImrPut(interrupt, 0, RtCalculateImr(interrupt, 0));
-    RtInterruptImrPut(interrupt, 1, RtCalculateImr(interrupt, 1));
-    RtInterruptImrPut(interrupt, 2, RtCalculateImr(interrupt, 2));
-    RtInterruptImrPut(interrupt, 3, RtCalculateImr(interrupt, 3));
+    for (ULONG queueId = interrupt->QueueBegin; queueId < interrupt->QueueEnd; queueId++)
+    {
+        RtInterruptImrPut(interrupt, queueId, RtCalculateImr(interrupt, queueId));
+    }
 
     TraceExit();
     return STATUS_SUCCESS;
@@ -223,7 +456,11 @@ EvtInterruptDisable(
     // Framework sychronizes EvtInterruptDisable with WdfInterruptAcquireLock
     // so do not grab the lock internally
 
-    RtInterruptInitialize(RtGetInterruptContext(wdfInterrupt));
+    RT_INTERRUPT *interrupt = RtGetInterruptContext(wdfInterrupt);
+    for (ULONG queueId = interrupt->QueueBegin; queueId < interrupt->QueueEnd; queueId++)
+    {
+        RtInterruptImrPut(interrupt, queueId, 0);
+    }
 
     TraceExit();
     return STATUS_SUCCESS;
@@ -237,7 +474,7 @@ EvtInterruptIsr(
 {
     UNREFERENCED_PARAMETER((MessageID));
 
-    RT_INTERRUPT *interrupt = RtGetInterruptContext(wdfInterrupt);
+    RT_INTERRUPT *interrupt = RtGetInterruptContext(wdfInterrupt)->Service;
 
     interrupt->NumInterrupts++;
 
@@ -309,6 +546,52 @@ EvtInterruptIsr(
     if (isr0 & RtRxInterruptFlags)
         interrupt->NumRxInterrupts[0]++;
 
+    WdfInterruptQueueDpcForIsr(interrupt->Handle);
+
+    return true;
+}
+
+_Use_decl_annotations_
+BOOLEAN
+EvtInterruptRxIsr(
+    _In_ WDFINTERRUPT wdfInterrupt,
+    ULONG MessageID)
+{
+    UNREFERENCED_PARAMETER((MessageID));
+
+    RT_INTERRUPT *interrupt = RtGetInterruptContext(wdfInterrupt);
+    ULONG const queueId = interrupt->QueueBegin;
+
+    interrupt->NumInterrupts++;
+
+    // Always returns 0 if ! RxQueues[N]
+    UINT32 isr = RtInterruptIsrGet(interrupt, queueId);
+    if (isr == (UINT8)RtInactiveInterrupt)
+    {
+        interrupt->NumInterruptsDisabled++;
+        return false;
+    }
+
+    // Acknowledge the interrupt, noop if value == 0
+    RtInterruptIsrPut(interrupt, queueId, isr);
+
+    isr &= RtRxInterruptSecondaryFlags;
+
+    if (isr == 0)
+    {
+        interrupt->NumInterruptsNotOurs++;
+        return false;
+    }
+
+    // Queue up interrupt work, this interrupt only ever saves its own queue
+    InterlockedOr((LONG volatile *)&interrupt->SavedIsr, isr);
+
+    // Disable the signals for queued work, see EvtInterruptIsr
+    UINT8 imr = (UINT8)RtCalculateImr(interrupt, queueId);
+    imr &= ~(UINT8)isr;
+
+    RtInterruptSecondaryImrUpdate(interrupt, queueId, isr, imr);
+
     WdfInterruptQueueDpcForIsr(wdfInterrupt);
 
     return true;
@@ -376,4 +659,27 @@ EvtInterruptDpc(
     {
         RtAdapterNotifyLinkChange(adapter);
     }
+
+    RtAdapterSampleInterruptModeration(adapter);
+}
+
+_Use_decl_annotations_
+VOID
+EvtInterruptRxDpc(
+    _In_ WDFINTERRUPT Interrupt,
+    _In_ WDFOBJECT AssociatedObject)
+{
+    UNREFERENCED_PARAMETER(AssociatedObject);
+
+    RT_INTERRUPT *interrupt = RtGetInterruptContext(Interrupt);
+
+    UINT32 isr = InterlockedExchange((LONG volatile *)&interrupt->SavedIsr, 0);
+
+    if (isr & RtRxInterruptSecondaryFlags)
+    {
+        RtRxNotify(interrupt, interrupt->QueueBegin);
+    }
+
+    // Load may land on this queue alone
+    RtAdapterSampleInterruptModeration(interrupt->Adapter);
 }
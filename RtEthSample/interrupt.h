@@ -16,6 +16,17 @@ typedef struct _RT_INTERRUPT
     RT_ADAPTER *Adapter;
     WDFINTERRUPT Handle;
 
+    // Receive queues serviced by this interrupt, from QueueBegin up to but
+    // not including QueueEnd. The interrupt servicing queue 0 also services
+    // transmit and link change.
+    ULONG QueueBegin;
+    ULONG QueueEnd;
+
+    // Interrupt whose state EvtInterruptIsr works on. This is the interrupt
+    // itself, except for the extra messages of a partial message grant,
+    // which are forwarded to the interrupt servicing all queues.
+    struct _RT_INTERRUPT *Service;
+
     // Armed Notifications
     LONG RxNotifyArmed[RT_NUMBER_OF_QUEUES];
     LONG TxNotifyArmed;
@@ -31,6 +42,10 @@ typedef struct _RT_INTERRUPT
         volatile UINT8 * Address8;
     } Imr[RT_NUMBER_OF_QUEUES];
 
+    // Last value written to each IMR serviced by this interrupt, or
+    // RtImrUnknown if the register has to be written regardless
+    UINT16 ImrShadow[RT_NUMBER_OF_QUEUES];
+
     // Fired Notificiations
     // Tracks un-served ISR interrupt fields. Masks in only
     // the RtExpectedInterruptFlags
@@ -42,6 +57,8 @@ typedef struct _RT_INTERRUPT
     ULONG64 NumInterruptsDisabled;
     ULONG64 NumRxInterrupts[RT_NUMBER_OF_QUEUES];
     ULONG64 NumTxInterrupts;
+    ULONG64 NumImrWritesSkipped;
+    ULONG64 NumIsrReadsSkipped;
 } RT_INTERRUPT;
 
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(RT_INTERRUPT, RtGetInterruptContext);
@@ -52,18 +69,21 @@ static const USHORT RtRxInterruptSecondaryFlags = ISR123_ROK | ISR123_RDU;
 static const USHORT RtDefaultInterruptFlags = ISRIMR_LINK_CHG;
 static const USHORT RtExpectedInterruptFlags = (RtTxInterruptFlags | RtRxInterruptFlags | RtDefaultInterruptFlags | ISRIMR_RX_FOVW);
 static const USHORT RtInactiveInterrupt = 0xFFFF;
+static const USHORT RtImrUnknown = 0xFFFF;
 
 NTSTATUS
 RtInterruptCreate(
-    _In_ WDFDEVICE wdfDevice,
     _In_ RT_ADAPTER *adapter,
-    _Out_ RT_INTERRUPT **interrupt);
+    _In_ WDFCMRESLIST resourcesRaw,
+    _In_ WDFCMRESLIST resourcesTranslated);
 
-void RtInterruptInitialize(_In_ RT_INTERRUPT *interrupt);
+void RtInterruptInitialize(_In_ RT_ADAPTER *adapter);
 void RtUpdateImr(_In_ RT_INTERRUPT *interrupt, ULONG QueueId);
 
 EVT_WDF_INTERRUPT_ISR EvtInterruptIsr;
 EVT_WDF_INTERRUPT_DPC EvtInterruptDpc;
+EVT_WDF_INTERRUPT_ISR EvtInterruptRxIsr;
+EVT_WDF_INTERRUPT_DPC EvtInterruptRxDpc;
 EVT_WDF_INTERRUPT_ENABLE EvtInterruptEnable;
 EVT_WDF_INTERRUPT_DISABLE EvtInterruptDisable;
 
@@ -14,6 +14,7 @@
 #include "trace.h"
 #include "link.h"
 #include "phy.h"
+#include "statistics.h"
 #include "adapter.h"
 
 NET_IF_MEDIA_DUPLEX_STATE
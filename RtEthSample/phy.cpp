@@ -13,6 +13,7 @@
 
 #include "trace.h"
 #include "phy.h"
+#include "statistics.h"
 #include "adapter.h"
 
 void
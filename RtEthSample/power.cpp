@@ -14,10 +14,12 @@
 #include "trace.h"
 #include "power.h"
 #include "device.h"
+#include "statistics.h"
 #include "adapter.h"
 #include "link.h"
 #include "phy.h"
 #include "interrupt.h"
+#include "gigamac.h"
 
 void
 RtAdapterEnableMagicPacket(_In_ RT_ADAPTER *adapter)
@@ -79,8 +81,9 @@ EvtDeviceD0Entry(
         TraceLoggingUInt32(previousState, "PreviousState"));
 
     // Interrupts will be fully enabled in EvtInterruptEnable
-    RtInterruptInitialize(adapter->Interrupt);
+    RtInterruptInitialize(adapter);
     RtAdapterUpdateHardwareChecksum(adapter);
+    RtAdapterUpdateHardwareVlan(adapter);
     RtAdapterUpdateInterruptModeration(adapter);
 
     if (previousState != WdfPowerDeviceD3Final)
@@ -101,7 +104,16 @@ EvtDeviceD0Entry(
         NetAdapterSetLinkState(adapter->NetAdapter, &linkState);
     }
 
-    adapter->CSRAddress->RMS = RT_MAX_FRAME_SIZE;
+    RtAdapterUpdateJumboFrames(adapter);
+    adapter->CSRAddress->RMS = RT_FRAME_SIZE(adapter->JumboPacket);
+
+    // Restore the RSS indirection table, a reset may have cleared it
+    RtAdapterPushIndirectionTable(adapter);
+
+    // Write any RSS key or control changes made while out of D0
+    GigaMacStart(adapter);
+
+    RtAdapterStartTally(adapter);
 
     TraceExit();
     return STATUS_SUCCESS;
@@ -118,6 +130,12 @@ EvtDeviceD0Exit(
 
     TraceEntry();
 
+    RtAdapterStopTally(adapter);
+
+    // Let queued ERI writes finish while the hardware is still in D0, later
+    // ones are held until D0Entry
+    GigaMacStop(adapter);
+
     if (TargetState != WdfPowerDeviceD3Final)
     {
         NET_ADAPTER_LINK_STATE linkState;
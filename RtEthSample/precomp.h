@@ -19,6 +19,7 @@
 #include <netiodef.h>
 
 #include <net/checksum.h>
+#include <net/ieee8021q.h>
 #include <net/logicaladdress.h>
 #include <net/lso.h>
 #include <net/virtualaddress.h>
@@ -70,6 +70,10 @@
 // packet and header sizes
 #define RT_MAX_PACKET_SIZE (1514)
 #define RT_MAX_FRAME_SIZE  (RT_MAX_PACKET_SIZE + VLAN_HEADER_SIZE + FRAME_CRC_SIZE)
+#define RT_MAX_JUMBO_PACKET_SIZE (9014)
+
+// largest frame on the wire for a given *JumboPacket size
+#define RT_FRAME_SIZE(packetSize) ((packetSize) + VLAN_HEADER_SIZE + FRAME_CRC_SIZE)
 
 // maximum link speed for send and recv in bps
 #define RT_MEDIA_MAX_SPEED 1'000'000'000
@@ -84,8 +88,12 @@
 // max number of physical fragments supported per TCB
 #define RT_MAX_PHYS_BUF_COUNT 16
 
+// fragmented packets up to this size are copied into a per-packet bounce
+// buffer and sent with a single descriptor
+#define RT_TX_BOUNCE_SIZE 256
+
 // multicast list size
-#define RT_MAX_MCAST_LIST 32
+#define RT_MAX_MCAST_LIST 512
 
 #define RT_MIN_RX_DESC 18
 #define RT_MAX_RX_DESC 1024
@@ -442,8 +450,13 @@ typedef enum _RT_TCR_RCR_MXDMA : UCHAR
 #define CR9346_EEM1        BIT_7 // 00: normal
 
 // CONFIG3: 0x54
+#define CONFIG3_Jumbo_En0 BIT_2         // Jumbo frames, RTL8168C and later
 #define CONFIG3_Magic   0x20            // Wake on Magic packet
 
+// CONFIG4: 0x55
+#define CONFIG4_Jumbo_En1       BIT_1   // Jumbo frames, RTL8168C/D
+#define CONFIG4_Jumbo_En1_8168E BIT_0   // Jumbo frames, RTL8168E
+
 // PhyAccessReg: 0x60
 #define PHYAR_Flag      BIT_31
 
@@ -539,6 +552,7 @@ typedef enum _RT_PHY_REG
 #define RXS_IPV6RSS_IS_IPV4 BIT_14
 #define RXS_IPV6RSS_UDPF BIT_10
 #define RXS_IPV6RSS_TCPF BIT_9
+#define RXS_IPV6RSS_TAVA BIT_0
 
 // Transmit status
 #define TXS_CC3_0       BIT_0|BIT_1|BIT_2|BIT_3
@@ -581,4 +595,7 @@ typedef enum _RT_PHY_REG
 #define RSS_MULTI_CPU_ENABLE (1<<16)
 #define RSS_MULTI_CPU_DISABLE (0)
 
+// size of the RSS hash secret key, in 32-bit words
+#define RSS_KEY_DW 10
+
 #pragma endregion
@@ -12,6 +12,7 @@
 #include "precomp.h"
 
 #include "device.h"
+#include "statistics.h"
 #include "rxqueue.h"
 #include "trace.h"
 #include "adapter.h"
@@ -27,268 +28,385 @@ RtUpdateRecvStats(
          ULONG length
     )
 {
-    // Unlike for Tx, the hardware has counters for Broadcast, Multicast,
-    // and Unicast inbound packets. So, we defer to the hardware counter for
-    // # of Rx transmissions.
+    // The hardware tally also counts Broadcast and Multicast inbound
+    // packets, but only across all queues and one period late. The queue
+    // counts its own packets and bytes, and its bytes by destination.
+
+    RT_RX_STATISTICS *statistics = &rx->Statistics->Counters;
+
+    statistics->Packets++;
+    statistics->Bytes += length;
 
     if (rxd->RxDescDataIpv6Rss.status & RXS_BAR)
     {
-        rx->Adapter->InBroadcastOctets += length;
+        statistics->BroadcastOctets += length;
     }
     else if (rxd->RxDescDataIpv6Rss.status & RXS_MAR)
     {
-        rx->Adapter->InMulticastOctets += length;
+        statistics->MulticastOctets += length;
     }
     else
     {
-        rx->Adapter->InUcastOctets += length;
+        statistics->UcastOctets += length;
     }
 }
 
-static
-void
-RxFillRtl8111DChecksumInfo(
-    _In_    RT_RXQUEUE const *rx,
-    _In_    RT_RX_DESC const *rxd,
-    _In_    UINT32 packetIndex,
-    _Inout_ NET_PACKET *packet
+// The receive checksum table is indexed by a compressed form of the receive
+// descriptor status. The low nibble maps directly onto the status word; the
+// upper bits are gathered from IpRssTava and the chip specific location of
+// the layer 4 checksum failure bits.
+#define RT_RX_CHECKSUM_INDEX_IPF      BIT_0
+#define RT_RX_CHECKSUM_INDEX_TCP      BIT_1
+#define RT_RX_CHECKSUM_INDEX_UDP      BIT_2
+#define RT_RX_CHECKSUM_INDEX_CRC      BIT_3
+#define RT_RX_CHECKSUM_INDEX_IPV4     BIT_4
+#define RT_RX_CHECKSUM_INDEX_IPV6     BIT_5
+#define RT_RX_CHECKSUM_INDEX_TCPF     BIT_6
+#define RT_RX_CHECKSUM_INDEX_UDPF     BIT_7
+
+static_assert(RT_RX_CHECKSUM_INDEX_IPF == RXS_IPF, "status bits are used as-is");
+static_assert(RT_RX_CHECKSUM_INDEX_TCP == RXS_TCPIP_PACKET, "status bits are used as-is");
+static_assert(RT_RX_CHECKSUM_INDEX_UDP == RXS_UDPIP_PACKET, "status bits are used as-is");
+static_assert(RT_RX_CHECKSUM_INDEX_CRC == RXS_CRC, "status bits are used as-is");
+
+template <RT_CHIP_TYPE ChipType>
+UINT8
+RxGetLayer4FailureIndexBits(
+    _In_ RT_RX_DESC const *rxd);
+
+template <>
+UINT8
+RxGetLayer4FailureIndexBits<RTL8168D>(
+    _In_ RT_RX_DESC const *rxd
     )
 {
-    RT_ADAPTER* adapter = rx->Adapter;
-    NET_PACKET_CHECKSUM* checksumInfo =
-        NetExtensionGetPacketChecksum(
-            &rx->ChecksumExtension,
-            packetIndex);
+    // RXS_IPV6RSS_TCPF (BIT_9) and RXS_IPV6RSS_UDPF (BIT_10) map to
+    // RT_RX_CHECKSUM_INDEX_TCPF and RT_RX_CHECKSUM_INDEX_UDPF
+    return (UINT8)((rxd->RxDescDataIpv6Rss.IpRssTava &
+        (RXS_IPV6RSS_TCPF | RXS_IPV6RSS_UDPF)) >> 3);
+}
 
-    packet->Layout.Layer2Type = NetPacketLayer2TypeEthernet;
-    checksumInfo->Layer2 =
-        (rxd->RxDescDataIpv6Rss.status & RXS_CRC)
-        ? NetPacketRxChecksumEvaluationInvalid
-        : NetPacketRxChecksumEvaluationValid;
+template <>
+UINT8
+RxGetLayer4FailureIndexBits<RTL8168E>(
+    _In_ RT_RX_DESC const *rxd
+    )
+{
+    // TXS_TCPCS (BIT_0) and TXS_UDPCS (BIT_1) map to
+    // RT_RX_CHECKSUM_INDEX_TCPF and RT_RX_CHECKSUM_INDEX_UDPF
+    return (UINT8)(rxd->RxDescDataIpv6Rss.TcpUdpFailure << 6);
+}
 
-    USHORT const isIpv4 = rxd->RxDescDataIpv6Rss.IpRssTava & RXS_IPV6RSS_IS_IPV4;
-    USHORT const isIpv6 = rxd->RxDescDataIpv6Rss.IpRssTava & RXS_IPV6RSS_IS_IPV6;
+template <RT_CHIP_TYPE ChipType>
+static
+UINT8
+RxGetChecksumIndex(
+    _In_ RT_RX_DESC const *rxd
+    )
+{
+    UINT8 const status = (UINT8)(rxd->RxDescDataIpv6Rss.status &
+        (RXS_IPF | RXS_TCPIP_PACKET | RXS_UDPIP_PACKET | RXS_CRC));
 
-    NT_ASSERT(!(isIpv4 && isIpv6));
+    // RXS_IPV6RSS_IS_IPV4 (BIT_14) and RXS_IPV6RSS_IS_IPV6 (BIT_15) map to
+    // RT_RX_CHECKSUM_INDEX_IPV4 and RT_RX_CHECKSUM_INDEX_IPV6
+    UINT8 const layer3 = (UINT8)((rxd->RxDescDataIpv6Rss.IpRssTava &
+        (RXS_IPV6RSS_IS_IPV4 | RXS_IPV6RSS_IS_IPV6)) >> 10);
 
-    if (isIpv4)
-    {
-        packet->Layout.Layer3Type = NetPacketLayer3TypeIPv4UnspecifiedOptions;
+    return status | layer3 | RxGetLayer4FailureIndexBits<ChipType>(rxd);
+}
 
-        if (adapter->IpHwChkSum)
-        {
-            checksumInfo->Layer3 =
-                (rxd->RxDescDataIpv6Rss.status & RXS_IPF)
-                ? NetPacketRxChecksumEvaluationInvalid
-                : NetPacketRxChecksumEvaluationValid;
-        }
-    }
-    else if (isIpv6)
-    {
-        packet->Layout.Layer3Type = NetPacketLayer3TypeIPv6UnspecifiedExtensions;
-    }
-    else
-    {
-        return;
-    }
+static
+UINT8
+RxChecksumEvaluation(
+    _In_ UINT32 index,
+    _In_ UINT32 failureBit
+    )
+{
+    return (UINT8)((index & failureBit)
+        ? NetPacketRxChecksumEvaluationInvalid
+        : NetPacketRxChecksumEvaluationValid);
+}
 
-    USHORT const isTcp = rxd->RxDescDataIpv6Rss.status & RXS_TCPIP_PACKET;
-    USHORT const isUdp = rxd->RxDescDataIpv6Rss.status & RXS_UDPIP_PACKET;
+void
+RtAdapterUpdateRxChecksumTable(
+    _In_ RT_ADAPTER *adapter
+    )
+{
+    for (UINT32 index = 0; index < ARRAYSIZE(adapter->RxChecksumTable); index++)
+    {
+        RT_RX_CHECKSUM_INFO info = {};
 
-    NT_ASSERT(!(isTcp && isUdp));
+        info.Layer2 = RxChecksumEvaluation(index, RT_RX_CHECKSUM_INDEX_CRC);
 
-    if (isTcp)
-    {
-        packet->Layout.Layer4Type = NetPacketLayer4TypeTcp;
+        // The hardware never reports both; treat such a descriptor as IPv4
+        // the same way the per-packet decode used to.
+        if (index & RT_RX_CHECKSUM_INDEX_IPV4)
+        {
+            info.Layer3Type = (UINT8)NetPacketLayer3TypeIPv4UnspecifiedOptions;
 
-        if (adapter->TcpHwChkSum)
+            if (adapter->IpHwChkSum)
+            {
+                info.Layer3 = RxChecksumEvaluation(index, RT_RX_CHECKSUM_INDEX_IPF);
+            }
+        }
+        else if (index & RT_RX_CHECKSUM_INDEX_IPV6)
         {
-            checksumInfo->Layer4 =
-                (rxd->RxDescDataIpv6Rss.IpRssTava & RXS_IPV6RSS_TCPF)
-                ? NetPacketRxChecksumEvaluationInvalid
-                : NetPacketRxChecksumEvaluationValid;
+            info.Layer3Type = (UINT8)NetPacketLayer3TypeIPv6UnspecifiedExtensions;
         }
-    }
-    else if (isUdp)
-    {
-        packet->Layout.Layer4Type = NetPacketLayer4TypeUdp;
 
-        if (adapter->UdpHwChkSum)
+        if (info.Layer3Type != NetPacketLayer3TypeUnspecified)
         {
-            checksumInfo->Layer4 =
-                (rxd->RxDescDataIpv6Rss.IpRssTava & RXS_IPV6RSS_UDPF)
-                ? NetPacketRxChecksumEvaluationInvalid
-                : NetPacketRxChecksumEvaluationValid;
+            if (index & RT_RX_CHECKSUM_INDEX_TCP)
+            {
+                info.Layer4Type = (UINT8)NetPacketLayer4TypeTcp;
+
+                if (adapter->TcpHwChkSum)
+                {
+                    info.Layer4 = RxChecksumEvaluation(index, RT_RX_CHECKSUM_INDEX_TCPF);
+                }
+            }
+            else if (index & RT_RX_CHECKSUM_INDEX_UDP)
+            {
+                info.Layer4Type = (UINT8)NetPacketLayer4TypeUdp;
+
+                if (adapter->UdpHwChkSum)
+                {
+                    info.Layer4 = RxChecksumEvaluation(index, RT_RX_CHECKSUM_INDEX_UDPF);
+                }
+            }
         }
+
+        adapter->RxChecksumTable[index] = info;
     }
 }
 
+template <RT_CHIP_TYPE ChipType>
 static
 void
-RxFillRtl8111EChecksumInfo(
+RtFillRxChecksumInfo(
     _In_    RT_RXQUEUE const *rx,
     _In_    RT_RX_DESC const *rxd,
     _In_    UINT32 packetIndex,
     _Inout_ NET_PACKET *packet
     )
 {
-    RT_ADAPTER* adapter = rx->Adapter;
+    RT_RX_CHECKSUM_INFO const info =
+        rx->Adapter->RxChecksumTable[RxGetChecksumIndex<ChipType>(rxd)];
+
+    packet->Layout = {};
+    packet->Layout.Layer2Type = NetPacketLayer2TypeEthernet;
+    packet->Layout.Layer3Type = info.Layer3Type;
+    packet->Layout.Layer4Type = info.Layer4Type;
+
     NET_PACKET_CHECKSUM* checksumInfo =
         NetExtensionGetPacketChecksum(
             &rx->ChecksumExtension,
             packetIndex);
 
-    packet->Layout.Layer2Type = NetPacketLayer2TypeEthernet;
-    checksumInfo->Layer2 =
-        (rxd->RxDescDataIpv6Rss.status & RXS_CRC)
-        ? NetPacketRxChecksumEvaluationInvalid
-        : NetPacketRxChecksumEvaluationValid;
-
-    USHORT const isIpv4 = rxd->RxDescDataIpv6Rss.IpRssTava & RXS_IPV6RSS_IS_IPV4;
-    USHORT const isIpv6 = rxd->RxDescDataIpv6Rss.IpRssTava & RXS_IPV6RSS_IS_IPV6;
-
-    NT_ASSERT(!(isIpv4 && isIpv6));
-
-    if (isIpv4)
-    {
-        packet->Layout.Layer3Type = NetPacketLayer3TypeIPv4UnspecifiedOptions;
-
-        if (adapter->IpHwChkSum)
-        {
-            checksumInfo->Layer3 =
-                (rxd->RxDescDataIpv6Rss.status & RXS_IPF)
-                ? NetPacketRxChecksumEvaluationInvalid
-                : NetPacketRxChecksumEvaluationValid;
-        }
-    }
-    else if (isIpv6)
-    {
-        packet->Layout.Layer3Type = NetPacketLayer3TypeIPv6UnspecifiedExtensions;
-    }
-    else
-    {
-        return;
-    }
-
-    USHORT const isTcp = rxd->RxDescDataIpv6Rss.status & RXS_TCPIP_PACKET;
-    USHORT const isUdp = rxd->RxDescDataIpv6Rss.status & RXS_UDPIP_PACKET;
+    checksumInfo->Layer2 = (NET_PACKET_RX_CHECKSUM_EVALUATION)info.Layer2;
+    checksumInfo->Layer3 = (NET_PACKET_RX_CHECKSUM_EVALUATION)info.Layer3;
+    checksumInfo->Layer4 = (NET_PACKET_RX_CHECKSUM_EVALUATION)info.Layer4;
+}
 
-    NT_ASSERT(!(isTcp && isUdp));
+static
+void
+RtFillRxIeee8021qInfo(
+    _In_ RT_RXQUEUE const *rx,
+    _In_ RT_RX_DESC const *rxd,
+    _In_ UINT32 packetIndex
+    )
+{
+    NET_PACKET_IEEE8021Q* ieee8021q =
+        NetExtensionGetPacketIeee8021Q(
+            &rx->Ieee8021qExtension,
+            packetIndex);
 
-    if (isTcp)
-    {
-        packet->Layout.Layer4Type = NetPacketLayer4TypeTcp;
+    *ieee8021q = {};
 
-        if (adapter->TcpHwChkSum)
-        {
-            checksumInfo->Layer4 =
-                (rxd->RxDescDataIpv6Rss.TcpUdpFailure & TXS_TCPCS)
-                ? NetPacketRxChecksumEvaluationInvalid
-                : NetPacketRxChecksumEvaluationValid;
-        }
-    }
-    else if (isUdp)
+    // The tag stripped by the hardware is reported in network byte order
+    if (0 != (rxd->RxDescDataIpv6Rss.IpRssTava & RXS_IPV6RSS_TAVA))
     {
-        packet->Layout.Layer4Type = NetPacketLayer4TypeUdp;
+        RT_TAG_802_1Q const tag = rxd->RxDescDataIpv6Rss.VLAN_TAG;
 
-        if (adapter->UdpHwChkSum)
-        {
-            checksumInfo->Layer4 =
-                (rxd->RxDescDataIpv6Rss.TcpUdpFailure & TXS_UDPCS)
-                ? NetPacketRxChecksumEvaluationInvalid
-                : NetPacketRxChecksumEvaluationValid;
-        }
+        ieee8021q->VlanIdentifier =
+            (tag.TagHeader.VLanID1 << 8) | tag.TagHeader.VLanID2;
+        ieee8021q->PriorityCodePoint = tag.TagHeader.Priority;
     }
 }
 
+// How far ahead of the scan RxIndicateReceives prefetches, in ring slots.
+// Four receive descriptors share a cache line, so this keeps the next line
+// of descriptors in flight while the current one is processed.
+#define RT_RX_PREFETCH_DISTANCE 4
+
+// Returns the number of descriptors holding the frame that starts at the
+// iterator position, or 0 if the hardware has not released all of them yet.
 static
-void
-RtFillRxChecksumInfo(
-    _In_    RT_RXQUEUE const *rx,
-    _In_    RT_RX_DESC const *rxd,
-    _In_    UINT32 packetIndex,
-    _Inout_ NET_PACKET *packet
+UINT32
+RxGetFrameDescriptorCount(
+    _In_ RT_RXQUEUE const *rx,
+    _In_ NET_RING_FRAGMENT_ITERATOR fi
     )
 {
-    packet->Layout = {};
-
-    switch (rx->Adapter->ChipType)
+    for (UINT32 count = 1; NetFragmentIteratorHasAny(&fi); count++)
     {
-    case RTL8168D:
-        RxFillRtl8111DChecksumInfo(rx, rxd, packetIndex, packet);
-        break;
-    case RTL8168D_REV_C_REV_D:
-    case RTL8168E:
-        RxFillRtl8111EChecksumInfo(rx, rxd, packetIndex, packet);
-        break;
+        USHORT const status =
+            rx->RxdBase[NetFragmentIteratorGetIndex(&fi)].RxDescDataIpv6Rss.status;
+
+        if (0 != (status & RXS_OWN))
+            break;
+
+        if (0 != (status & RXS_LS))
+            return count;
+
+        NetFragmentIteratorAdvance(&fi);
     }
+
+    return 0;
 }
 
-void
+template <RT_CHIP_TYPE ChipType>
+static
+bool
 RxIndicateReceives(
-    _In_ RT_RXQUEUE *rx
+    _In_ RT_RXQUEUE *rx,
+    _In_ UINT32 budget
     )
 {
+    NET_RING * fr = NetRingCollectionGetFragmentRing(rx->Rings);
+    NET_RING * pr = NetRingCollectionGetPacketRing(rx->Rings);
     NET_RING_FRAGMENT_ITERATOR fi = NetRingGetDrainFragments(rx->Rings);
     NET_RING_PACKET_ITERATOR pi = NetRingGetAllPackets(rx->Rings);
-    while (NetFragmentIteratorHasAny(&fi))
+    for (UINT32 indicated = 0; NetFragmentIteratorHasAny(&fi) && NetPacketIteratorHasAny(&pi); indicated++)
     {
-        UINT32 index = NetFragmentIteratorGetIndex(&fi);
-        RT_RX_DESC const * rxd = &rx->RxdBase[index];
+        // Start pulling in the descriptors and packet of the frames that
+        // follow; the status check below would otherwise stall on each miss
+        UINT32 const fragmentIndex = NetFragmentIteratorGetIndex(&fi);
+        UINT32 const packetIndex = NetPacketIteratorGetIndex(&pi);
+        PreFetchCacheLine(PF_TEMPORAL_LEVEL_1,
+            &rx->RxdBase[(fragmentIndex + RT_RX_PREFETCH_DISTANCE) & fr->ElementIndexMask]);
+        PreFetchCacheLine(PF_TEMPORAL_LEVEL_1,
+            NetRingGetPacketAtIndex(pr, (packetIndex + RT_RX_PREFETCH_DISTANCE) & pr->ElementIndexMask));
+
+        // A frame larger than the receive buffer is spread by the hardware
+        // over consecutive descriptors, from RXS_FS to RXS_LS.
+        UINT32 const fragmentCount = RxGetFrameDescriptorCount(rx, fi);
+
+        if (fragmentCount == 0)
+            break;
 
-        if (0 != (rxd->RxDescDataIpv6Rss.status & RXS_OWN))
+        // Leave the rest for the next advance. Having made progress, this
+        // one will be followed by another before notification is re-armed.
+        if (indicated == budget)
+        {
+            rx->Statistics->Counters.BudgetExhausted++;
             break;
+        }
 
-        NET_FRAGMENT * fragment = NetFragmentIteratorGetFragment(&fi);
-        fragment->ValidLength = rxd->RxDescDataIpv6Rss.length - FRAME_CRC_SIZE;
-        fragment->Offset = 0;
+        // A chain that does not begin with RXS_FS is the tail of a frame
+        // whose start was lost, e.g. to a reset or an overrun. Its buffers
+        // are returned through an ignored packet.
+        bool const firstSegment =
+            0 != (rx->RxdBase[fragmentIndex].RxDescDataIpv6Rss.status & RXS_FS);
 
         NET_PACKET * packet = NetPacketIteratorGetPacket(&pi);
-        packet->FragmentIndex = index;
-        packet->FragmentCount = 1;
+        packet->FragmentIndex = fragmentIndex;
+        packet->FragmentCount = static_cast<UINT16>(fragmentCount);
+        packet->Ignore = ! firstSegment;
+
+        // The last descriptor reports the length of the whole frame,
+        // including the CRC, along with the checksum and layout status.
+        UINT32 const lastIndex =
+            (packet->FragmentIndex + fragmentCount - 1) & fr->ElementIndexMask;
+        RT_RX_DESC const * rxd = &rx->RxdBase[lastIndex];
+
+        UINT32 const packetLength = rxd->RxDescDataIpv6Rss.length - FRAME_CRC_SIZE;
+
+        // Every fragment but the last is filled to capacity; the CRC is
+        // dropped from the tail. When the last descriptor held nothing but
+        // CRC, its fragment stays in the packet with no valid data, so the
+        // buffer goes back to the framework with the rest of the packet.
+        UINT32 remaining = packetLength;
+        for (UINT32 i = 0; i < fragmentCount; i++)
+        {
+            NET_FRAGMENT * fragment = NetFragmentIteratorGetFragment(&fi);
+            fragment->ValidLength = min(fragment->Capacity, (UINT64)remaining);
+            fragment->Offset = 0;
+
+            remaining -= static_cast<UINT32>(fragment->ValidLength);
+
+            NetFragmentIteratorAdvance(&fi);
+        }
+
+        if (packet->Ignore)
+        {
+            NetPacketIteratorAdvance(&pi);
+            continue;
+        }
 
         if (rx->ChecksumExtension.Enabled)
         {
             // fill packetTcpChecksum
-            RtFillRxChecksumInfo(rx, rxd, NetPacketIteratorGetIndex(&pi), packet);
+            RtFillRxChecksumInfo<ChipType>(rx, rxd, NetPacketIteratorGetIndex(&pi), packet);
+        }
+
+        if (rx->Ieee8021qExtension.Enabled)
+        {
+            RtFillRxIeee8021qInfo(rx, rxd, NetPacketIteratorGetIndex(&pi));
         }
 
-        RtUpdateRecvStats(rx, rxd, fragment->ValidLength);
+        RtUpdateRecvStats(rx, rxd, packetLength);
 
-        NetFragmentIteratorAdvance(&fi);
         NetPacketIteratorAdvance(&pi);
     }
     NetFragmentIteratorSet(&fi);
     NetPacketIteratorSet(&pi);
+
+    // The scan stops at the first descriptor it leaves behind; if the
+    // hardware has released that one, it is not free to receive into
+    return NetFragmentIteratorHasAny(&fi) &&
+        0 == (rx->RxdBase[NetFragmentIteratorGetIndex(&fi)].RxDescDataIpv6Rss.status & RXS_OWN);
 }
 
+// Writes everything but the status word, which hands the descriptor to the
+// hardware and must only be written once the rest is visible.
 static
 void
 RtPostRxDescriptor(
     _In_ RT_RX_DESC * desc,
     _In_ NET_FRAGMENT const * fragment,
-    _In_ NET_FRAGMENT_LOGICAL_ADDRESS const * logicalAddress,
-    _In_ UINT16 status
+    _In_ NET_FRAGMENT_LOGICAL_ADDRESS const * logicalAddress
     )
 {
     desc->BufferAddress = logicalAddress->LogicalAddress;
     desc->RxDescDataIpv6Rss.TcpUdpFailure = 0;
     desc->RxDescDataIpv6Rss.length = fragment->Capacity;
     desc->RxDescDataIpv6Rss.VLAN_TAG.Value = 0;
-
-    MemoryBarrier();
-
-    desc->RxDescDataIpv6Rss.status = status;
 }
 
 static
 void
 RxPostBuffers(
-    _In_ RT_RXQUEUE *rx
+    _In_ RT_RXQUEUE *rx,
+    _In_ bool backlog
     )
 {
     NET_RING * fr = NetRingCollectionGetFragmentRing(rx->Rings);
     NET_RING_FRAGMENT_ITERATOR fi = NetRingGetPostFragments(rx->Rings);
+    NET_RING_FRAGMENT_ITERATOR const posted = NetRingGetDrainFragments(rx->Rings);
+
+    // Hold returned buffers until there is a batch worth posting, unless
+    // the hardware is running low on descriptors to receive into. The
+    // posted range only tells how many the hardware owns when no completed
+    // frames were left on it, so with a backlog everything is posted.
+    if (! backlog &&
+        NetFragmentIteratorGetCount(&fi) < rx->PostBatch &&
+        NetFragmentIteratorGetCount(&posted) >= rx->PostLowWater)
+    {
+        return;
+    }
+
+    NET_RING_FRAGMENT_ITERATOR const batch = fi;
 
     while (NetFragmentIteratorHasAny(&fi))
     {
@@ -298,10 +416,21 @@ RxPostBuffers(
 
         RtPostRxDescriptor(&rx->RxdBase[index],
             NetFragmentIteratorGetFragment(&fi),
-            logicalAddress,
-            RXS_OWN | (fr->ElementIndexMask == index ? RXS_EOR : 0));
+            logicalAddress);
         NetFragmentIteratorAdvance(&fi);
     }
+
+    // One barrier covers the whole batch
+    MemoryBarrier();
+
+    for (NET_RING_FRAGMENT_ITERATOR oi = batch; NetFragmentIteratorHasAny(&oi); NetFragmentIteratorAdvance(&oi))
+    {
+        UINT32 const index = NetFragmentIteratorGetIndex(&oi);
+
+        rx->RxdBase[index].RxDescDataIpv6Rss.status =
+            RXS_OWN | (fr->ElementIndexMask == index ? RXS_EOR : 0);
+    }
+
     NetFragmentIteratorSet(&fi);
 }
 
@@ -316,9 +445,15 @@ RtRxQueueInitialize(
     RT_RXQUEUE *rx = RtGetRxQueueContext(rxQueue);
 
     rx->Adapter = adapter;
-    rx->Interrupt = adapter->Interrupt;
+    rx->Interrupt = adapter->RxInterrupt[rx->QueueId];
     rx->Rings = NetRxQueueGetRingCollection(rxQueue);
 
+    // Replenish thresholds come from the RxPostBatch and RxPostLowWater
+    // keywords; neither can exceed the ring.
+    NET_RING * fr = NetRingCollectionGetFragmentRing(rx->Rings);
+    rx->PostBatch = min(adapter->RxPostBatch, fr->NumberOfElements);
+    rx->PostLowWater = min(adapter->RxPostLowWater, fr->NumberOfElements);
+
     // allocate descriptors
     NET_RING * pr = NetRingCollectionGetPacketRing(rx->Rings);
     UINT32 const rxdSize = pr->NumberOfElements * sizeof(RT_RX_DESC);
@@ -332,6 +467,26 @@ RtRxQueueInitialize(
     rx->RxdBase = static_cast<RT_RX_DESC*>(WdfCommonBufferGetAlignedVirtualAddress(rx->RxdArray));
     rx->RxdSize = rxdSize;
 
+    // Object contexts carry no cache alignment, see statistics.h
+    WDF_OBJECT_ATTRIBUTES statisticsAttributes;
+    WDF_OBJECT_ATTRIBUTES_INIT(&statisticsAttributes);
+    statisticsAttributes.ParentObject = rxQueue;
+    WDFMEMORY statisticsMemory;
+    void * statistics;
+
+    GOTO_IF_NOT_NT_SUCCESS(Exit, status,
+        WdfMemoryCreate(
+            &statisticsAttributes,
+            NonPagedPoolNx,
+            0,
+            sizeof(RT_RX_QUEUE_STATISTICS) + SYSTEM_CACHE_ALIGNMENT_SIZE - 1,
+            &statisticsMemory,
+            &statistics));
+
+    rx->Statistics = static_cast<RT_RX_QUEUE_STATISTICS*>(
+        ALIGN_UP_POINTER_BY(statistics, SYSTEM_CACHE_ALIGNMENT_SIZE));
+    RtlZeroMemory(rx->Statistics, sizeof(*rx->Statistics));
+
 Exit:
     return status;
 }
@@ -391,6 +546,17 @@ EvtRxQueueStart(
 
     RtlZeroMemory(rx->RxdBase, rx->RxdSize);
 
+    switch (adapter->ChipType)
+    {
+    case RTL8168D:
+        rx->IndicateReceives = RxIndicateReceives<RTL8168D>;
+        break;
+    default:
+        // RTL8168D_REV_C_REV_D shares the RTL8168E receive descriptor layout
+        rx->IndicateReceives = RxIndicateReceives<RTL8168E>;
+        break;
+    }
+
     PHYSICAL_ADDRESS pa = WdfCommonBufferGetAlignedLogicalAddress(rx->RxdArray);
     if (rx->QueueId == 0)
     {
@@ -423,6 +589,9 @@ EvtRxQueueStop(
 {
     RT_RXQUEUE *rx = RtGetRxQueueContext(rxQueue);
 
+    // Flushes DPCs, which may be waiting on the adapter lock; so not under it
+    RtRxQueueSetInterrupt(rx, false);
+
     WdfSpinLockAcquire(rx->Adapter->Lock);
 
     bool count = 0;
@@ -439,9 +608,10 @@ EvtRxQueueStop(
         rx->Adapter->CSRAddress->CmdReg &= ~CR_RE;
     }
 
-    RtRxQueueSetInterrupt(rx, false);
     rx->Adapter->RxQueues[rx->QueueId] = WDF_NO_HANDLE;
 
+    RtAdapterRetireRxStatistics(rx->Adapter, &rx->Statistics->Counters);
+
     WdfSpinLockRelease(rx->Adapter->Lock);
 }
 
@@ -487,8 +657,8 @@ EvtRxQueueAdvance(
 
     RT_RXQUEUE *rx = RtGetRxQueueContext(rxQueue);
 
-    RxIndicateReceives(rx);
-    RxPostBuffers(rx);
+    bool const backlog = rx->IndicateReceives(rx, rx->Adapter->PollBudget);
+    RxPostBuffers(rx, backlog);
 
     TraceExit();
 }
@@ -514,7 +684,8 @@ EvtRxQueueCancel(
     // try (but not very hard) to grab anything that may have been
     // indicated during rx disable. advance will continue to be called
     // after cancel until all packets are returned to the framework.
-    RxIndicateReceives(rx);
+    // Everything left over is dropped below, so no poll budget applies.
+    rx->IndicateReceives(rx, ULONG_MAX);
 
     NET_RING_PACKET_ITERATOR pi = NetRingGetAllPackets(rx->Rings);
     while(NetPacketIteratorHasAny(&pi))
@@ -11,6 +11,16 @@
 
 #pragma once
 
+struct RT_RXQUEUE;
+
+// Returns true if frames the hardware has already completed were left on
+// the ring, because of the budget or for lack of packets to indicate them in
+typedef
+bool
+RT_RX_INDICATE_RECEIVES(
+    _In_ RT_RXQUEUE *rx,
+    _In_ UINT32 budget);
+
 struct RT_RXQUEUE
 {
     RT_ADAPTER *Adapter;
@@ -23,9 +33,20 @@ struct RT_RXQUEUE
     size_t RxdSize;
 
     NET_EXTENSION ChecksumExtension;
+    NET_EXTENSION Ieee8021qExtension;
     NET_EXTENSION LogicalAddressExtension;
 
     ULONG QueueId;
+
+    // Replenish thresholds, see RxPostBuffers
+    UINT32 PostBatch;
+    UINT32 PostLowWater;
+
+    RT_RX_QUEUE_STATISTICS *Statistics;
+
+    // Receive indication specialized for the adapter's chip type,
+    // selected when the queue is started
+    RT_RX_INDICATE_RECEIVES *IndicateReceives;
 };
 
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(RT_RXQUEUE, RtGetRxQueueContext);
@@ -35,6 +56,8 @@ NTSTATUS RtRxQueueInitialize(_In_ NETPACKETQUEUE rxQueue, _In_ RT_ADAPTER * adap
 _Requires_lock_held_(adapter->Lock)
 void RtAdapterUpdateRcr(_In_ RT_ADAPTER *adapter);
 
+void RtAdapterUpdateRxChecksumTable(_In_ RT_ADAPTER *adapter);
+
 EVT_WDF_OBJECT_CONTEXT_DESTROY EvtRxQueueDestroy;
 
 EVT_PACKET_QUEUE_SET_NOTIFICATION_ENABLED EvtRxQueueSetNotificationEnabled;
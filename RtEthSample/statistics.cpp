@@ -0,0 +1,356 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#include "precomp.h"
+
+#include "trace.h"
+#include "device.h"
+#include "statistics.h"
+#include "adapter.h"
+#include "rxqueue.h"
+#include "txqueue.h"
+
+// The queue counters are read while the datapath may be updating them;
+// ReadULong64NoFence keeps the 64-bit reads from tearing on 32-bit targets.
+#define RT_ACCUMULATE(total, queue, field) \
+    ((total)->field += ReadULong64NoFence(&(queue)->field))
+
+static
+void
+RtAccumulateRxStatistics(
+    _Inout_ RT_RX_STATISTICS *total,
+    _In_ RT_RX_STATISTICS const *queue
+    )
+{
+    RT_ACCUMULATE(total, queue, Packets);
+    RT_ACCUMULATE(total, queue, Bytes);
+    RT_ACCUMULATE(total, queue, UcastOctets);
+    RT_ACCUMULATE(total, queue, MulticastOctets);
+    RT_ACCUMULATE(total, queue, BroadcastOctets);
+    RT_ACCUMULATE(total, queue, BudgetExhausted);
+}
+
+static
+void
+RtAccumulateTxStatistics(
+    _Inout_ RT_TX_STATISTICS *total,
+    _In_ RT_TX_STATISTICS const *queue
+    )
+{
+    RT_ACCUMULATE(total, queue, Packets);
+    RT_ACCUMULATE(total, queue, Bytes);
+    RT_ACCUMULATE(total, queue, UcastPkts);
+    RT_ACCUMULATE(total, queue, MulticastPkts);
+    RT_ACCUMULATE(total, queue, BroadcastPkts);
+    RT_ACCUMULATE(total, queue, UcastOctets);
+    RT_ACCUMULATE(total, queue, MulticastOctets);
+    RT_ACCUMULATE(total, queue, BroadcastOctets);
+    RT_ACCUMULATE(total, queue, BudgetExhausted);
+    RT_ACCUMULATE(total, queue, Doorbells);
+}
+
+// The MAC keeps its tally counters in registers and DMAs them to host memory
+// on request. Rather than waiting for a dump whenever statistics are
+// wanted, a periodic timer collects the result of the previous dump and
+// starts the next one. The driver has no statistics query path of its own;
+// each period the accumulated totals are written to the Statistics trace
+// event, and RtAdapterStopTally collects the last dump before D0 exit.
+//
+// The narrow counters can wrap; deltas are taken at the counter's own width.
+// A 16-bit counter that wraps more than once per period (e.g. MissPkt under
+// sustained overload) is undercounted.
+#define RT_TALLY_PERIOD_MS 1000
+
+// How long RtAdapterStopTally waits for a dump already in progress
+#define RT_TALLY_STOP_POLL_TIME 10 // 10us
+#define RT_TALLY_STOP_POLL_COUNT 100 // 1ms total
+
+#define RT_TALLY_DELTA(tally, last, field) \
+    ((decltype((tally)->field))((tally)->field - (last)->field))
+
+_Requires_lock_held_(adapter->Lock)
+static
+void
+RtAdapterAccumulateTally(
+    _In_ RT_ADAPTER *adapter,
+    _In_ RT_TALLY const *tally
+    )
+{
+    RT_HW_STATISTICS *hw = &adapter->Statistics.Hw;
+    RT_TALLY const *last = &adapter->LastTally;
+
+    hw->TxOk                += RT_TALLY_DELTA(tally, last, TxOK);
+    hw->RxOk                += RT_TALLY_DELTA(tally, last, RxOK);
+    hw->TxErr               += RT_TALLY_DELTA(tally, last, TxERR);
+    hw->RxErr               += RT_TALLY_DELTA(tally, last, RxERR);
+    hw->MissPkt             += RT_TALLY_DELTA(tally, last, MissPkt);
+    hw->FrameAlignmentErr   += RT_TALLY_DELTA(tally, last, FAE);
+    hw->TxOneCollision      += RT_TALLY_DELTA(tally, last, Tx1Col);
+    hw->TxMultipleCollision += RT_TALLY_DELTA(tally, last, TxMCol);
+    hw->RxOkPhy             += RT_TALLY_DELTA(tally, last, RxOKPhy);
+    hw->RxOkBroadcast       += RT_TALLY_DELTA(tally, last, RxOKBrd);
+    hw->RxOkMulticast       += RT_TALLY_DELTA(tally, last, RxOKMul);
+    hw->TxAbort             += RT_TALLY_DELTA(tally, last, TxAbt);
+    hw->TxUnderrun          += RT_TALLY_DELTA(tally, last, TxUndrn);
+}
+
+static
+void
+RtAdapterIssueTallyDump(
+    _In_ RT_ADAPTER *adapter
+    )
+{
+    adapter->CSRAddress->DTCCRHigh = adapter->TallyPhy.HighPart;
+    adapter->CSRAddress->DTCCRLow = adapter->TallyPhy.LowPart | DTCCR_Cmd;
+}
+
+static
+void
+RtAdapterCollectTallyDump(
+    _In_ RT_ADAPTER *adapter
+    )
+{
+    // Caller has seen DTCCR_Cmd clear, the dump is in the tally buffer
+    KeMemoryBarrier();
+
+    RT_TALLY const tally = *adapter->GTally;
+
+    WdfSpinLockAcquire(adapter->Lock); {
+
+        // The first dump after D0 entry only sets the baseline, the
+        // hardware counters may have been reset in low power
+        if (adapter->TallyBaselineValid)
+        {
+            RtAdapterAccumulateTally(adapter, &tally);
+        }
+
+        adapter->LastTally = tally;
+        adapter->TallyBaselineValid = true;
+
+    } WdfSpinLockRelease(adapter->Lock);
+}
+
+static
+void
+RtAdapterTraceStatistics(
+    _In_ RT_ADAPTER *adapter
+    )
+{
+    RT_STATISTICS statistics;
+    RtAdapterQueryStatistics(adapter, &statistics);
+
+    TraceLoggingWrite(
+        RealtekTraceProvider,
+        "Statistics",
+        TraceLoggingLevel(TRACE_LEVEL_INFORMATION),
+        TraceLoggingRtAdapter(adapter),
+        TraceLoggingUInt64(statistics.Rx.Packets, "RxPackets"),
+        TraceLoggingUInt64(statistics.Rx.Bytes, "RxBytes"),
+        TraceLoggingUInt64(statistics.Rx.UcastOctets, "RxUcastOctets"),
+        TraceLoggingUInt64(statistics.Rx.MulticastOctets, "RxMulticastOctets"),
+        TraceLoggingUInt64(statistics.Rx.BroadcastOctets, "RxBroadcastOctets"),
+        TraceLoggingUInt64(statistics.Rx.BudgetExhausted, "RxBudgetExhausted"),
+        TraceLoggingUInt64(statistics.Tx.Packets, "TxPackets"),
+        TraceLoggingUInt64(statistics.Tx.Bytes, "TxBytes"),
+        TraceLoggingUInt64(statistics.Tx.UcastPkts, "TxUcastPkts"),
+        TraceLoggingUInt64(statistics.Tx.MulticastPkts, "TxMulticastPkts"),
+        TraceLoggingUInt64(statistics.Tx.BroadcastPkts, "TxBroadcastPkts"),
+        TraceLoggingUInt64(statistics.Tx.UcastOctets, "TxUcastOctets"),
+        TraceLoggingUInt64(statistics.Tx.MulticastOctets, "TxMulticastOctets"),
+        TraceLoggingUInt64(statistics.Tx.BroadcastOctets, "TxBroadcastOctets"),
+        TraceLoggingUInt64(statistics.Tx.BudgetExhausted, "TxBudgetExhausted"),
+        TraceLoggingUInt64(statistics.Tx.Doorbells, "TxDoorbells"),
+        TraceLoggingUInt64(statistics.Hw.TxOk, "HwTxOk"),
+        TraceLoggingUInt64(statistics.Hw.RxOk, "HwRxOk"),
+        TraceLoggingUInt64(statistics.Hw.TxErr, "HwTxErr"),
+        TraceLoggingUInt64(statistics.Hw.RxErr, "HwRxErr"),
+        TraceLoggingUInt64(statistics.Hw.MissPkt, "HwMissPkt"),
+        TraceLoggingUInt64(statistics.Hw.FrameAlignmentErr, "HwFrameAlignmentErr"),
+        TraceLoggingUInt64(statistics.Hw.TxOneCollision, "HwTxOneCollision"),
+        TraceLoggingUInt64(statistics.Hw.TxMultipleCollision, "HwTxMultipleCollision"),
+        TraceLoggingUInt64(statistics.Hw.RxOkPhy, "HwRxOkPhy"),
+        TraceLoggingUInt64(statistics.Hw.RxOkBroadcast, "HwRxOkBroadcast"),
+        TraceLoggingUInt64(statistics.Hw.RxOkMulticast, "HwRxOkMulticast"),
+        TraceLoggingUInt64(statistics.Hw.TxAbort, "HwTxAbort"),
+        TraceLoggingUInt64(statistics.Hw.TxUnderrun, "HwTxUnderrun"));
+}
+
+static
+void
+EvtTallyTimer(
+    _In_ WDFTIMER timer
+    )
+{
+    RT_ADAPTER *adapter = RtGetDeviceContext(WdfTimerGetParentObject(timer))->Adapter;
+
+    if (adapter->TallyDumpPending)
+    {
+        // The hardware clears DTCCR_Cmd once the dump has been written;
+        // if it is still busy, look again next period.
+        if (0 != (adapter->CSRAddress->DTCCRLow & DTCCR_Cmd))
+        {
+            return;
+        }
+
+        RtAdapterCollectTallyDump(adapter);
+        RtAdapterTraceStatistics(adapter);
+    }
+
+    RtAdapterIssueTallyDump(adapter);
+    adapter->TallyDumpPending = true;
+}
+
+NTSTATUS
+RtAdapterInitializeTally(
+    _In_ RT_ADAPTER *adapter
+    )
+{
+    WDF_TIMER_CONFIG timerConfig;
+    WDF_TIMER_CONFIG_INIT_PERIODIC(&timerConfig, EvtTallyTimer, RT_TALLY_PERIOD_MS);
+
+    WDF_OBJECT_ATTRIBUTES attributes;
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = adapter->WdfDevice;
+
+    return WdfTimerCreate(&timerConfig, &attributes, &adapter->TallyTimer);
+}
+
+NTSTATUS
+RtAdapterAllocateTally(
+    _In_ RT_ADAPTER *adapter
+    )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+
+    // The dump address must be 64-byte aligned
+    WDF_COMMON_BUFFER_CONFIG commonBufferConfig;
+    WDF_COMMON_BUFFER_CONFIG_INIT(&commonBufferConfig, FILE_64_BYTE_ALIGNMENT);
+
+    GOTO_IF_NOT_NT_SUCCESS(Exit, status,
+        WdfCommonBufferCreateWithConfig(
+            adapter->DmaEnabler,
+            sizeof(RT_TALLY),
+            &commonBufferConfig,
+            WDF_NO_OBJECT_ATTRIBUTES,
+            &adapter->HwTallyMemAlloc));
+
+    adapter->GTally = static_cast<RT_TALLY*>(WdfCommonBufferGetAlignedVirtualAddress(adapter->HwTallyMemAlloc));
+    adapter->TallyPhy = WdfCommonBufferGetAlignedLogicalAddress(adapter->HwTallyMemAlloc);
+
+    RtlZeroMemory(adapter->GTally, sizeof(RT_TALLY));
+
+Exit:
+    return status;
+}
+
+void
+RtAdapterStartTally(
+    _In_ RT_ADAPTER *adapter
+    )
+{
+    adapter->TallyDumpPending = false;
+    adapter->TallyBaselineValid = false;
+
+    // Take the baseline right away rather than one period from now
+    WdfTimerStart(adapter->TallyTimer, WDF_REL_TIMEOUT_IN_MS(1));
+}
+
+void
+RtAdapterStopTally(
+    _In_ RT_ADAPTER *adapter
+    )
+{
+    WdfTimerStop(adapter->TallyTimer, TRUE);
+
+    // A dump the timer already started may still be writing to the tally
+    // buffer, which is released along with the hardware. Once it is done
+    // its counts are kept, they cover the time since the last period.
+    if (adapter->TallyDumpPending)
+    {
+        for (UINT32 i = 0; i < RT_TALLY_STOP_POLL_COUNT; i++)
+        {
+            if (0 == (adapter->CSRAddress->DTCCRLow & DTCCR_Cmd))
+            {
+                RtAdapterCollectTallyDump(adapter);
+                break;
+            }
+
+            KeStallExecutionProcessor(RT_TALLY_STOP_POLL_TIME);
+        }
+
+        adapter->TallyDumpPending = false;
+    }
+}
+
+_Use_decl_annotations_
+void
+RtAdapterRetireRxStatistics(
+    RT_ADAPTER *adapter,
+    RT_RX_STATISTICS *statistics
+    )
+{
+    // Fold the counters of a stopping queue into the adapter totals so they
+    // outlive the queue
+    RtAccumulateRxStatistics(&adapter->Statistics.Rx, statistics);
+    RtlZeroMemory(statistics, sizeof(*statistics));
+}
+
+_Use_decl_annotations_
+void
+RtAdapterRetireTxStatistics(
+    RT_ADAPTER *adapter,
+    RT_TX_STATISTICS *statistics
+    )
+{
+    RtAccumulateTxStatistics(&adapter->Statistics.Tx, statistics);
+    RtlZeroMemory(statistics, sizeof(*statistics));
+}
+
+_Use_decl_annotations_
+void
+RtAdapterCollectStatistics(
+    RT_ADAPTER *adapter,
+    RT_STATISTICS *statistics
+    )
+{
+    *statistics = adapter->Statistics;
+
+    for (size_t i = 0; i < ARRAYSIZE(adapter->RxQueues); i++)
+    {
+        if (adapter->RxQueues[i])
+        {
+            RtAccumulateRxStatistics(
+                &statistics->Rx,
+                &RtGetRxQueueContext(adapter->RxQueues[i])->Statistics->Counters);
+        }
+    }
+
+    if (adapter->TxQueue)
+    {
+        RtAccumulateTxStatistics(
+            &statistics->Tx,
+            &RtGetTxQueueContext(adapter->TxQueue)->Statistics->Counters);
+    }
+}
+
+_Use_decl_annotations_
+void
+RtAdapterQueryStatistics(
+    RT_ADAPTER *adapter,
+    RT_STATISTICS *statistics
+    )
+{
+    WdfSpinLockAcquire(adapter->Lock); {
+
+        RtAdapterCollectStatistics(adapter, statistics);
+
+    } WdfSpinLockRelease(adapter->Lock);
+}
@@ -0,0 +1,127 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#pragma once
+
+// Datapath counters. The adapter keeps totals of these, see RT_STATISTICS.
+
+typedef struct _RT_RX_STATISTICS
+{
+    ULONG64 Packets;
+    ULONG64 Bytes;
+
+    ULONG64 UcastOctets;
+    ULONG64 MulticastOctets;
+    ULONG64 BroadcastOctets;
+
+    // Advances that stopped at the poll budget with work left on the ring
+    ULONG64 BudgetExhausted;
+} RT_RX_STATISTICS;
+
+typedef struct _RT_TX_STATISTICS
+{
+    ULONG64 Packets;
+    ULONG64 Bytes;
+
+    ULONG64 UcastPkts;
+    ULONG64 MulticastPkts;
+    ULONG64 BroadcastPkts;
+    ULONG64 UcastOctets;
+    ULONG64 MulticastOctets;
+    ULONG64 BroadcastOctets;
+
+    // Advances that stopped at the poll budget with work left on the ring
+    ULONG64 BudgetExhausted;
+
+    // TPPoll writes; against Packets this gives the doorbells per packet
+    ULONG64 Doorbells;
+} RT_TX_STATISTICS;
+
+// A queue's own counters are only ever written from that queue's advance
+// callback. Each queue allocates its block on its own cache line, apart
+// from the queue context, so queues running on different processors never
+// share one.
+
+typedef struct DECLSPEC_CACHEALIGN _RT_RX_QUEUE_STATISTICS
+{
+    RT_RX_STATISTICS Counters;
+} RT_RX_QUEUE_STATISTICS;
+
+typedef struct DECLSPEC_CACHEALIGN _RT_TX_QUEUE_STATISTICS
+{
+    RT_TX_STATISTICS Counters;
+} RT_TX_QUEUE_STATISTICS;
+
+// Hardware tally counters (RT_TALLY), accumulated into 64-bit totals from
+// the periodic tally dump
+typedef struct _RT_HW_STATISTICS
+{
+    ULONG64 TxOk;
+    ULONG64 RxOk;
+    ULONG64 TxErr;
+    ULONG64 RxErr;
+    ULONG64 MissPkt;
+    ULONG64 FrameAlignmentErr;
+    ULONG64 TxOneCollision;
+    ULONG64 TxMultipleCollision;
+    ULONG64 RxOkPhy;
+    ULONG64 RxOkBroadcast;
+    ULONG64 RxOkMulticast;
+    ULONG64 TxAbort;
+    ULONG64 TxUnderrun;
+} RT_HW_STATISTICS;
+
+typedef struct _RT_STATISTICS
+{
+    RT_RX_STATISTICS Rx;
+    RT_TX_STATISTICS Tx;
+    RT_HW_STATISTICS Hw;
+} RT_STATISTICS;
+
+NTSTATUS
+RtAdapterInitializeTally(
+    _In_ RT_ADAPTER *adapter);
+
+NTSTATUS
+RtAdapterAllocateTally(
+    _In_ RT_ADAPTER *adapter);
+
+void
+RtAdapterStartTally(
+    _In_ RT_ADAPTER *adapter);
+
+void
+RtAdapterStopTally(
+    _In_ RT_ADAPTER *adapter);
+
+_Requires_lock_held_(adapter->Lock)
+void
+RtAdapterRetireRxStatistics(
+    _In_ RT_ADAPTER *adapter,
+    _Inout_ RT_RX_STATISTICS *statistics);
+
+_Requires_lock_held_(adapter->Lock)
+void
+RtAdapterRetireTxStatistics(
+    _In_ RT_ADAPTER *adapter,
+    _Inout_ RT_TX_STATISTICS *statistics);
+
+_Requires_lock_held_(adapter->Lock)
+void
+RtAdapterCollectStatistics(
+    _In_ RT_ADAPTER *adapter,
+    _Out_ RT_STATISTICS *statistics);
+
+_Requires_lock_not_held_(adapter->Lock)
+void
+RtAdapterQueryStatistics(
+    _In_ RT_ADAPTER *adapter,
+    _Out_ RT_STATISTICS *statistics);
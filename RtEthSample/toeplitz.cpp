@@ -0,0 +1,253 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#include "precomp.h"
+
+#include "toeplitz.h"
+
+#if DBG
+
+static
+UINT32
+RtToeplitzKeyWindow(
+    _In_reads_bytes_(keySize) UCHAR const *key,
+    _In_ size_t keySize,
+    _In_ size_t bit
+    )
+{
+    // The 32 key bits starting at bit, counting from the most significant
+    // bit of key[0]. Bits past the end of the key read as zero.
+
+    size_t const byte = bit / 8;
+    ULONG64 window = 0;
+
+    for (size_t i = 0; i < 5; i++)
+    {
+        window <<= 8;
+
+        if (byte + i < keySize)
+        {
+            window |= key[byte + i];
+        }
+    }
+
+    return (UINT32)(window >> (8 - bit % 8));
+}
+
+_Use_decl_annotations_
+void
+RtToeplitzInitialize(
+    RT_TOEPLITZ_TABLE *table,
+    UCHAR const *key,
+    size_t keySize
+    )
+{
+    // Each set input bit selects the key window starting at that bit, so
+    // the table for one nibble holds the xor of the windows of its set bits.
+
+    for (size_t nibble = 0; nibble < ARRAYSIZE(table->Nibble); nibble++)
+    {
+        UINT32 window[4];
+
+        for (size_t i = 0; i < ARRAYSIZE(window); i++)
+        {
+            window[i] = RtToeplitzKeyWindow(key, keySize, nibble * 4 + i);
+        }
+
+        for (UINT32 value = 0; value < ARRAYSIZE(table->Nibble[nibble]); value++)
+        {
+            UINT32 hash = 0;
+
+            for (size_t i = 0; i < ARRAYSIZE(window); i++)
+            {
+                if (value & (8 >> i))
+                {
+                    hash ^= window[i];
+                }
+            }
+
+            table->Nibble[nibble][value] = hash;
+        }
+    }
+}
+
+_Use_decl_annotations_
+UINT32
+RtToeplitzHash(
+    RT_TOEPLITZ_TABLE const *table,
+    UCHAR const *input,
+    size_t length
+    )
+{
+    NT_ASSERT(length <= RT_TOEPLITZ_MAX_INPUT);
+
+    UINT32 hash = 0;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= table->Nibble[i * 2][input[i] >> 4];
+        hash ^= table->Nibble[i * 2 + 1][input[i] & 0xf];
+    }
+
+    return hash;
+}
+
+static
+UINT32
+RtToeplitzHashBitwise(
+    _In_reads_bytes_(keySize) UCHAR const *key,
+    _In_ size_t keySize,
+    _In_reads_bytes_(length) UCHAR const *input,
+    _In_ size_t length
+    )
+{
+    // Reference implementation, straight from the RSS specification
+
+    UINT32 hash = 0;
+
+    for (size_t bit = 0; bit < length * 8; bit++)
+    {
+        if (input[bit / 8] & (0x80 >> (bit % 8)))
+        {
+            hash ^= RtToeplitzKeyWindow(key, keySize, bit);
+        }
+    }
+
+    return hash;
+}
+
+// Verification key and test vectors from the Microsoft RSS specification
+static UCHAR const RtToeplitzVerificationKey[] =
+{
+    0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+    0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+    0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+    0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+    0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa,
+};
+
+typedef struct _RT_TOEPLITZ_VECTOR
+{
+    // Length of the source and destination addresses at the start of Input
+    size_t AddressLength;
+
+    // Hash over the addresses, and over the addresses and ports
+    UINT32 Hash;
+    UINT32 HashWithPorts;
+
+    UCHAR Input[RT_TOEPLITZ_MAX_INPUT];
+} RT_TOEPLITZ_VECTOR;
+
+static RT_TOEPLITZ_VECTOR const RtToeplitzVectors[] =
+{
+    // 66.9.149.187:2794 -> 161.142.100.80:1766
+    {
+        8, 0x323e8fc2, 0x51ccc178,
+        {
+            0x42, 0x09, 0x95, 0xbb, 0xa1, 0x8e, 0x64, 0x50, 0x0a, 0xea, 0x06, 0xe6
+        }
+    },
+    // 199.92.111.2:14230 -> 65.69.140.83:4739
+    {
+        8, 0xd718262a, 0xc626b0ea,
+        {
+            0xc7, 0x5c, 0x6f, 0x02, 0x41, 0x45, 0x8c, 0x53, 0x37, 0x96, 0x12, 0x83
+        }
+    },
+    // 24.19.198.95:12898 -> 12.22.207.184:38024
+    {
+        8, 0xd2d0a5de, 0x5c2b394a,
+        {
+            0x18, 0x13, 0xc6, 0x5f, 0x0c, 0x16, 0xcf, 0xb8, 0x32, 0x62, 0x94, 0x88
+        }
+    },
+    // 38.27.205.30:48228 -> 209.142.163.6:2217
+    {
+        8, 0x82989176, 0xafc7327f,
+        {
+            0x26, 0x1b, 0xcd, 0x1e, 0xd1, 0x8e, 0xa3, 0x06, 0xbc, 0x64, 0x08, 0xa9
+        }
+    },
+    // 153.39.163.191:44251 -> 202.188.127.2:1303
+    {
+        8, 0x5d1809c5, 0x10e828a2,
+        {
+            0x99, 0x27, 0xa3, 0xbf, 0xca, 0xbc, 0x7f, 0x02, 0xac, 0xdb, 0x05, 0x17
+        }
+    },
+    // [3ffe:2501:200:1fff::7]:2794 -> [3ffe:2501:200:3::1]:1766
+    {
+        32, 0x2cc18cd5, 0x40207d3d,
+        {
+            0x3f, 0xfe, 0x25, 0x01, 0x02, 0x00, 0x1f, 0xff, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x07, 0x3f, 0xfe, 0x25, 0x01, 0x02, 0x00, 0x00, 0x03,
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x0a, 0xea, 0x06, 0xe6
+        }
+    },
+    // [3ffe:501:8::260:97ff:fe40:efab]:14230 -> [ff02::1]:4739
+    {
+        32, 0x0f0c461c, 0xdde51bbf,
+        {
+            0x3f, 0xfe, 0x05, 0x01, 0x00, 0x08, 0x00, 0x00, 0x02, 0x60, 0x97, 0xff,
+            0xfe, 0x40, 0xef, 0xab, 0xff, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x37, 0x96, 0x12, 0x83
+        }
+    },
+    // [3ffe:1900:4545:3:200:f8ff:fe21:67cf]:44251 -> [fe80::200:f8ff:fe21:67cf]:38024
+    {
+        32, 0x4b61e985, 0x02d1feef,
+        {
+            0x3f, 0xfe, 0x19, 0x00, 0x45, 0x45, 0x00, 0x03, 0x02, 0x00, 0xf8, 0xff,
+            0xfe, 0x21, 0x67, 0xcf, 0xfe, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x02, 0x00, 0xf8, 0xff, 0xfe, 0x21, 0x67, 0xcf, 0xac, 0xdb, 0x94, 0x88
+        }
+    },
+};
+
+bool
+RtToeplitzSelfTest(
+    void
+    )
+{
+    // Too large for the stack, and only used once from DriverEntry
+    static RT_TOEPLITZ_TABLE table;
+    RtToeplitzInitialize(&table, RtToeplitzVerificationKey, sizeof(RtToeplitzVerificationKey));
+
+    for (size_t i = 0; i < ARRAYSIZE(RtToeplitzVectors); i++)
+    {
+        RT_TOEPLITZ_VECTOR const *vector = &RtToeplitzVectors[i];
+        size_t const length = vector->AddressLength + 2 * sizeof(USHORT);
+
+        if (RtToeplitzHash(&table, vector->Input, vector->AddressLength) != vector->Hash ||
+            RtToeplitzHash(&table, vector->Input, length) != vector->HashWithPorts)
+        {
+            return false;
+        }
+
+        // Every prefix must also agree with the reference implementation
+        for (size_t prefix = 0; prefix <= length; prefix++)
+        {
+            if (RtToeplitzHash(&table, vector->Input, prefix) !=
+                RtToeplitzHashBitwise(
+                    RtToeplitzVerificationKey,
+                    sizeof(RtToeplitzVerificationKey),
+                    vector->Input,
+                    prefix))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+#endif
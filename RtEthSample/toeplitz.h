@@ -0,0 +1,52 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#pragma once
+
+// Software Toeplitz hash, as specified for RSS. The key is expanded into one
+// table per input nibble, so hashing costs two lookups per input byte
+// instead of eight shift and xor steps.
+//
+// The hardware computes the receive hash itself and the driver never sees
+// the hash input, so nothing in the datapath needs the software hash. It is
+// built for checked builds only, where DriverEntry verifies it against the
+// RSS test vectors.
+
+#if DBG
+
+// Largest RSS hash input: IPv6 source and destination address plus ports
+#define RT_TOEPLITZ_MAX_INPUT 36
+
+typedef struct _RT_TOEPLITZ_TABLE
+{
+    UINT32 Nibble[RT_TOEPLITZ_MAX_INPUT * 2][16];
+} RT_TOEPLITZ_TABLE;
+
+void
+RtToeplitzInitialize(
+    _Out_ RT_TOEPLITZ_TABLE *table,
+    _In_reads_bytes_(keySize) UCHAR const *key,
+    _In_ size_t keySize
+    );
+
+UINT32
+RtToeplitzHash(
+    _In_ RT_TOEPLITZ_TABLE const *table,
+    _In_reads_bytes_(length) UCHAR const *input,
+    _In_range_(0, RT_TOEPLITZ_MAX_INPUT) size_t length
+    );
+
+bool
+RtToeplitzSelfTest(
+    void
+    );
+
+#endif
@@ -12,6 +12,7 @@
 #include "precomp.h"
 
 #include "device.h"
+#include "statistics.h"
 #include "txqueue.h"
 #include "trace.h"
 #include "adapter.h"
@@ -19,55 +20,83 @@
 
 #include "netringiterator.h"
 
-void
-RtUpdateSendStats(
-    _In_ RT_TXQUEUE * tx,
-    _In_ NET_RING_PACKET_ITERATOR const * pi
+static
+RT_TX_PACKET_INFO
+RtGetTxPacketInfo(
+    _In_ RT_TXQUEUE const * tx,
+    _In_ NET_PACKET const * packet,
+    _In_ ULONG length
     )
 {
-    NET_PACKET const * packet = NetPacketIteratorGetPacket(pi);
+    RT_TX_PACKET_INFO info = {};
+
     if (packet->Layout.Layer2Type != NetPacketLayer2TypeEthernet)
     {
-        return;
+        return info;
     }
 
-    NET_RING_FRAGMENT_ITERATOR fi = NetPacketIteratorGetFragments(pi);
-    NET_FRAGMENT const * fragment = NetFragmentIteratorGetFragment(&fi);
+    NET_FRAGMENT const * fragment = NetRingGetFragmentAtIndex(
+        NetRingCollectionGetFragmentRing(tx->Rings), packet->FragmentIndex);
     NET_FRAGMENT_VIRTUAL_ADDRESS const * virtualAddress = NetExtensionGetFragmentVirtualAddress(
         &tx->VirtualAddressExtension, packet->FragmentIndex);
     // Ethernet header should be in first fragment
     if (fragment->ValidLength < sizeof(ETHERNET_HEADER))
     {
-        return;
+        return info;
     }
 
     PUCHAR ethHeader = (PUCHAR)virtualAddress->VirtualAddress + fragment->Offset;
 
-    ULONG length = 0;
-    while (NetFragmentIteratorHasAny(&fi))
-    {
-        fragment = NetFragmentIteratorGetFragment(&fi);
-        length += (ULONG)fragment->ValidLength;
-        NetFragmentIteratorAdvance(&fi);
-    }
-
-    RT_ADAPTER *adapter = tx->Adapter;
+    info.Length = length;
 
     if (ETH_IS_BROADCAST(ethHeader))
     {
-        adapter->OutBroadcastPkts++;
-        adapter->OutBroadcastOctets += length;
+        info.Destination = RtTxDestinationBroadcast;
     }
     else if (ETH_IS_MULTICAST(ethHeader))
     {
-        adapter->OutMulticastPkts++;
-        adapter->OutMulticastOctets += length;
+        info.Destination = RtTxDestinationMulticast;
     }
     else
     {
-        adapter->OutUCastPkts++;
-        adapter->OutUCastOctets += length;
+        info.Destination = RtTxDestinationUnicast;
+    }
+
+    return info;
+}
+
+void
+RtUpdateSendStats(
+    _In_ RT_TXQUEUE * tx,
+    _In_ RT_TX_PACKET_INFO info
+    )
+{
+    RT_TX_STATISTICS *statistics = &tx->Statistics->Counters;
+    ULONG const length = info.Length;
+
+    switch (info.Destination)
+    {
+    case RtTxDestinationBroadcast:
+        statistics->BroadcastPkts++;
+        statistics->BroadcastOctets += length;
+        break;
+
+    case RtTxDestinationMulticast:
+        statistics->MulticastPkts++;
+        statistics->MulticastOctets += length;
+        break;
+
+    case RtTxDestinationUnicast:
+        statistics->UcastPkts++;
+        statistics->UcastOctets += length;
+        break;
+
+    default:
+        return;
     }
+
+    statistics->Packets++;
+    statistics->Bytes += length;
 }
 
 static
@@ -207,16 +236,58 @@ RtProgramOffloadDescriptor(
     return status;
 }
 
+static
+void
+RtProgramIeee8021qDescriptor(
+    _In_ RT_TXQUEUE const * tx,
+    _In_ RT_TX_DESC * txd,
+    _In_ UINT32 packetIndex
+    )
+{
+    txd->TxDescDataIpv6Rss_All.VLAN_TAG.Value = 0;
+
+    if (! tx->Ieee8021qExtension.Enabled)
+    {
+        return;
+    }
+
+    NET_PACKET_IEEE8021Q const * ieee8021q =
+        NetExtensionGetPacketIeee8021Q(&tx->Ieee8021qExtension, packetIndex);
+
+    if (ieee8021q->TxTagging == 0)
+    {
+        return;
+    }
+
+    // The tag is laid out in network byte order
+    RT_TAG_802_1Q * tag = &txd->TxDescDataIpv6Rss_All.VLAN_TAG;
+
+    if (ieee8021q->TxTagging & NetPacketTxIeee8021qActionFlagPriorityRequired)
+    {
+        tag->TagHeader.Priority = ieee8021q->PriorityCodePoint;
+    }
+
+    if (ieee8021q->TxTagging & NetPacketTxIeee8021qActionFlagVlanRequired)
+    {
+        tag->TagHeader.VLanID1 = ieee8021q->VlanIdentifier >> 8;
+        tag->TagHeader.VLanID2 = ieee8021q->VlanIdentifier & 0xff;
+    }
+
+    txd->TxDescDataIpv6Rss_All.OffloadGsoMssTagc |= TXS_IPV6RSS_TAGC;
+}
+
 static
 void
 RtPostTxDescriptor(
     _In_ RT_TXQUEUE * tx,
     _In_ RT_TCB const * tcb,
     _In_ NET_PACKET const * packet,
-    _In_ UINT32 packetIndex
+    _In_ UINT32 packetIndex,
+    _In_ UINT64 bufferAddress,
+    _In_ USHORT length,
+    _In_ bool lastDescriptor
     )
 {
-    NET_RING * fr = NetRingCollectionGetFragmentRing(tx->Rings);
     RT_TX_DESC * txd = &tx->TxdBase[tx->TxDescIndex];
     UINT16 status = TXS_OWN;
 
@@ -232,28 +303,21 @@ RtPostTxDescriptor(
     }
 
     // last fragment
-    if (tcb->NumTxDesc + 1 == packet->FragmentCount)
+    if (lastDescriptor)
     {
         status |= TXS_LS;
     }
 
-    // calculate the index in the fragment ring and retrieve
-    // the fragment being posted to populate the hardware descriptor
-    UINT32 const index = (packet->FragmentIndex + tcb->NumTxDesc) & fr->ElementIndexMask;
-    NET_FRAGMENT const * fragment = NetRingGetFragmentAtIndex(fr, index);
-    NET_FRAGMENT_LOGICAL_ADDRESS const * logicalAddress = NetExtensionGetFragmentLogicalAddress(
-        &tx->LogicalAddressExtension, index);
-
-    txd->BufferAddress = logicalAddress->LogicalAddress + fragment->Offset;
-    txd->TxDescDataIpv6Rss_All.length = (USHORT)fragment->ValidLength;
-    txd->TxDescDataIpv6Rss_All.VLAN_TAG.Value = 0;
+    txd->BufferAddress = bufferAddress;
+    txd->TxDescDataIpv6Rss_All.length = length;
 
     status |= RtProgramOffloadDescriptor(tx, packet, txd, packetIndex);
+    RtProgramIeee8021qDescriptor(tx, txd, packetIndex);
 
     MemoryBarrier();
 
     txd->TxDescDataIpv6Rss_All.status = status;
-    tx->TxDescIndex = (tx->TxDescIndex + 1) % tx->NumTxDesc;
+    tx->TxDescIndex = (tx->TxDescIndex + 1) & tx->TxDescIndexMask;
 }
 
 static
@@ -264,6 +328,62 @@ RtFlushTransation(
 {
     MemoryBarrier();
     *tx->TPPoll = TPPoll_NPQ;
+
+    tx->DoorbellPending = 0;
+    tx->Statistics->Counters.Doorbells++;
+}
+
+// Returns the packet length if the packet should go out through its bounce
+// buffer, or 0 if its fragments should be posted as they are
+static
+UINT32
+RtGetBouncePacketLength(
+    _In_ NET_RING_PACKET_ITERATOR const * pi
+    )
+{
+    if (NetPacketIteratorGetPacket(pi)->FragmentCount < 2)
+    {
+        return 0;
+    }
+
+    UINT32 length = 0;
+    NET_RING_FRAGMENT_ITERATOR fi = NetPacketIteratorGetFragments(pi);
+    for (; NetFragmentIteratorHasAny(&fi); NetFragmentIteratorAdvance(&fi))
+    {
+        length += static_cast<UINT32>(NetFragmentIteratorGetFragment(&fi)->ValidLength);
+
+        if (length > RT_TX_BOUNCE_SIZE)
+        {
+            return 0;
+        }
+    }
+
+    return length;
+}
+
+static
+void
+RtCopyToBounceBuffer(
+    _In_ RT_TXQUEUE * tx,
+    _In_ NET_RING_PACKET_ITERATOR const * pi
+    )
+{
+    UCHAR * buffer = tx->BounceBase + NetPacketIteratorGetIndex(pi) * RT_TX_BOUNCE_SIZE;
+
+    NET_RING_FRAGMENT_ITERATOR fi = NetPacketIteratorGetFragments(pi);
+    for (; NetFragmentIteratorHasAny(&fi); NetFragmentIteratorAdvance(&fi))
+    {
+        NET_FRAGMENT const * fragment = NetFragmentIteratorGetFragment(&fi);
+        NET_FRAGMENT_VIRTUAL_ADDRESS const * virtualAddress = NetExtensionGetFragmentVirtualAddress(
+            &tx->VirtualAddressExtension, NetFragmentIteratorGetIndex(&fi));
+
+        RtlCopyMemory(
+            buffer,
+            (UCHAR const *)virtualAddress->VirtualAddress + fragment->Offset,
+            (SIZE_T)fragment->ValidLength);
+
+        buffer += fragment->ValidLength;
+    }
 }
 
 static
@@ -284,32 +404,20 @@ RtIsPacketTransferComplete(
     )
 {
     NET_PACKET const * packet = NetPacketIteratorGetPacket(pi);
-    if (! packet->Ignore)
+    if (packet->Ignore)
     {
-        RT_TCB const * tcb = GetTcbFromPacket(tx, NetPacketIteratorGetIndex(pi));
-        RT_TX_DESC * txd = &tx->TxdBase[tcb->FirstTxDescIdx];
-
-        // Look at the status flags on the last fragment in the packet.
-        // If the hardware-ownership flag is still set, then the packet isn't done.
-        if (0 != (txd->TxDescDataIpv6Rss_All.status & TXS_OWN))
-        {
-            return false;
-        }
-
-        NET_RING_FRAGMENT_ITERATOR fi = NetPacketIteratorGetFragments(pi);
-        for (size_t idx = 0; idx < tcb->NumTxDesc; idx++)
-        {
-            size_t nextTxDescIdx = (tcb->FirstTxDescIdx + idx) % tx->NumTxDesc;
-            txd = &tx->TxdBase[nextTxDescIdx];
-            txd->TxDescDataIpv6Rss_All.status = 0;
-            NetFragmentIteratorAdvance(&fi);
-        }
-        RtUpdateSendStats(tx, pi);
-        fi.Iterator.Rings->Rings[NetRingTypeFragment]->BeginIndex
-            = NetFragmentIteratorGetIndex(&fi);
+        return true;
     }
 
-    return true;
+    RT_TCB const * tcb = GetTcbFromPacket(tx, NetPacketIteratorGetIndex(pi));
+    RT_TX_DESC const * txd =
+        &tx->TxdBase[(tcb->FirstTxDescIdx + tcb->NumTxDesc - 1) & tx->TxDescIndexMask];
+
+    // Look at the status flags on the last descriptor of the packet. The
+    // hardware releases descriptors in order, so once it is done with the
+    // last one it is done with the whole packet. Every status word is
+    // rewritten when the descriptor is next posted, so none need clearing.
+    return 0 == (txd->TxDescDataIpv6Rss_All.status & TXS_OWN);
 }
 
 static
@@ -318,7 +426,7 @@ RtTransmitPackets(
     _In_ RT_TXQUEUE *tx
     )
 {
-    bool programmedPackets = false;
+    ULONG programmedPackets = 0;
 
     NET_RING_PACKET_ITERATOR pi = NetRingGetPostPackets(tx->Rings);
     while (NetPacketIteratorHasAny(&pi))
@@ -326,26 +434,62 @@ RtTransmitPackets(
         NET_PACKET * packet = NetPacketIteratorGetPacket(&pi);
         if (! packet->Ignore)
         {
-            RT_TCB* tcb = GetTcbFromPacket(tx, NetPacketIteratorGetIndex(&pi));
+            UINT32 const packetIndex = NetPacketIteratorGetIndex(&pi);
+            RT_TCB* tcb = GetTcbFromPacket(tx, packetIndex);
 
             tcb->FirstTxDescIdx = tx->TxDescIndex;
+            tcb->NumTxDesc = 0;
 
             NET_RING_FRAGMENT_ITERATOR fi = NetPacketIteratorGetFragments(&pi);
-            for (tcb->NumTxDesc = 0; NetFragmentIteratorHasAny(&fi); tcb->NumTxDesc++)
+            UINT32 const bounceLength = RtGetBouncePacketLength(&pi);
+            ULONG length = bounceLength;
+
+            if (bounceLength != 0)
             {
-                RtPostTxDescriptor(tx, tcb, packet, NetPacketIteratorGetIndex(&pi));
+                // Small packets spread over several fragments cost a single
+                // descriptor and DMA read once copied together
+                RtCopyToBounceBuffer(tx, &pi);
+                RtPostTxDescriptor(tx, tcb, packet, packetIndex,
+                    tx->BounceLogicalBase + packetIndex * RT_TX_BOUNCE_SIZE,
+                    (USHORT)bounceLength,
+                    true);
+                tcb->NumTxDesc = 1;
+                NetFragmentIteratorAdvanceToTheEnd(&fi);
+            }
+
+            for (; NetFragmentIteratorHasAny(&fi); tcb->NumTxDesc++)
+            {
+                UINT32 const index = NetFragmentIteratorGetIndex(&fi);
+                NET_FRAGMENT const * fragment = NetFragmentIteratorGetFragment(&fi);
+                NET_FRAGMENT_LOGICAL_ADDRESS const * logicalAddress = NetExtensionGetFragmentLogicalAddress(
+                    &tx->LogicalAddressExtension, index);
+
+                RtPostTxDescriptor(tx, tcb, packet, packetIndex,
+                    logicalAddress->LogicalAddress + fragment->Offset,
+                    (USHORT)fragment->ValidLength,
+                    tcb->NumTxDesc + 1 == packet->FragmentCount);
+                length += (ULONG)fragment->ValidLength;
                 NetFragmentIteratorAdvance(&fi);
             }
+
+            tx->PacketInfo[packetIndex] = RtGetTxPacketInfo(tx, packet, length);
             fi.Iterator.Rings->Rings[NetRingTypeFragment]->NextIndex
                 = NetFragmentIteratorGetIndex(&fi);
 
-            programmedPackets = true;
+            programmedPackets++;
         }
         NetPacketIteratorAdvance(&pi);
     }
     NetPacketIteratorSet(&pi);
 
-    if (programmedPackets)
+    tx->DoorbellPending += programmedPackets;
+
+    // Ring the doorbell once enough packets have accumulated, or as soon as
+    // an advance has nothing new to post. The latter ends every burst: an
+    // advance that makes no progress lets the framework re-arm notification,
+    // and packets that were never announced to the hardware never complete.
+    if (tx->DoorbellPending >= tx->Adapter->TxDoorbellThreshold ||
+        (programmedPackets == 0 && tx->DoorbellPending > 0))
     {
         RtFlushTransation(tx);
     }
@@ -354,20 +498,43 @@ RtTransmitPackets(
 static
 void
 RtCompleteTransmitPackets(
-    _In_ RT_TXQUEUE *tx
+    _In_ RT_TXQUEUE *tx,
+    _In_ UINT32 budget
     )
 {
+    NET_RING * fr = NetRingCollectionGetFragmentRing(tx->Rings);
+    UINT32 fragmentBegin = fr->BeginIndex;
 
     NET_RING_PACKET_ITERATOR pi = NetRingGetDrainPackets(tx->Rings);
-    while (NetPacketIteratorHasAny(&pi))
+    for (UINT32 completed = 0; NetPacketIteratorHasAny(&pi); completed++)
     {
         if (! RtIsPacketTransferComplete(tx, &pi))
         {
             break;
         }
 
+        if (completed == budget)
+        {
+            tx->Statistics->Counters.BudgetExhausted++;
+            break;
+        }
+
+        if (! NetPacketIteratorGetPacket(&pi)->Ignore)
+        {
+            RtUpdateSendStats(tx, tx->PacketInfo[NetPacketIteratorGetIndex(&pi)]);
+
+            // A bounced packet used fewer descriptors than fragments, so
+            // release its fragments by skipping to the end of the packet
+            NET_RING_FRAGMENT_ITERATOR fi = NetPacketIteratorGetFragments(&pi);
+            NetFragmentIteratorAdvanceToTheEnd(&fi);
+            fragmentBegin = NetFragmentIteratorGetIndex(&fi);
+        }
+
         NetPacketIteratorAdvance(&pi);
     }
+
+    // Everything completed above is handed back in one update of each ring
+    fr->BeginIndex = fragmentBegin;
     NetPacketIteratorSet(&pi);
 }
 
@@ -382,7 +549,7 @@ EvtTxQueueAdvance(
     RT_TXQUEUE *tx = RtGetTxQueueContext(txQueue);
 
     RtTransmitPackets(tx);
-    RtCompleteTransmitPackets(tx);
+    RtCompleteTransmitPackets(tx, tx->Adapter->PollBudget);
 
     TraceExit();
 }
@@ -404,23 +571,37 @@ RtTxQueueInitialize(
 
     NET_RING * pr = NetRingCollectionGetPacketRing(tx->Rings);
     NET_RING * fr = NetRingCollectionGetFragmentRing(tx->Rings);
-    tx->NumTxDesc = (USHORT)(fr->NumberOfElements > USHORT_MAX ? USHORT_MAX : fr->NumberOfElements);
+    // The fragment ring is a power of two in size, which lets descriptor
+    // indices wrap with a mask
+    tx->NumTxDesc = (USHORT)(fr->NumberOfElements > 0x8000 ? 0x8000 : fr->NumberOfElements);
+    tx->TxDescIndexMask = tx->NumTxDesc - 1;
+    NT_ASSERT((tx->NumTxDesc & tx->TxDescIndexMask) == 0);
 
     WDF_OBJECT_ATTRIBUTES tcbAttributes;
     WDF_OBJECT_ATTRIBUTES_INIT(&tcbAttributes);
     tcbAttributes.ParentObject = txQueue;
     WDFMEMORY memory = NULL;
+    void * packetContext = NULL;
 
+    // The packet ring is a power of two in size, so once aligned the TCB
+    // array fills whole cache lines and the packet info array that follows
+    // it starts on a line of its own
     GOTO_IF_NOT_NT_SUCCESS(Exit, status,
         WdfMemoryCreate(
             &tcbAttributes,
             NonPagedPoolNx,
             0,
-            sizeof(RT_TCB) * pr->NumberOfElements,
+            (sizeof(RT_TCB) + sizeof(RT_TX_PACKET_INFO)) * pr->NumberOfElements +
+                SYSTEM_CACHE_ALIGNMENT_SIZE - 1,
             &memory,
-            (void**)&tx->PacketContext
+            &packetContext
         ));
 
+    tx->PacketContext = static_cast<RT_TCB*>(
+        ALIGN_UP_POINTER_BY(packetContext, SYSTEM_CACHE_ALIGNMENT_SIZE));
+    tx->PacketInfo = reinterpret_cast<RT_TX_PACKET_INFO*>(
+        tx->PacketContext + pr->NumberOfElements);
+
     ULONG txSize;
     GOTO_IF_NOT_NT_SUCCESS(Exit, status,
         RtlULongMult(tx->NumTxDesc, sizeof(RT_TX_DESC), &txSize));
@@ -436,6 +617,39 @@ RtTxQueueInitialize(
         WdfCommonBufferGetAlignedVirtualAddress(tx->TxdArray));
     tx->TxSize = txSize;
 
+    ULONG bounceSize;
+    GOTO_IF_NOT_NT_SUCCESS(Exit, status,
+        RtlULongMult(pr->NumberOfElements, RT_TX_BOUNCE_SIZE, &bounceSize));
+
+    GOTO_IF_NOT_NT_SUCCESS(Exit, status,
+        WdfCommonBufferCreate(
+            tx->Adapter->DmaEnabler,
+            bounceSize,
+            WDF_NO_OBJECT_ATTRIBUTES,
+            &tx->BounceArray));
+
+    tx->BounceBase = static_cast<UCHAR*>(
+        WdfCommonBufferGetAlignedVirtualAddress(tx->BounceArray));
+    tx->BounceLogicalBase =
+        WdfCommonBufferGetAlignedLogicalAddress(tx->BounceArray).QuadPart;
+
+    // Object contexts carry no cache alignment, see statistics.h
+    WDFMEMORY statisticsMemory;
+    void * statistics;
+
+    GOTO_IF_NOT_NT_SUCCESS(Exit, status,
+        WdfMemoryCreate(
+            &tcbAttributes,
+            NonPagedPoolNx,
+            0,
+            sizeof(RT_TX_QUEUE_STATISTICS) + SYSTEM_CACHE_ALIGNMENT_SIZE - 1,
+            &statisticsMemory,
+            &statistics));
+
+    tx->Statistics = static_cast<RT_TX_QUEUE_STATISTICS*>(
+        ALIGN_UP_POINTER_BY(statistics, SYSTEM_CACHE_ALIGNMENT_SIZE));
+    RtlZeroMemory(tx->Statistics, sizeof(*tx->Statistics));
+
 Exit:
     return status;
 }
@@ -468,13 +682,14 @@ EvtTxQueueStart(
     RtlZeroMemory(tx->TxdBase, tx->TxSize);
 
     tx->TxDescIndex = 0;
+    tx->DoorbellPending = 0;
 
     WdfSpinLockAcquire(adapter->Lock);
 
     adapter->CSRAddress->TDFNR = 8;
 
     // Max transmit packet size
-    adapter->CSRAddress->MtpsReg.MTPS = (RT_MAX_FRAME_SIZE + 128 - 1) / 128;
+    adapter->CSRAddress->MtpsReg.MTPS = (RT_FRAME_SIZE(adapter->JumboPacket) + 128 - 1) / 128;
 
     PHYSICAL_ADDRESS pa = WdfCommonBufferGetAlignedLogicalAddress(tx->TxdArray);
 
@@ -499,13 +714,17 @@ EvtTxQueueStop(
 {
     RT_TXQUEUE *tx = RtGetTxQueueContext(txQueue);
 
+    // Flushes DPCs, which may be waiting on the adapter lock; so not under it
+    RtTxQueueSetInterrupt(tx, false);
+
     WdfSpinLockAcquire(tx->Adapter->Lock);
 
     tx->Adapter->CSRAddress->CmdReg &= ~CR_TE;
 
-    RtTxQueueSetInterrupt(tx, false);
     tx->Adapter->TxQueue = WDF_NO_HANDLE;
 
+    RtAdapterRetireTxStatistics(tx->Adapter, &tx->Statistics->Counters);
+
     WdfSpinLockRelease(tx->Adapter->Lock);
 }
 
@@ -519,6 +738,12 @@ EvtTxQueueDestroy(
 
     WdfObjectDelete(tx->TxdArray);
     tx->TxdArray = NULL;
+
+    if (tx->BounceArray)
+    {
+        WdfObjectDelete(tx->BounceArray);
+        tx->BounceArray = NULL;
+    }
 }
 
 _Use_decl_annotations_
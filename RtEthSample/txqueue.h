@@ -15,12 +15,34 @@
 // TCB (Transmit Control Block)
 //--------------------------------------
 
+// One per packet ring element, indexed by packet index. Posting and
+// completion only need where the packet's descriptors are, so the TCB is
+// kept to that and sixteen of them share a cache line.
 typedef struct _RT_TCB
 {
     USHORT FirstTxDescIdx;
-    ULONG NumTxDesc;
+    USHORT NumTxDesc;
 } RT_TCB;
 
+static_assert(sizeof(RT_TCB) == 4, "keep RT_TCB packed into a single dword");
+
+typedef enum _RT_TX_DESTINATION
+{
+    RtTxDestinationUnknown = 0,
+    RtTxDestinationUnicast = 1,
+    RtTxDestinationMulticast = 2,
+    RtTxDestinationBroadcast = 3,
+} RT_TX_DESTINATION;
+
+// Send accounting for a posted packet, recorded while its headers are still
+// in cache and folded into the queue statistics once it completes. Indexed
+// like the TCBs, in an array of its own.
+typedef struct _RT_TX_PACKET_INFO
+{
+    ULONG Length : 30;
+    ULONG Destination : 2;
+} RT_TX_PACKET_INFO;
+
 typedef struct _RT_TXQUEUE
 {
     RT_ADAPTER *Adapter;
@@ -28,6 +50,7 @@ typedef struct _RT_TXQUEUE
 
     NET_RING_COLLECTION const * Rings;
     RT_TCB* PacketContext;
+    RT_TX_PACKET_INFO* PacketInfo;
 
     // descriptor information
     WDFCOMMONBUFFER TxdArray;
@@ -35,12 +58,24 @@ typedef struct _RT_TXQUEUE
     size_t TxSize;
 
     USHORT NumTxDesc;
+    USHORT TxDescIndexMask;
     USHORT TxDescIndex;
 
+    // one RT_TX_BOUNCE_SIZE buffer per packet ring element
+    WDFCOMMONBUFFER BounceArray;
+    UCHAR *BounceBase;
+    UINT64 BounceLogicalBase;
+
+    // packets posted since TPPoll was last written
+    ULONG DoorbellPending;
+
     UCHAR volatile *TPPoll;
 
+    RT_TX_QUEUE_STATISTICS *Statistics;
+
     NET_EXTENSION ChecksumExtension;
     NET_EXTENSION LsoExtension;
+    NET_EXTENSION Ieee8021qExtension;
     NET_EXTENSION VirtualAddressExtension;
     NET_EXTENSION LogicalAddressExtension;
 } RT_TXQUEUE;
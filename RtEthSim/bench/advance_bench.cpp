@@ -0,0 +1,396 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+// Packets per second through EvtTxQueueAdvance and EvtRxQueueAdvance.
+//
+// Every case keeps one queue busy with a packet mix, a fragment count and
+// an offload mix, and reports the time and cache misses spent in the
+// driver's advance callbacks per packet, as one JSON object per case.
+//
+//     advance_bench [--quick] [--packets N]
+//
+// --quick runs a few small cases, to check that the benchmark still works.
+
+#include <cstdlib>
+#include <cstring>
+
+#include "sim/host.h"
+
+using namespace sim;
+
+enum class OffloadMix
+{
+    None,
+    Checksum,
+    Lso,
+    Ieee8021q,
+};
+
+static char const *
+OffloadName(OffloadMix offload)
+{
+    switch (offload)
+    {
+    case OffloadMix::Checksum:
+        return "checksum";
+    case OffloadMix::Lso:
+        return "lso";
+    case OffloadMix::Ieee8021q:
+        return "ieee8021q";
+    default:
+        return "none";
+    }
+}
+
+struct PacketMix
+{
+    char const *Name;
+    std::vector<size_t> Sizes;
+};
+
+// Simple IMIX: 7 small, 4 medium, 1 large
+static PacketMix const Mixes[] =
+{
+    { "64", { 64 } },
+    { "imix", { 64, 576, 64, 1514, 64, 576, 64, 576, 64, 64, 576, 64 } },
+    { "1514", { 1514 } },
+};
+
+struct Case
+{
+    bool Transmit;
+    // *TransmitBuffers or *ReceiveBuffers
+    ULONG Buffers;
+    PacketMix const *Mix;
+    UINT16 Fragments;
+    OffloadMix Offload;
+};
+
+struct Result
+{
+    ULONG64 Packets;
+    ULONG64 Advances;
+    ULONG64 Nanoseconds;
+    ULONG64 CacheMisses;
+    bool CacheMissesCounted;
+    size_t RingSize;
+    bool Complete;
+};
+
+static UCHAR const Station[ETH_LENGTH_OF_ADDRESS] = { 0x00, 0xe0, 0x4c, 0x68, 0x00, 0x01 };
+static UCHAR const Peer[ETH_LENGTH_OF_ADDRESS] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+// An Ethernet, IPv4 and TCP header followed by a pattern
+static std::vector<UCHAR>
+MakeFrame(UCHAR const *destination, size_t length)
+{
+    std::vector<UCHAR> frame(length);
+
+    memcpy(frame.data(), destination, ETH_LENGTH_OF_ADDRESS);
+    memcpy(frame.data() + ETH_LENGTH_OF_ADDRESS, destination == Peer ? Station : Peer, ETH_LENGTH_OF_ADDRESS);
+    frame[12] = 0x08;
+    frame[13] = 0x00;
+    frame[14] = 0x45;
+    frame[16] = (UCHAR)((length - ETH_LENGTH_OF_HEADER) >> 8);
+    frame[17] = (UCHAR)(length - ETH_LENGTH_OF_HEADER);
+    frame[22] = 64;
+    frame[23] = 6;
+
+    for (size_t i = 54; i < length; i++)
+    {
+        frame[i] = (UCHAR)i;
+    }
+
+    return frame;
+}
+
+static std::vector<TxPacket>
+MakeTxPackets(Case const &c)
+{
+    std::vector<TxPacket> packets;
+
+    for (size_t size : c.Mix->Sizes)
+    {
+        TxPacket packet;
+        packet.Data = MakeFrame(Peer, size);
+        packet.FragmentCount = (UINT16)min<size_t>(c.Fragments, size);
+        packet.Layout.Layer2Type = NetPacketLayer2TypeEthernet;
+        packet.Layout.Layer2HeaderLength = ETH_LENGTH_OF_HEADER;
+        packet.Layout.Layer3Type = NetPacketLayer3TypeIPv4NoOptions;
+        packet.Layout.Layer3HeaderLength = 20;
+        packet.Layout.Layer4Type = NetPacketLayer4TypeTcp;
+        packet.Layout.Layer4HeaderLength = 20;
+
+        switch (c.Offload)
+        {
+        case OffloadMix::Checksum:
+            packet.Checksum.Layer3 = NetPacketTxChecksumActionRequired;
+            packet.Checksum.Layer4 = NetPacketTxChecksumActionRequired;
+            break;
+        case OffloadMix::Lso:
+            packet.Mss = size > 1000 ? 536 : 0;
+            packet.Checksum.Layer3 = NetPacketTxChecksumActionRequired;
+            packet.Checksum.Layer4 = NetPacketTxChecksumActionRequired;
+            break;
+        case OffloadMix::Ieee8021q:
+            packet.Ieee8021q.VlanIdentifier = 42;
+            packet.Ieee8021q.TxTagging = NetPacketTxIeee8021qActionFlagVlanRequired;
+            break;
+        default:
+            break;
+        }
+
+        packets.push_back(std::move(packet));
+    }
+
+    return packets;
+}
+
+static std::vector<RxFrame>
+MakeRxFrames(Case const &c)
+{
+    std::vector<RxFrame> frames;
+
+    for (size_t size : c.Mix->Sizes)
+    {
+        RxFrame frame;
+        frame.Data = MakeFrame(Station, size);
+
+        switch (c.Offload)
+        {
+        case OffloadMix::Checksum:
+        case OffloadMix::Lso:
+            frame.Status = RXS_TCPIP_PACKET;
+            frame.IpRssTava = RXS_IPV6RSS_IS_IPV4;
+            break;
+        case OffloadMix::Ieee8021q:
+            frame.IpRssTava = RXS_IPV6RSS_TAVA;
+            frame.VlanTag = 0x2a00;
+            break;
+        default:
+            break;
+        }
+
+        frames.push_back(std::move(frame));
+    }
+
+    return frames;
+}
+
+static HostConfig
+MakeConfig(Case const &c)
+{
+    HostConfig config;
+    config.CountCacheMisses = true;
+    config.Keywords[c.Transmit ? L"*TransmitBuffers" : L"*ReceiveBuffers"] = c.Buffers;
+    return config;
+}
+
+static void
+SendPackets(Host &host, std::vector<TxPacket> const &packets, ULONG64 count)
+{
+    ULONG64 sent = 0;
+
+    while (sent < count)
+    {
+        while (sent < count && host.Send(packets[sent % packets.size()]))
+        {
+            sent++;
+        }
+
+        host.Run(1);
+    }
+}
+
+static void
+ReceiveFrames(Host &host, std::vector<RxFrame> const &frames, ULONG64 count, size_t burst)
+{
+    ULONG64 injected = 0;
+
+    while (injected < count)
+    {
+        for (size_t i = 0; i < burst && injected < count; i++, injected++)
+        {
+            host.Receive(frames[injected % frames.size()]);
+        }
+
+        host.RunUntilIdle();
+    }
+}
+
+static Result
+RunCase(Case const &c, ULONG64 count)
+{
+    Host host(MakeConfig(c));
+    host.SetRecording(false);
+    host.RunUntilIdle();
+
+    Result result = {};
+    ULONG64 const warmUp = count / 10 + 1;
+
+    if (c.Transmit)
+    {
+        std::vector<TxPacket> const packets = MakeTxPackets(c);
+
+        SendPackets(host, packets, warmUp);
+        host.RunUntilIdle();
+        host.Counters = {};
+
+        SendPackets(host, packets, count);
+        result.Complete = host.RunUntilIdle() && host.Counters.TxPacketsCompleted == count;
+
+        result.Packets = host.Counters.TxPacketsCompleted;
+        result.Advances = host.Counters.TxAdvances;
+        result.Nanoseconds = host.Counters.TxAdvanceNanoseconds;
+        result.CacheMisses = host.Counters.TxAdvanceCacheMisses;
+        result.RingSize = host.Adapter()->NumTcb * RT_MAX_PHYS_BUF_COUNT;
+    }
+    else
+    {
+        std::vector<RxFrame> const frames = MakeRxFrames(c);
+        size_t const burst = min<size_t>(c.Buffers, Rtl8168::RxFifoFrames);
+
+        ReceiveFrames(host, frames, warmUp, burst);
+        host.Counters = {};
+        ULONG64 const missed = host.Device().MissedFrames;
+
+        ReceiveFrames(host, frames, count, burst);
+        result.Complete = host.Counters.RxPacketsIndicated == count && host.Device().MissedFrames == missed;
+
+        result.Packets = host.Counters.RxPacketsIndicated;
+        result.Advances = host.Counters.RxAdvances;
+        result.Nanoseconds = host.Counters.RxAdvanceNanoseconds;
+        result.CacheMisses = host.Counters.RxAdvanceCacheMisses;
+        result.RingSize = host.Adapter()->ReceiveBuffers;
+    }
+
+    result.CacheMissesCounted = host.CountingCacheMisses();
+    return result;
+}
+
+static std::vector<Case>
+MakeCases(bool quick)
+{
+    std::vector<Case> cases;
+
+    ULONG const txBuffers[] = { RT_MIN_TCB, 64, RT_MAX_TCB };
+    ULONG const rxBuffers[] = { RT_MIN_RX_DESC, 64, 256, RT_MAX_RX_DESC };
+    UINT16 const fragments[] = { 1, 4, RT_MAX_PHYS_BUF_COUNT };
+    OffloadMix const offloads[] = { OffloadMix::None, OffloadMix::Checksum, OffloadMix::Lso, OffloadMix::Ieee8021q };
+
+    if (quick)
+    {
+        cases.push_back({ true, RT_MIN_TCB, &Mixes[1], RT_MAX_PHYS_BUF_COUNT, OffloadMix::Lso });
+        cases.push_back({ false, RT_MIN_RX_DESC, &Mixes[1], 1, OffloadMix::Checksum });
+        return cases;
+    }
+
+    for (ULONG buffers : txBuffers)
+    {
+        for (PacketMix const &mix : Mixes)
+        {
+            for (UINT16 fragmentCount : fragments)
+            {
+                for (OffloadMix offload : offloads)
+                {
+                    cases.push_back({ true, buffers, &mix, fragmentCount, offload });
+                }
+            }
+        }
+    }
+
+    // The receive queue takes a frame in one fragment
+    for (ULONG buffers : rxBuffers)
+    {
+        for (PacketMix const &mix : Mixes)
+        {
+            for (OffloadMix offload : offloads)
+            {
+                if (offload != OffloadMix::Lso)
+                {
+                    cases.push_back({ false, buffers, &mix, 1, offload });
+                }
+            }
+        }
+    }
+
+    return cases;
+}
+
+int
+main(int argc, char **argv)
+{
+    bool quick = false;
+    ULONG64 count = 200000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (0 == strcmp(argv[i], "--quick"))
+        {
+            quick = true;
+            count = 2000;
+        }
+        else if (0 == strcmp(argv[i], "--packets") && i + 1 < argc)
+        {
+            count = strtoull(argv[++i], nullptr, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--quick] [--packets N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<Case> const cases = MakeCases(quick);
+    bool complete = true;
+
+    printf("[\n");
+
+    for (size_t i = 0; i < cases.size(); i++)
+    {
+        Case const &c = cases[i];
+        Result const result = RunCase(c, count);
+
+        double const nsPerPacket = result.Packets != 0 ? (double)result.Nanoseconds / result.Packets : 0;
+
+        printf("  {\"direction\": \"%s\", \"buffers\": %lu, \"ring_size\": %zu, \"mix\": \"%s\", "
+            "\"fragments\": %u, \"offload\": \"%s\", \"packets\": %llu, \"advances\": %llu, "
+            "\"ns_per_packet\": %.2f, \"packets_per_second\": %.0f, \"cache_misses_per_packet\": ",
+            c.Transmit ? "tx" : "rx",
+            (unsigned long)c.Buffers,
+            result.RingSize,
+            c.Mix->Name,
+            c.Fragments,
+            OffloadName(c.Offload),
+            (unsigned long long)result.Packets,
+            (unsigned long long)result.Advances,
+            nsPerPacket,
+            nsPerPacket != 0 ? 1e9 / nsPerPacket : 0);
+
+        if (result.CacheMissesCounted && result.Packets != 0)
+        {
+            printf("%.3f", (double)result.CacheMisses / result.Packets);
+        }
+        else
+        {
+            printf("null");
+        }
+
+        printf(", \"complete\": %s}%s\n", result.Complete ? "true" : "false", i + 1 < cases.size() ? "," : "");
+        fflush(stdout);
+
+        complete = complete && result.Complete;
+    }
+
+    printf("]\n");
+
+    return complete ? 0 : 1;
+}
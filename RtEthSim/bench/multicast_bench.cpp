@@ -0,0 +1,162 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+// The multicast hash and the multicast list update.
+//
+// "hash" cases time GetMulticastBit and the bit at a time CRC it replaced
+// over the same addresses, and count the addresses they disagree on.
+// "list" cases time handing the driver a multicast list of the given size,
+// with a tenth of it replaced on every call; this is EvtSetMulticastList
+// and the host building the list for it.
+//
+//     multicast_bench [--quick]
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <random>
+
+#include "sim/host.h"
+
+#include "multicast_reference.h"
+
+using namespace sim;
+
+UCHAR
+GetMulticastBit(
+    _In_reads_bytes_(ETH_LENGTH_OF_ADDRESS) UCHAR const *address
+    );
+
+typedef UCHAR HashFunction(UCHAR const *address);
+
+static UCHAR
+TableMulticastBit(UCHAR const *address)
+{
+    return GetMulticastBit(address);
+}
+
+static double
+TimeHash(HashFunction *hash, std::vector<std::array<UCHAR, ETH_LENGTH_OF_ADDRESS>> const &addresses,
+    std::vector<UCHAR> &bits)
+{
+    auto const start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < addresses.size(); i++)
+    {
+        bits[i] = hash(addresses[i].data());
+    }
+
+    auto const elapsed = std::chrono::steady_clock::now() - start;
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / addresses.size();
+}
+
+static std::vector<UCHAR>
+GroupAddress(UINT32 group)
+{
+    return { 0x01, 0x00, 0x5e, (UCHAR)((group >> 16) & 0x7f), (UCHAR)(group >> 8), (UCHAR)group };
+}
+
+static double
+TimeListUpdate(Host &host, size_t size, UINT calls, std::mt19937 &random)
+{
+    std::vector<std::vector<UCHAR>> list;
+    for (size_t i = 0; i < size; i++)
+    {
+        list.push_back(GroupAddress(random()));
+    }
+
+    host.SetMulticastList(list);
+
+    std::chrono::nanoseconds total(0);
+
+    for (UINT call = 0; call < calls; call++)
+    {
+        for (size_t i = 0; i < size / 10 + 1; i++)
+        {
+            list[random() % size] = GroupAddress(random());
+        }
+
+        auto const start = std::chrono::steady_clock::now();
+        host.SetMulticastList(list);
+        total += std::chrono::steady_clock::now() - start;
+    }
+
+    return (double)total.count() / calls;
+}
+
+int
+main(int argc, char **argv)
+{
+    bool quick = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (0 == strcmp(argv[i], "--quick"))
+        {
+            quick = true;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--quick]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::mt19937 random(8168);
+    size_t const addressCount = quick ? 10000 : 4000000;
+
+    std::vector<std::array<UCHAR, ETH_LENGTH_OF_ADDRESS>> addresses(addressCount);
+    for (auto &address : addresses)
+    {
+        for (UCHAR &byte : address)
+        {
+            byte = (UCHAR)random();
+        }
+    }
+
+    std::vector<UCHAR> tableBits(addressCount);
+    std::vector<UCHAR> bitwiseBits(addressCount);
+
+    double const bitwiseNs = TimeHash(ReferenceMulticastBit, addresses, bitwiseBits);
+    double const tableNs = TimeHash(TableMulticastBit, addresses, tableBits);
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < addressCount; i++)
+    {
+        mismatches += tableBits[i] != bitwiseBits[i];
+    }
+
+    printf("[\n");
+    printf("  {\"case\": \"hash\", \"implementation\": \"bitwise\", \"addresses\": %zu, \"ns_per_address\": %.2f},\n",
+        addressCount, bitwiseNs);
+    printf("  {\"case\": \"hash\", \"implementation\": \"table\", \"addresses\": %zu, \"ns_per_address\": %.2f, "
+        "\"mismatches\": %zu},\n",
+        addressCount, tableNs, mismatches);
+
+    HostConfig config;
+    Host host(config);
+    host.RunUntilIdle();
+
+    size_t const sizes[] = { 16, 64, 256, RT_MAX_MCAST_LIST };
+    UINT const calls = quick ? 10 : 2000;
+
+    for (size_t i = 0; i < ARRAYSIZE(sizes); i++)
+    {
+        double const ns = TimeListUpdate(host, sizes[i], calls, random);
+
+        printf("  {\"case\": \"list\", \"addresses\": %zu, \"calls\": %u, \"ns_per_call\": %.0f}%s\n",
+            sizes[i], calls, ns, i + 1 < ARRAYSIZE(sizes) ? "," : "");
+    }
+
+    printf("]\n");
+
+    return mismatches == 0 ? 0 : 1;
+}
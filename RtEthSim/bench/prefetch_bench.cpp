@@ -0,0 +1,171 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+// The receive descriptor scan with and without its prefetch hints.
+//
+// Every round fills the receive ring with frames before the queue is
+// advanced, so each advance scans a long run of completed descriptors.
+// With "evicted" the model evicts the descriptors and buffers it writes
+// from the caches, as DMA does; with "cached" they stay where the model
+// left them. Each case is run a few times and the fastest run reported.
+//
+//     prefetch_bench [--quick]
+
+#include <cstring>
+
+#include "sim/host.h"
+
+using namespace sim;
+
+struct Result
+{
+    double NsPerPacket;
+    double CacheMissesPerPacket;
+    bool CacheMissesCounted;
+    bool Complete;
+};
+
+static UCHAR const Station[ETH_LENGTH_OF_ADDRESS] = { 0x00, 0xe0, 0x4c, 0x68, 0x00, 0x01 };
+
+static Result
+RunCase(ULONG descriptors, bool evict, bool prefetch, ULONG64 count)
+{
+    HostConfig config;
+    config.CountCacheMisses = true;
+    config.Keywords[L"*ReceiveBuffers"] = descriptors;
+    config.Keywords[L"PollBudget"] = descriptors;
+
+    Host host(config);
+    host.SetRecording(false);
+    host.RunUntilIdle();
+    host.Device().EvictReceivedLines = evict;
+
+    PrefetchEnabled = prefetch;
+
+    RxFrame frame;
+    frame.Data.assign(64, 0);
+    memcpy(frame.Data.data(), Station, ETH_LENGTH_OF_ADDRESS);
+
+    // About a ring's worth; frames that find no descriptor wait in the
+    // receive FIFO for the driver to post more
+    size_t const round = descriptors - 1;
+    ULONG64 received = 0;
+
+    host.Counters = {};
+
+    while (received < count)
+    {
+        for (size_t i = 0; i < round; i++)
+        {
+            host.Receive(frame);
+
+            // Keep the receive FIFO from overflowing on the larger rings
+            if (i % Rtl8168::RxFifoFrames == Rtl8168::RxFifoFrames - 1)
+            {
+                host.Device().Service();
+            }
+        }
+
+        host.RunUntilIdle();
+        received += round;
+    }
+
+    PrefetchEnabled = true;
+
+    Result result;
+    result.NsPerPacket = (double)host.Counters.RxAdvanceNanoseconds / host.Counters.RxPacketsIndicated;
+    result.CacheMissesPerPacket = (double)host.Counters.RxAdvanceCacheMisses / host.Counters.RxPacketsIndicated;
+    result.CacheMissesCounted = host.CountingCacheMisses();
+    result.Complete = host.Counters.RxPacketsIndicated == received && host.Device().MissedFrames == 0;
+    return result;
+}
+
+int
+main(int argc, char **argv)
+{
+    bool quick = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (0 == strcmp(argv[i], "--quick"))
+        {
+            quick = true;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--quick]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    ULONG const rings[] = { 256, RT_MAX_RX_DESC };
+    bool const evictions[] = { false, true };
+    ULONG64 const count = quick ? 2000 : 500000;
+    int const runs = quick ? 1 : 5;
+    bool complete = true;
+    bool first = true;
+
+    printf("[\n");
+
+    for (ULONG descriptors : rings)
+    {
+        for (bool evict : evictions)
+        {
+            Result best[2] = {};
+
+            for (int run = 0; run < runs; run++)
+            {
+                // Alternate, so drift in the machine hits both the same
+                for (int prefetch = 0; prefetch < 2; prefetch++)
+                {
+                    Result const result = RunCase(descriptors, evict, prefetch != 0, count);
+                    complete = complete && result.Complete;
+
+                    if (run == 0 || result.NsPerPacket < best[prefetch].NsPerPacket)
+                    {
+                        best[prefetch] = result;
+                    }
+                }
+            }
+
+            for (int prefetch = 0; prefetch < 2; prefetch++)
+            {
+                Result const &result = best[prefetch];
+
+                printf("%s  {\"descriptors\": %lu, \"lines\": \"%s\", \"prefetch\": %s, \"packets\": %llu, "
+                    "\"ns_per_packet\": %.2f, \"packets_per_second\": %.0f, \"cache_misses_per_packet\": ",
+                    first ? "" : ",\n",
+                    (unsigned long)descriptors,
+                    evict ? "evicted" : "cached",
+                    prefetch ? "true" : "false",
+                    (unsigned long long)count,
+                    result.NsPerPacket,
+                    1e9 / result.NsPerPacket);
+
+                if (result.CacheMissesCounted)
+                {
+                    printf("%.3f", result.CacheMissesPerPacket);
+                }
+                else
+                {
+                    printf("null");
+                }
+
+                printf(", \"speedup\": %.3f}", best[0].NsPerPacket / result.NsPerPacket);
+                first = false;
+            }
+        }
+    }
+
+    printf("\n]\n");
+
+    return complete ? 0 : 1;
+}
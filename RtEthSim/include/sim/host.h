@@ -0,0 +1,219 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "precomp.h"
+#include "trace.h"
+#include "statistics.h"
+#include "adapter.h"
+#include "interrupt.h"
+
+#include "sim/mmio.h"
+#include "sim/perf.h"
+#include "sim/rtl8168.h"
+
+namespace sim
+{
+
+struct Queue;
+
+struct HostConfig
+{
+    // Advanced keywords, by name as the driver queries them (L"*RSS")
+    std::map<std::wstring, ULONG> Keywords;
+
+    // Interrupt messages granted to the device: 1, 2 or 4
+    ULONG MessageCount = 1;
+
+    // Count driver register accesses, see Mmio
+    bool TrapMmio = false;
+
+    // Count cache misses in the advance callbacks, see CacheMissCounter
+    bool CountCacheMisses = false;
+
+    UCHAR MacAddress[ETH_LENGTH_OF_ADDRESS] = { 0x00, 0xe0, 0x4c, 0x68, 0x00, 0x01 };
+};
+
+// A packet the stack hands the transmit queue. Data is split over
+// FragmentCount fragments of about the same size.
+struct TxPacket
+{
+    std::vector<UCHAR> Data;
+    UINT16 FragmentCount = 1;
+    NET_PACKET_LAYOUT Layout = {};
+    NET_PACKET_CHECKSUM Checksum = {};
+    UINT32 Mss = 0;
+    NET_PACKET_IEEE8021Q Ieee8021q = {};
+};
+
+// A packet the receive queue indicated, as the stack sees it
+struct RxPacket
+{
+    ULONG QueueId;
+    std::vector<UCHAR> Data;
+    UINT16 FragmentCount;
+    NET_PACKET_LAYOUT Layout;
+    NET_PACKET_CHECKSUM Checksum;
+    NET_PACKET_IEEE8021Q Ieee8021q;
+};
+
+// One entry of the receive scaling indirection table, moved to a queue
+struct IndirectionEntry
+{
+    UINT32 Index;
+    ULONG QueueId;
+};
+
+struct HostCounters
+{
+    ULONG64 TxPacketsCompleted = 0;
+    ULONG64 RxPacketsIndicated = 0;
+    ULONG64 TxAdvances = 0;
+    ULONG64 RxAdvances = 0;
+    // Spent in EvtTxQueueAdvance and EvtRxQueueAdvance
+    ULONG64 TxAdvanceNanoseconds = 0;
+    ULONG64 RxAdvanceNanoseconds = 0;
+    ULONG64 TxAdvanceCacheMisses = 0;
+    ULONG64 RxAdvanceCacheMisses = 0;
+    ULONG64 Isrs = 0;
+    ULONG64 Dpcs = 0;
+};
+
+// Loads RtEthSample against the device model and plays the parts of the
+// framework and the stack: it brings the adapter up as far as a started
+// datapath, polls the queues the way NetAdapterCx does, delivers interrupt
+// messages and runs timers and work items. Everything happens on the
+// calling thread, against a simulated clock in 100ns units.
+//
+// A queue is polled until an advance makes no progress, then armed, then
+// advanced once more to close the race with the hardware; after that it
+// waits for the driver's notification, or for the stack to hand it more
+// packets to send.
+//
+// There is one Host per process at a time.
+class Host
+{
+public:
+    explicit Host(HostConfig const &config);
+    ~Host();
+
+    Host(Host const &) = delete;
+    Host &operator=(Host const &) = delete;
+
+    // Queues a packet for the driver, false if the rings have no room
+    bool Send(TxPacket const &packet);
+
+    // Puts a frame on the wire for a receive queue of the MAC
+    void Receive(RxFrame frame, ULONG queueId = 0);
+
+    // One round of the device, interrupts, timers and work items and the
+    // queues. Returns whether anything but the clock moved.
+    bool Step();
+
+    // Steps until the clock has advanced by duration
+    void Run(ULONG64 duration);
+
+    // Steps until nothing but the clock moves and every sent packet has
+    // completed, or until limit has passed. Returns whether it got idle.
+    bool RunUntilIdle(ULONG64 limit = 10 * 1000 * 10000ULL);
+
+    std::vector<RxPacket> TakeReceived();
+
+    // Packets sent and not yet completed
+    size_t TxOutstanding() const;
+
+    // Hands the driver a new indirection table, one queue per entry
+    NTSTATUS SetIndirectionTable(std::vector<ULONG> const &queueIds);
+
+    // Hands the driver only the entries that move, as the stack does when
+    // it rebalances
+    NTSTATUS SetIndirectionEntries(std::vector<IndirectionEntry> const &entries);
+
+    void SetPacketFilter(NET_PACKET_FILTER_FLAGS filter);
+    void SetMulticastList(std::vector<std::vector<UCHAR>> const &addresses);
+
+    ULONG64 Now() const;
+
+    RT_ADAPTER *Adapter() const { return m_adapter; }
+    NETADAPTER NetAdapter() const { return m_netAdapter; }
+    size_t RxQueueCount() const { return m_rxQueues.size(); }
+
+    Rtl8168 &Device() { return *m_model; }
+    Mmio &Registers() { return *m_mmio; }
+
+    // Keep transmitted frames and interrupt records, on by default;
+    // benchmarks turn them off
+    void SetRecording(bool record);
+
+    // Whether the advance cache miss counters mean anything
+    bool CountingCacheMisses() const;
+
+    HostCounters Counters;
+
+private:
+    enum class PollState
+    {
+        Polling,
+        Armed,
+    };
+
+    struct QueueState
+    {
+        Queue *Instance = nullptr;
+        PollState State = PollState::Polling;
+        // Packets the stack has seen back, up to the packet ring's Begin
+        UINT32 Returned = 0;
+        // Fragment buffers, one per fragment ring slot
+        std::vector<std::vector<UCHAR>> Buffers;
+        size_t BufferSize = 0;
+    };
+
+    void StartDatapath();
+    void StopDatapath();
+
+    void DeliverInterrupts();
+    void RunTimersAndWorkItems();
+    bool PollQueues();
+    bool Advance(QueueState &queue);
+    void CollectRx(QueueState &queue);
+    void CollectTx(QueueState &queue);
+    void ReturnRxBuffers(QueueState &queue);
+    ULONG64 NextEvent() const;
+
+    std::unique_ptr<Mmio> m_mmio;
+    std::unique_ptr<Rtl8168> m_model;
+    std::unique_ptr<CacheMissCounter> m_cacheMisses;
+
+    WDFDEVICE m_device = nullptr;
+    NETADAPTER m_netAdapter = nullptr;
+    RT_ADAPTER *m_adapter = nullptr;
+
+    WDFCMRESLIST m_resourcesRaw = nullptr;
+    WDFCMRESLIST m_resourcesTranslated = nullptr;
+
+    QueueState m_txQueue;
+    std::vector<QueueState> m_rxQueues;
+
+    // Packets sent since the transmit queue was last advanced
+    bool m_txPending = false;
+    size_t m_txOutstanding = 0;
+
+    std::vector<RxPacket> m_received;
+    bool m_record = true;
+};
+
+}
@@ -0,0 +1,261 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#pragma once
+
+// Host stand-in for the parts of ntddk.h and ntintsafe.h the driver uses.
+// Only the types, status codes and routines RtEthSample actually references
+// are provided, with the Windows x64 sizes (ULONG and LONG are 32 bits).
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#define __declspec(x)
+#define __cdecl
+#define __forceinline inline __attribute__((always_inline))
+#define __FUNCTIONW__ L""
+
+#ifndef EXTERN_C
+#define EXTERN_C extern "C"
+#endif
+
+// SAL annotations used by the driver
+#define _In_
+#define _In_opt_
+#define _In_range_(lb, ub)
+#define _In_reads_(size)
+#define _In_reads_bytes_(size)
+#define _Inout_
+#define _Out_
+#define _Out_writes_bytes_(size)
+#define _No_competing_thread_
+#define _Requires_lock_held_(lock)
+#define _Requires_lock_not_held_(lock)
+#define _Use_decl_annotations_
+
+#define DECLSPEC_CACHEALIGN __attribute__((aligned(64)))
+#define SYSTEM_CACHE_ALIGNMENT_SIZE 64
+
+typedef void VOID;
+typedef void *PVOID;
+typedef char CHAR;
+typedef uint8_t UCHAR, *PUCHAR, UINT8, BYTE, BOOLEAN;
+typedef int16_t SHORT;
+typedef uint16_t USHORT, *PUSHORT, UINT16, WORD;
+typedef int32_t LONG, INT, INT32;
+typedef uint32_t ULONG, *PULONG, UINT32, UINT, DWORD;
+typedef int64_t LONG64, LONGLONG;
+typedef uint64_t ULONG64, UINT64, ULONGLONG, DWORD64;
+typedef uintptr_t ULONG_PTR, KAFFINITY;
+typedef size_t SIZE_T;
+typedef wchar_t WCHAR, *PWSTR;
+typedef wchar_t const *PCWSTR;
+typedef char const *PCSTR;
+typedef UCHAR KIRQL;
+typedef LONG NTSTATUS;
+
+#define TRUE 1
+#define FALSE 0
+
+#undef ULONG_MAX
+#define ULONG_MAX 0xffffffffUL
+#define USHORT_MAX 0xffff
+
+typedef union _LARGE_INTEGER
+{
+    struct
+    {
+        ULONG LowPart;
+        LONG HighPart;
+    };
+    LONGLONG QuadPart;
+} LARGE_INTEGER, PHYSICAL_ADDRESS;
+
+typedef struct _UNICODE_STRING
+{
+    USHORT Length;
+    USHORT MaximumLength;
+    PWSTR Buffer;
+} UNICODE_STRING, *PUNICODE_STRING;
+
+typedef UNICODE_STRING NDIS_STRING;
+
+#define NDIS_STRING_CONST(x) \
+    { sizeof(L##x) - sizeof(WCHAR), sizeof(L##x), (PWSTR)L##x }
+
+#define NT_SUCCESS(Status) (((NTSTATUS)(Status)) >= 0)
+
+#define STATUS_SUCCESS                  ((NTSTATUS)0x00000000L)
+#define STATUS_BUFFER_TOO_SMALL         ((NTSTATUS)0xC0000023L)
+#define STATUS_INVALID_PARAMETER        ((NTSTATUS)0xC000000DL)
+#define STATUS_RESOURCE_TYPE_NOT_FOUND  ((NTSTATUS)0xC000008BL)
+#define STATUS_INSUFFICIENT_RESOURCES   ((NTSTATUS)0xC000009AL)
+#define STATUS_CANCELLED                ((NTSTATUS)0xC0000120L)
+#define STATUS_NOT_FOUND                ((NTSTATUS)0xC0000225L)
+#define STATUS_INTEGER_OVERFLOW         ((NTSTATUS)0xC0000095L)
+#define STATUS_NDIS_RESOURCE_CONFLICT   ((NTSTATUS)0xC023001EL)
+#define STATUS_NDIS_INVALID_ADDRESS     ((NTSTATUS)0xC0230022L)
+
+#define UNREFERENCED_PARAMETER(P) ((void)(P))
+#define FIELD_OFFSET(type, field) ((LONG)offsetof(type, field))
+#define ARRAYSIZE(A) (sizeof(A) / sizeof((A)[0]))
+
+#define ALIGN_UP_POINTER_BY(Pointer, Alignment) \
+    ((PVOID)((((ULONG_PTR)(Pointer)) + (Alignment) - 1) & ~((ULONG_PTR)(Alignment) - 1)))
+
+#define RtlZeroMemory(Destination, Length) memset((Destination), 0, (Length))
+#define RtlFillMemory(Destination, Length, Fill) memset((Destination), (Fill), (Length))
+#define RtlCopyMemory(Destination, Source, Length) memcpy((Destination), (Source), (Length))
+
+template <typename A, typename B>
+inline typename std::common_type<A, B>::type min(A a, B b)
+{
+    return a < b ? a : b;
+}
+
+template <typename A, typename B>
+inline typename std::common_type<A, B>::type max(A a, B b)
+{
+    return a > b ? a : b;
+}
+
+inline
+NTSTATUS
+RtlULongMult(
+    ULONG Multiplicand,
+    ULONG Multiplier,
+    ULONG *Result)
+{
+    ULONG64 product = (ULONG64)Multiplicand * Multiplier;
+    if (product > ULONG_MAX)
+    {
+        *Result = ULONG_MAX;
+        return STATUS_INTEGER_OVERFLOW;
+    }
+
+    *Result = (ULONG)product;
+    return STATUS_SUCCESS;
+}
+
+// Assertions are always live in the harness, a failing one aborts the test
+namespace sim
+{
+[[noreturn]] void AssertFailed(char const *expression, char const *file, int line);
+}
+
+#define NT_ASSERT(Expression) \
+    ((Expression) ? (void)0 : sim::AssertFailed(#Expression, __FILE__, __LINE__))
+#define NT_ASSERTMSG(Message, Expression) NT_ASSERT(Expression)
+#define NT_FRE_ASSERTMSG(Message, Expression) NT_ASSERT(Expression)
+#define NT_VERIFY(Expression) NT_ASSERT(Expression)
+
+// Interlocked and ordering primitives
+inline LONG InterlockedExchange(LONG volatile *Target, LONG Value)
+{
+    return __atomic_exchange_n(Target, Value, __ATOMIC_SEQ_CST);
+}
+
+inline LONG InterlockedOr(LONG volatile *Target, LONG Value)
+{
+    return __atomic_fetch_or(Target, Value, __ATOMIC_SEQ_CST);
+}
+
+inline ULONG64 ReadULong64NoFence(ULONG64 const volatile *Source)
+{
+    return *Source;
+}
+
+#define MemoryBarrier() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define KeMemoryBarrier() MemoryBarrier()
+
+namespace sim
+{
+// Benchmarks turn the driver's prefetch hints off to measure their effect
+extern bool PrefetchEnabled;
+}
+
+#define PF_TEMPORAL_LEVEL_1 3
+#define PF_NON_TEMPORAL_LEVEL_ALL 0
+
+#define PreFetchCacheLine(Level, Address) \
+    (sim::PrefetchEnabled ? __builtin_prefetch((Address), 0, (Level)) : (void)0)
+
+// Time and execution. The clock is the simulated one, stalls advance it and
+// let the device model make progress, as the hardware would while the
+// processor spins.
+ULONG64 KeQueryInterruptTime();
+void KeStallExecutionProcessor(ULONG MicroSeconds);
+void KeFlushQueuedDpcs();
+
+// Resources
+typedef enum _POOL_TYPE
+{
+    NonPagedPoolNx = 512,
+} POOL_TYPE;
+
+#define PAGE_READWRITE 0x04
+#define PAGE_NOCACHE 0x200
+
+PVOID MmMapIoSpaceEx(PHYSICAL_ADDRESS PhysicalAddress, SIZE_T NumberOfBytes, ULONG Protect);
+void MmUnmapIoSpace(PVOID BaseAddress, SIZE_T NumberOfBytes);
+
+#define CmResourceTypeNull 0
+#define CmResourceTypePort 1
+#define CmResourceTypeInterrupt 2
+#define CmResourceTypeMemory 3
+
+#define CM_RESOURCE_INTERRUPT_LATCHED 0x0001
+#define CM_RESOURCE_INTERRUPT_MESSAGE 0x0002
+
+typedef struct _CM_PARTIAL_RESOURCE_DESCRIPTOR
+{
+    UCHAR Type;
+    UCHAR ShareDisposition;
+    USHORT Flags;
+    union
+    {
+        struct
+        {
+            PHYSICAL_ADDRESS Start;
+            ULONG Length;
+        } Memory;
+        struct
+        {
+            union
+            {
+                struct
+                {
+                    USHORT Group;
+                    USHORT MessageCount;
+                    ULONG Vector;
+                    KAFFINITY Affinity;
+                } Raw;
+                struct
+                {
+                    ULONG Level;
+                    ULONG Vector;
+                    KAFFINITY Affinity;
+                } Translated;
+            };
+        } MessageInterrupt;
+    } u;
+} CM_PARTIAL_RESOURCE_DESCRIPTOR, *PCM_PARTIAL_RESOURCE_DESCRIPTOR;
+
+// Driver object
+typedef struct _DRIVER_OBJECT
+{
+    PVOID DriverExtension;
+} DRIVER_OBJECT, *PDRIVER_OBJECT;
+
+typedef NTSTATUS DRIVER_INITIALIZE(PDRIVER_OBJECT DriverObject, PUNICODE_STRING RegistryPath);
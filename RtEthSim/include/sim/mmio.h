@@ -0,0 +1,96 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#pragma once
+
+#include <csignal>
+#include <vector>
+
+#include "sim/kernel.h"
+
+namespace sim
+{
+
+struct MmioWrite
+{
+    UINT16 Offset;
+    // The four bytes at Offset right after the write, before any write one
+    // to clear semantics applied
+    UINT32 Value;
+};
+
+// The register window MmMapIoSpaceEx hands the driver. The device model
+// works on its own alias of the same page, so its accesses are never seen
+// by the driver view.
+//
+// With trapping on, the driver view is mapped without access. Every driver
+// access faults, is counted against the register it starts at and is then
+// single stepped with the page opened. This is slow, but it counts the
+// accesses the compiled driver makes, and it lets the interrupt status
+// registers behave as write one to clear. Only one window can trap at a
+// time.
+class Mmio
+{
+public:
+    static constexpr size_t Size = 0x100;
+
+    explicit Mmio(bool trap);
+    ~Mmio();
+
+    Mmio(Mmio const &) = delete;
+    Mmio &operator=(Mmio const &) = delete;
+
+    void *DriverView() const { return m_driverView; }
+    UCHAR *DeviceView() const { return m_deviceView; }
+    bool Trapping() const { return m_trap; }
+
+    // Driver accesses starting at offset, counted while trapping
+    ULONG64 Reads(size_t offset, size_t length = 1) const;
+    ULONG64 Writes(size_t offset, size_t length = 1) const;
+
+    // The same, for the accesses made while the host runs an ISR
+    ULONG64 IsrReads(size_t offset, size_t length = 1) const;
+    ULONG64 IsrWrites(size_t offset, size_t length = 1) const;
+    void SetInIsr(bool inIsr) { m_inIsr = inIsr; }
+
+    // Driver writes in the order they were made, up to the first 65536
+    std::vector<MmioWrite> WriteLog() const;
+
+    void ResetCounts();
+
+private:
+    static void OnAccess(int, siginfo_t *, void *);
+    static void OnStep(int, siginfo_t *, void *);
+
+    bool m_trap;
+    int m_fd = -1;
+    UCHAR *m_driverView = nullptr;
+    UCHAR *m_deviceView = nullptr;
+
+    ULONG64 m_reads[Size] = {};
+    ULONG64 m_writes[Size] = {};
+
+    bool m_inIsr = false;
+    ULONG64 m_isrReads[Size] = {};
+    ULONG64 m_isrWrites[Size] = {};
+
+    // Filled from the signal handlers, so nothing is allocated there
+    static constexpr size_t WriteLogSize = 1 << 16;
+    MmioWrite m_writeLog[WriteLogSize];
+    size_t m_writeCount = 0;
+
+    // The access being single stepped
+    size_t m_offset = 0;
+    bool m_write = false;
+    UINT16 m_before = 0;
+};
+
+}
@@ -0,0 +1,940 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#pragma once
+
+// Host stand-in for the NetAdapterCx preview headers, the net/ ring and
+// extension headers, and the few NDIS and netiodef.h definitions the driver
+// uses. Ring and extension layouts follow the framework's; the objects
+// behind the handles live in src/netadapter.cpp.
+
+#include "sim/wdf.h"
+
+#define DECLARE_NET_HANDLE(name) DECLARE_WDF_HANDLE(name)
+
+DECLARE_NET_HANDLE(NETADAPTER);
+DECLARE_NET_HANDLE(NETPACKETQUEUE);
+DECLARE_NET_HANDLE(NETCONFIGURATION);
+DECLARE_NET_HANDLE(NETOFFLOAD);
+DECLARE_NET_HANDLE(NETWAKESOURCE);
+
+typedef struct NETADAPTER_INIT NETADAPTER_INIT;
+typedef struct NETTXQUEUE_INIT NETTXQUEUE_INIT;
+typedef struct NETRXQUEUE_INIT NETRXQUEUE_INIT;
+
+// NDIS and netiodef.h
+
+typedef int NDIS_STATUS;
+
+#define NDIS_STATUS_BUFFER_TOO_SHORT ((NDIS_STATUS)0xC0010016L)
+#define NDIS_STATUS_REQUEST_ABORTED ((NDIS_STATUS)0xC001000CL)
+#define NDIS_STATUS_LINK_STATE ((NDIS_STATUS)0x40010017L)
+#define NDIS_ERROR_CODE_RESOURCE_CONFLICT 0xC000138AL
+#define NDIS_LINK_SPEED_UNKNOWN ((ULONG64)-1)
+
+#define ETH_LENGTH_OF_ADDRESS 6
+#define ETH_LENGTH_OF_HEADER 14
+#define ETHERNET_ADDRESS_LENGTH 6
+
+#define ETH_IS_MULTICAST(Address) ((bool)(((PUCHAR)(Address))[0] & ((UCHAR)0x01)))
+#define ETH_IS_BROADCAST(Address) \
+    ((((PUCHAR)(Address))[0] == ((UCHAR)0xff)) && (((PUCHAR)(Address))[1] == ((UCHAR)0xff)) && \
+     (((PUCHAR)(Address))[2] == ((UCHAR)0xff)) && (((PUCHAR)(Address))[3] == ((UCHAR)0xff)) && \
+     (((PUCHAR)(Address))[4] == ((UCHAR)0xff)) && (((PUCHAR)(Address))[5] == ((UCHAR)0xff)))
+
+typedef struct _ETHERNET_HEADER
+{
+    UCHAR Destination[ETH_LENGTH_OF_ADDRESS];
+    UCHAR Source[ETH_LENGTH_OF_ADDRESS];
+    USHORT Type;
+} ETHERNET_HEADER;
+
+typedef enum _NDIS_MEDIA_CONNECT_STATE
+{
+    MediaConnectStateUnknown,
+    MediaConnectStateConnected,
+    MediaConnectStateDisconnected,
+} NDIS_MEDIA_CONNECT_STATE;
+
+typedef enum _NET_IF_MEDIA_DUPLEX_STATE
+{
+    MediaDuplexStateUnknown = 0,
+    MediaDuplexStateHalf = 1,
+    MediaDuplexStateFull = 2,
+} NET_IF_MEDIA_DUPLEX_STATE;
+
+#define NDIS_OBJECT_TYPE_OFFLOAD 0xA7
+#define NDIS_OFFLOAD_REVISION_5 5
+#define NDIS_SIZEOF_NDIS_OFFLOAD_REVISION_5 sizeof(NDIS_OFFLOAD)
+#define NDIS_OFFLOAD_NOT_SUPPORTED 0
+#define NDIS_OFFLOAD_SUPPORTED 1
+#define NDIS_ENCAPSULATION_NOT_SUPPORTED 0x00000000
+#define NDIS_ENCAPSULATION_IEEE_802_3 0x00000002
+#define NDIS_ENCAPSULATION_IEEE_802_3_P_AND_Q_IN_OOB 0x00000008
+
+typedef struct _NDIS_OBJECT_HEADER
+{
+    UCHAR Type;
+    UCHAR Revision;
+    USHORT Size;
+} NDIS_OBJECT_HEADER;
+
+typedef struct _NDIS_TCP_IP_CHECKSUM_OFFLOAD_DIRECTION
+{
+    ULONG Encapsulation;
+    ULONG IpOptionsSupported : 2;
+    ULONG TcpOptionsSupported : 2;
+    ULONG TcpChecksum : 2;
+    ULONG UdpChecksum : 2;
+    ULONG IpChecksum : 2;
+    ULONG IpExtensionHeadersSupported : 2;
+} NDIS_TCP_IP_CHECKSUM_OFFLOAD_DIRECTION;
+
+typedef struct _NDIS_TCP_IP_CHECKSUM_OFFLOAD
+{
+    NDIS_TCP_IP_CHECKSUM_OFFLOAD_DIRECTION IPv4Transmit;
+    NDIS_TCP_IP_CHECKSUM_OFFLOAD_DIRECTION IPv4Receive;
+    NDIS_TCP_IP_CHECKSUM_OFFLOAD_DIRECTION IPv6Transmit;
+    NDIS_TCP_IP_CHECKSUM_OFFLOAD_DIRECTION IPv6Receive;
+} NDIS_TCP_IP_CHECKSUM_OFFLOAD;
+
+typedef struct _NDIS_TCP_LARGE_SEND_OFFLOAD_V1
+{
+    struct
+    {
+        ULONG Encapsulation;
+        ULONG MaxOffLoadSize;
+        ULONG MinSegmentCount;
+        ULONG TcpOptions : 2;
+        ULONG IpOptions : 2;
+    } IPv4;
+} NDIS_TCP_LARGE_SEND_OFFLOAD_V1;
+
+typedef struct _NDIS_TCP_LARGE_SEND_OFFLOAD_V2
+{
+    struct
+    {
+        ULONG Encapsulation;
+        ULONG MaxOffLoadSize;
+        ULONG MinSegmentCount;
+    } IPv4;
+    struct
+    {
+        ULONG Encapsulation;
+        ULONG MaxOffLoadSize;
+        ULONG MinSegmentCount;
+        ULONG IpExtensionHeadersSupported : 2;
+        ULONG TcpOptionsSupported : 2;
+    } IPv6;
+} NDIS_TCP_LARGE_SEND_OFFLOAD_V2;
+
+typedef struct _NDIS_OFFLOAD
+{
+    NDIS_OBJECT_HEADER Header;
+    NDIS_TCP_IP_CHECKSUM_OFFLOAD Checksum;
+    NDIS_TCP_LARGE_SEND_OFFLOAD_V1 LsoV1;
+    NDIS_TCP_LARGE_SEND_OFFLOAD_V2 LsoV2;
+} NDIS_OFFLOAD;
+
+// Flag enums combine with | and |= as with DEFINE_ENUM_FLAG_OPERATORS
+
+#define DEFINE_ENUM_FLAG_OPERATORS(ENUMTYPE) \
+    inline ENUMTYPE operator|(ENUMTYPE a, ENUMTYPE b) { return ENUMTYPE(((int)a) | ((int)b)); } \
+    inline ENUMTYPE &operator|=(ENUMTYPE &a, ENUMTYPE b) { return a = a | b; } \
+    inline ENUMTYPE operator&(ENUMTYPE a, ENUMTYPE b) { return ENUMTYPE(((int)a) & ((int)b)); } \
+    inline ENUMTYPE operator~(ENUMTYPE a) { return ENUMTYPE(~((int)a)); }
+
+// Rings, packets and fragments
+
+typedef struct _NET_RING
+{
+    UINT16 OSReserved1;
+    UINT16 ElementStride;
+    UINT32 NumberOfElements;
+    UINT32 ElementIndexMask;
+    UINT32 EndIndex;
+    void *OSReserved0;
+    UINT32 BeginIndex;
+    UINT32 NextIndex;
+    void *Scratch;
+    void *OSReserved2[4];
+    UCHAR *Buffer;
+} NET_RING;
+
+typedef enum _NET_RING_TYPE
+{
+    NetRingTypePacket,
+    NetRingTypeFragment,
+} NET_RING_TYPE;
+
+typedef struct _NET_RING_COLLECTION
+{
+    NET_RING *Rings[2];
+} NET_RING_COLLECTION;
+
+typedef enum _NET_PACKET_LAYER2_TYPE
+{
+    NetPacketLayer2TypeUnspecified,
+    NetPacketLayer2TypeNull,
+    NetPacketLayer2TypeEthernet,
+} NET_PACKET_LAYER2_TYPE;
+
+typedef enum _NET_PACKET_LAYER3_TYPE
+{
+    NetPacketLayer3TypeUnspecified,
+    NetPacketLayer3TypeIPv4UnspecifiedOptions,
+    NetPacketLayer3TypeIPv4WithOptions,
+    NetPacketLayer3TypeIPv4NoOptions,
+    NetPacketLayer3TypeIPv6UnspecifiedExtensions,
+    NetPacketLayer3TypeIPv6WithExtensions,
+    NetPacketLayer3TypeIPv6NoExtensions,
+} NET_PACKET_LAYER3_TYPE;
+
+typedef enum _NET_PACKET_LAYER4_TYPE
+{
+    NetPacketLayer4TypeUnspecified,
+    NetPacketLayer4TypeTcp,
+    NetPacketLayer4TypeUdp,
+    NetPacketLayer4TypeIPFragment,
+    NetPacketLayer4TypeIPNotFragment,
+} NET_PACKET_LAYER4_TYPE;
+
+typedef struct _NET_PACKET_LAYOUT
+{
+    UINT8 Layer2Type : 4;
+    UINT8 Layer3Type : 4;
+    UINT8 Layer4Type : 4;
+    UINT8 Reserved0 : 4;
+    UINT8 Layer2HeaderLength : 7;
+    UINT16 Layer3HeaderLength : 9;
+    UINT8 Layer4HeaderLength : 8;
+} NET_PACKET_LAYOUT;
+
+typedef struct _NET_PACKET
+{
+    UINT32 FragmentIndex;
+    UINT16 FragmentCount;
+    NET_PACKET_LAYOUT Layout;
+    UINT16 Ignore : 1;
+    UINT16 Scratch : 1;
+    UINT16 Reserved0 : 14;
+} NET_PACKET;
+
+typedef struct _NET_FRAGMENT
+{
+    UINT64 ValidLength : 26;
+    UINT64 Capacity : 26;
+    UINT64 Offset : 10;
+    UINT64 Scratch : 1;
+    UINT64 OsReserved : 1;
+} NET_FRAGMENT;
+
+inline void *NetRingGetElementAtIndex(NET_RING const *Ring, UINT32 Index)
+{
+    return Ring->Buffer + (size_t)Ring->ElementStride * Index;
+}
+
+inline NET_PACKET *NetRingGetPacketAtIndex(NET_RING const *Ring, UINT32 Index)
+{
+    return static_cast<NET_PACKET *>(NetRingGetElementAtIndex(Ring, Index));
+}
+
+inline NET_FRAGMENT *NetRingGetFragmentAtIndex(NET_RING const *Ring, UINT32 Index)
+{
+    return static_cast<NET_FRAGMENT *>(NetRingGetElementAtIndex(Ring, Index));
+}
+
+inline UINT32 NetRingIncrementIndex(NET_RING const *Ring, UINT32 Index)
+{
+    return (Index + 1) & Ring->ElementIndexMask;
+}
+
+inline NET_RING *NetRingCollectionGetPacketRing(NET_RING_COLLECTION const *Rings)
+{
+    return Rings->Rings[NetRingTypePacket];
+}
+
+inline NET_RING *NetRingCollectionGetFragmentRing(NET_RING_COLLECTION const *Rings)
+{
+    return Rings->Rings[NetRingTypeFragment];
+}
+
+inline bool NetPacketIsIpv4(NET_PACKET const *Packet)
+{
+    return Packet->Layout.Layer3Type >= NetPacketLayer3TypeIPv4UnspecifiedOptions &&
+        Packet->Layout.Layer3Type <= NetPacketLayer3TypeIPv4NoOptions;
+}
+
+inline bool NetPacketIsIpv6(NET_PACKET const *Packet)
+{
+    return Packet->Layout.Layer3Type >= NetPacketLayer3TypeIPv6UnspecifiedExtensions &&
+        Packet->Layout.Layer3Type <= NetPacketLayer3TypeIPv6NoExtensions;
+}
+
+// Extensions. An enabled extension is a base address and a per-index stride.
+
+typedef enum _NET_EXTENSION_TYPE
+{
+    NetExtensionTypePacket = 1,
+    NetExtensionTypeFragment,
+} NET_EXTENSION_TYPE;
+
+typedef struct _NET_EXTENSION
+{
+    UCHAR *Base;
+    size_t Stride;
+    BOOLEAN Enabled;
+} NET_EXTENSION;
+
+typedef struct _NET_EXTENSION_QUERY
+{
+    ULONG Size;
+    PCWSTR Name;
+    ULONG Version;
+    NET_EXTENSION_TYPE Type;
+} NET_EXTENSION_QUERY;
+
+inline void NET_EXTENSION_QUERY_INIT(NET_EXTENSION_QUERY *Query, PCWSTR Name, ULONG Version, NET_EXTENSION_TYPE Type)
+{
+    *Query = {};
+    Query->Size = sizeof(NET_EXTENSION_QUERY);
+    Query->Name = Name;
+    Query->Version = Version;
+    Query->Type = Type;
+}
+
+inline void *NetExtensionGetData(NET_EXTENSION const *Extension, UINT32 Index)
+{
+    return Extension->Base + Extension->Stride * Index;
+}
+
+#define NET_PACKET_EXTENSION_CHECKSUM_NAME L"ms_packetchecksum"
+#define NET_PACKET_EXTENSION_CHECKSUM_VERSION_1 1
+#define NET_PACKET_EXTENSION_LSO_NAME L"ms_packetlargesendsegmentation"
+#define NET_PACKET_EXTENSION_LSO_VERSION_1 1
+#define NET_PACKET_EXTENSION_IEEE8021Q_NAME L"ms_packetieee8021q"
+#define NET_PACKET_EXTENSION_IEEE8021Q_VERSION_1 1
+#define NET_FRAGMENT_EXTENSION_VIRTUAL_ADDRESS_NAME L"ms_fragment_virtualaddress"
+#define NET_FRAGMENT_EXTENSION_VIRTUAL_ADDRESS_VERSION_1 1
+#define NET_FRAGMENT_EXTENSION_LOGICAL_ADDRESS_NAME L"ms_fragment_logicaladdress"
+#define NET_FRAGMENT_EXTENSION_LOGICAL_ADDRESS_VERSION_1 1
+
+typedef enum _NET_PACKET_RX_CHECKSUM_EVALUATION
+{
+    NetPacketRxChecksumEvaluationNotChecked = 0,
+    NetPacketRxChecksumEvaluationValid = 1,
+    NetPacketRxChecksumEvaluationInvalid = 2,
+} NET_PACKET_RX_CHECKSUM_EVALUATION;
+
+typedef enum _NET_PACKET_TX_CHECKSUM_ACTION
+{
+    NetPacketTxChecksumActionPassthrough = 0,
+    NetPacketTxChecksumActionRequired = 2,
+} NET_PACKET_TX_CHECKSUM_ACTION;
+
+typedef struct _NET_PACKET_CHECKSUM
+{
+    UINT8 Layer2 : 2;
+    UINT8 Layer3 : 2;
+    UINT8 Layer4 : 2;
+} NET_PACKET_CHECKSUM;
+
+typedef struct _NET_PACKET_LSO
+{
+    struct
+    {
+        UINT32 Mss : 20;
+    } TCP;
+} NET_PACKET_LSO;
+
+typedef enum _NET_PACKET_TX_IEEE8021Q_ACTION_FLAGS
+{
+    NetPacketTxIeee8021qActionFlagPriorityRequired = 1,
+    NetPacketTxIeee8021qActionFlagVlanRequired = 2,
+} NET_PACKET_TX_IEEE8021Q_ACTION_FLAGS;
+
+typedef struct _NET_PACKET_IEEE8021Q
+{
+    UINT16 VlanIdentifier : 12;
+    UINT8 PriorityCodePoint : 3;
+    UINT8 TxTagging : 2;
+} NET_PACKET_IEEE8021Q;
+
+typedef UINT64 LOGICAL_ADDRESS;
+
+typedef struct _NET_FRAGMENT_VIRTUAL_ADDRESS
+{
+    void *VirtualAddress;
+} NET_FRAGMENT_VIRTUAL_ADDRESS;
+
+typedef struct _NET_FRAGMENT_LOGICAL_ADDRESS
+{
+    LOGICAL_ADDRESS LogicalAddress;
+} NET_FRAGMENT_LOGICAL_ADDRESS;
+
+inline NET_PACKET_CHECKSUM *NetExtensionGetPacketChecksum(NET_EXTENSION const *Extension, UINT32 Index)
+{
+    return static_cast<NET_PACKET_CHECKSUM *>(NetExtensionGetData(Extension, Index));
+}
+
+inline NET_PACKET_LSO *NetExtensionGetPacketLso(NET_EXTENSION const *Extension, UINT32 Index)
+{
+    return static_cast<NET_PACKET_LSO *>(NetExtensionGetData(Extension, Index));
+}
+
+inline NET_PACKET_IEEE8021Q *NetExtensionGetPacketIeee8021Q(NET_EXTENSION const *Extension, UINT32 Index)
+{
+    return static_cast<NET_PACKET_IEEE8021Q *>(NetExtensionGetData(Extension, Index));
+}
+
+inline NET_FRAGMENT_VIRTUAL_ADDRESS *NetExtensionGetFragmentVirtualAddress(NET_EXTENSION const *Extension, UINT32 Index)
+{
+    return static_cast<NET_FRAGMENT_VIRTUAL_ADDRESS *>(NetExtensionGetData(Extension, Index));
+}
+
+inline NET_FRAGMENT_LOGICAL_ADDRESS *NetExtensionGetFragmentLogicalAddress(NET_EXTENSION const *Extension, UINT32 Index)
+{
+    return static_cast<NET_FRAGMENT_LOGICAL_ADDRESS *>(NetExtensionGetData(Extension, Index));
+}
+
+// Device and adapter
+
+NTSTATUS NetDeviceInitConfig(PWDFDEVICE_INIT DeviceInit);
+
+typedef NTSTATUS EVT_NET_ADAPTER_CREATE_TXQUEUE(NETADAPTER Adapter, NETTXQUEUE_INIT *TxQueueInit);
+typedef EVT_NET_ADAPTER_CREATE_TXQUEUE *PFN_NET_ADAPTER_CREATE_TXQUEUE;
+typedef NTSTATUS EVT_NET_ADAPTER_CREATE_RXQUEUE(NETADAPTER Adapter, NETRXQUEUE_INIT *RxQueueInit);
+typedef EVT_NET_ADAPTER_CREATE_RXQUEUE *PFN_NET_ADAPTER_CREATE_RXQUEUE;
+
+typedef struct _NET_ADAPTER_DATAPATH_CALLBACKS
+{
+    ULONG Size;
+    PFN_NET_ADAPTER_CREATE_TXQUEUE EvtAdapterCreateTxQueue;
+    PFN_NET_ADAPTER_CREATE_RXQUEUE EvtAdapterCreateRxQueue;
+} NET_ADAPTER_DATAPATH_CALLBACKS;
+
+inline void NET_ADAPTER_DATAPATH_CALLBACKS_INIT(
+    NET_ADAPTER_DATAPATH_CALLBACKS *Callbacks,
+    PFN_NET_ADAPTER_CREATE_TXQUEUE EvtCreateTxQueue,
+    PFN_NET_ADAPTER_CREATE_RXQUEUE EvtCreateRxQueue)
+{
+    *Callbacks = {};
+    Callbacks->Size = sizeof(NET_ADAPTER_DATAPATH_CALLBACKS);
+    Callbacks->EvtAdapterCreateTxQueue = EvtCreateTxQueue;
+    Callbacks->EvtAdapterCreateRxQueue = EvtCreateRxQueue;
+}
+
+NETADAPTER_INIT *NetAdapterInitAllocate(WDFDEVICE Device);
+void NetAdapterInitFree(NETADAPTER_INIT *AdapterInit);
+void NetAdapterInitSetDatapathCallbacks(NETADAPTER_INIT *AdapterInit, NET_ADAPTER_DATAPATH_CALLBACKS const *DatapathCallbacks);
+NTSTATUS NetAdapterCreate(NETADAPTER_INIT *AdapterInit, WDF_OBJECT_ATTRIBUTES *AdapterAttributes, NETADAPTER *Adapter);
+NTSTATUS NetAdapterStart(NETADAPTER Adapter);
+
+// Link layer
+
+#define NDIS_MAX_PHYS_ADDRESS_LENGTH 32
+
+typedef struct _NET_ADAPTER_LINK_LAYER_ADDRESS
+{
+    USHORT Length;
+    UCHAR Address[NDIS_MAX_PHYS_ADDRESS_LENGTH];
+} NET_ADAPTER_LINK_LAYER_ADDRESS;
+
+typedef struct _NET_ADAPTER_LINK_LAYER_CAPABILITIES
+{
+    ULONG Size;
+    ULONG64 MaxTxLinkSpeed;
+    ULONG64 MaxRxLinkSpeed;
+} NET_ADAPTER_LINK_LAYER_CAPABILITIES;
+
+inline void NET_ADAPTER_LINK_LAYER_CAPABILITIES_INIT(
+    NET_ADAPTER_LINK_LAYER_CAPABILITIES *Capabilities,
+    ULONG64 MaxTxLinkSpeed,
+    ULONG64 MaxRxLinkSpeed)
+{
+    *Capabilities = {};
+    Capabilities->Size = sizeof(NET_ADAPTER_LINK_LAYER_CAPABILITIES);
+    Capabilities->MaxTxLinkSpeed = MaxTxLinkSpeed;
+    Capabilities->MaxRxLinkSpeed = MaxRxLinkSpeed;
+}
+
+void NetAdapterSetLinkLayerCapabilities(NETADAPTER Adapter, NET_ADAPTER_LINK_LAYER_CAPABILITIES const *Capabilities);
+void NetAdapterSetLinkLayerMtuSize(NETADAPTER Adapter, ULONG MtuSize);
+void NetAdapterSetPermanentLinkLayerAddress(NETADAPTER Adapter, NET_ADAPTER_LINK_LAYER_ADDRESS *LinkLayerAddress);
+void NetAdapterSetCurrentLinkLayerAddress(NETADAPTER Adapter, NET_ADAPTER_LINK_LAYER_ADDRESS *LinkLayerAddress);
+
+typedef enum _NET_PACKET_FILTER_FLAGS
+{
+    NetPacketFilterFlagDirected = 0x00000001,
+    NetPacketFilterFlagMulticast = 0x00000002,
+    NetPacketFilterFlagAllMulticast = 0x00000004,
+    NetPacketFilterFlagBroadcast = 0x00000008,
+    NetPacketFilterFlagPromiscuous = 0x00000020,
+} NET_PACKET_FILTER_FLAGS;
+
+DEFINE_ENUM_FLAG_OPERATORS(NET_PACKET_FILTER_FLAGS);
+
+typedef void EVT_NET_ADAPTER_SET_RECEIVE_FILTER(NETADAPTER Adapter, NET_PACKET_FILTER_FLAGS PacketFilter);
+typedef EVT_NET_ADAPTER_SET_RECEIVE_FILTER *PFN_NET_ADAPTER_SET_RECEIVE_FILTER;
+
+typedef struct _NET_ADAPTER_PACKET_FILTER_CAPABILITIES
+{
+    ULONG Size;
+    NET_PACKET_FILTER_FLAGS SupportedPacketFilters;
+    PFN_NET_ADAPTER_SET_RECEIVE_FILTER EvtSetPacketFilter;
+} NET_ADAPTER_PACKET_FILTER_CAPABILITIES;
+
+inline void NET_ADAPTER_PACKET_FILTER_CAPABILITIES_INIT(
+    NET_ADAPTER_PACKET_FILTER_CAPABILITIES *Capabilities,
+    NET_PACKET_FILTER_FLAGS SupportedPacketFilters,
+    PFN_NET_ADAPTER_SET_RECEIVE_FILTER EvtSetPacketFilter)
+{
+    *Capabilities = {};
+    Capabilities->Size = sizeof(NET_ADAPTER_PACKET_FILTER_CAPABILITIES);
+    Capabilities->SupportedPacketFilters = SupportedPacketFilters;
+    Capabilities->EvtSetPacketFilter = EvtSetPacketFilter;
+}
+
+void NetAdapterSetPacketFilterCapabilities(NETADAPTER Adapter, NET_ADAPTER_PACKET_FILTER_CAPABILITIES const *Capabilities);
+
+typedef void EVT_NET_ADAPTER_SET_MULTICAST_LIST(
+    NETADAPTER Adapter,
+    ULONG MulticastAddressCount,
+    NET_ADAPTER_LINK_LAYER_ADDRESS *MulticastAddressList);
+typedef EVT_NET_ADAPTER_SET_MULTICAST_LIST *PFN_NET_ADAPTER_SET_MULTICAST_LIST;
+
+typedef struct _NET_ADAPTER_MULTICAST_CAPABILITIES
+{
+    ULONG Size;
+    ULONG MaximumMulticastAddresses;
+    PFN_NET_ADAPTER_SET_MULTICAST_LIST EvtSetMulticastList;
+} NET_ADAPTER_MULTICAST_CAPABILITIES;
+
+inline void NET_ADAPTER_MULTICAST_CAPABILITIES_INIT(
+    NET_ADAPTER_MULTICAST_CAPABILITIES *Capabilities,
+    ULONG MaximumMulticastAddresses,
+    PFN_NET_ADAPTER_SET_MULTICAST_LIST EvtSetMulticastList)
+{
+    *Capabilities = {};
+    Capabilities->Size = sizeof(NET_ADAPTER_MULTICAST_CAPABILITIES);
+    Capabilities->MaximumMulticastAddresses = MaximumMulticastAddresses;
+    Capabilities->EvtSetMulticastList = EvtSetMulticastList;
+}
+
+void NetAdapterSetMulticastCapabilities(NETADAPTER Adapter, NET_ADAPTER_MULTICAST_CAPABILITIES const *Capabilities);
+
+// Link state
+
+typedef enum _NET_ADAPTER_PAUSE_FUNCTION_TYPE
+{
+    NetAdapterPauseFunctionTypeUnsupported,
+    NetAdapterPauseFunctionTypeSendOnly,
+    NetAdapterPauseFunctionTypeReceiveOnly,
+    NetAdapterPauseFunctionTypeSendAndReceive,
+    NetAdapterPauseFunctionTypeUnknown,
+} NET_ADAPTER_PAUSE_FUNCTION_TYPE;
+
+typedef enum _NET_ADAPTER_AUTO_NEGOTIATION_FLAGS
+{
+    NetAdapterAutoNegotiationFlagNone = 0x00000000,
+    NetAdapterAutoNegotiationFlagXmitLinkSpeedAutoNegotiated = 0x00000001,
+    NetAdapterAutoNegotiationFlagRcvLinkSpeedautoNegotiated = 0x00000002,
+    NetAdapterAutoNegotiationFlagDuplexAutoNegotiated = 0x00000004,
+    NetAdapterAutoNegotiationFlagPauseFunctionsAutoNegotiated = 0x00000008,
+} NET_ADAPTER_AUTO_NEGOTIATION_FLAGS;
+
+DEFINE_ENUM_FLAG_OPERATORS(NET_ADAPTER_AUTO_NEGOTIATION_FLAGS);
+
+typedef struct _NET_ADAPTER_LINK_STATE
+{
+    ULONG Size;
+    NDIS_MEDIA_CONNECT_STATE MediaConnectState;
+    NET_IF_MEDIA_DUPLEX_STATE MediaDuplexState;
+    ULONG64 TxLinkSpeed;
+    ULONG64 RxLinkSpeed;
+    NET_ADAPTER_PAUSE_FUNCTION_TYPE SupportedPauseFunctions;
+    NET_ADAPTER_AUTO_NEGOTIATION_FLAGS AutoNegotiationFlags;
+} NET_ADAPTER_LINK_STATE;
+
+inline void NET_ADAPTER_LINK_STATE_INIT(
+    NET_ADAPTER_LINK_STATE *LinkState,
+    ULONG64 LinkSpeed,
+    NDIS_MEDIA_CONNECT_STATE MediaConnectState,
+    NET_IF_MEDIA_DUPLEX_STATE MediaDuplexState,
+    NET_ADAPTER_PAUSE_FUNCTION_TYPE SupportedPauseFunctions,
+    NET_ADAPTER_AUTO_NEGOTIATION_FLAGS AutoNegotiationFlags)
+{
+    *LinkState = {};
+    LinkState->Size = sizeof(NET_ADAPTER_LINK_STATE);
+    LinkState->MediaConnectState = MediaConnectState;
+    LinkState->MediaDuplexState = MediaDuplexState;
+    LinkState->TxLinkSpeed = LinkSpeed;
+    LinkState->RxLinkSpeed = LinkSpeed;
+    LinkState->SupportedPauseFunctions = SupportedPauseFunctions;
+    LinkState->AutoNegotiationFlags = AutoNegotiationFlags;
+}
+
+void NetAdapterSetLinkState(NETADAPTER Adapter, NET_ADAPTER_LINK_STATE *LinkState);
+
+// Receive side scaling
+
+typedef enum _NET_ADAPTER_RECEIVE_SCALING_UNHASHED_TARGET_TYPE
+{
+    NetAdapterReceiveScalingUnhashedTargetTypeUndefined = 0,
+    NetAdapterReceiveScalingUnhashedTargetTypeHashIndex,
+} NET_ADAPTER_RECEIVE_SCALING_UNHASHED_TARGET_TYPE;
+
+typedef enum _NET_ADAPTER_RECEIVE_SCALING_HASH_TYPE
+{
+    NetAdapterReceiveScalingHashTypeNone = 0x00000000,
+    NetAdapterReceiveScalingHashTypeToeplitz = 0x00000001,
+} NET_ADAPTER_RECEIVE_SCALING_HASH_TYPE;
+
+typedef enum _NET_ADAPTER_RECEIVE_SCALING_PROTOCOL_TYPE
+{
+    NetAdapterReceiveScalingProtocolTypeNone = 0x00000000,
+    NetAdapterReceiveScalingProtocolTypeIPv4 = 0x00000001,
+    NetAdapterReceiveScalingProtocolTypeIPv4Options = 0x00000002,
+    NetAdapterReceiveScalingProtocolTypeIPv6 = 0x00000004,
+    NetAdapterReceiveScalingProtocolTypeIPv6Extensions = 0x00000008,
+    NetAdapterReceiveScalingProtocolTypeTcp = 0x00000010,
+    NetAdapterReceiveScalingProtocolTypeUdp = 0x00000020,
+} NET_ADAPTER_RECEIVE_SCALING_PROTOCOL_TYPE;
+
+DEFINE_ENUM_FLAG_OPERATORS(NET_ADAPTER_RECEIVE_SCALING_PROTOCOL_TYPE);
+
+typedef struct _NET_ADAPTER_RECEIVE_SCALING_HASH_SECRET_KEY
+{
+    UCHAR const *Key;
+    size_t Length;
+} NET_ADAPTER_RECEIVE_SCALING_HASH_SECRET_KEY;
+
+typedef struct _NET_ADAPTER_RECEIVE_SCALING_INDIRECTION_ENTRY
+{
+    UINT32 Index;
+    NETPACKETQUEUE PacketQueue;
+    NTSTATUS Status;
+} NET_ADAPTER_RECEIVE_SCALING_INDIRECTION_ENTRY;
+
+typedef struct _NET_ADAPTER_RECEIVE_SCALING_INDIRECTION_ENTRIES
+{
+    size_t Length;
+    NET_ADAPTER_RECEIVE_SCALING_INDIRECTION_ENTRY *Entries;
+} NET_ADAPTER_RECEIVE_SCALING_INDIRECTION_ENTRIES;
+
+typedef NTSTATUS EVT_NET_ADAPTER_RECEIVE_SCALING_ENABLE(
+    NETADAPTER Adapter,
+    NET_ADAPTER_RECEIVE_SCALING_HASH_TYPE HashType,
+    NET_ADAPTER_RECEIVE_SCALING_PROTOCOL_TYPE ProtocolType);
+typedef void EVT_NET_ADAPTER_RECEIVE_SCALING_DISABLE(NETADAPTER Adapter);
+typedef NTSTATUS EVT_NET_ADAPTER_RECEIVE_SCALING_SET_HASH_SECRET_KEY(
+    NETADAPTER Adapter,
+    NET_ADAPTER_RECEIVE_SCALING_HASH_SECRET_KEY const *HashSecretKey);
+typedef NTSTATUS EVT_NET_ADAPTER_RECEIVE_SCALING_SET_INDIRECTION_ENTRIES(
+    NETADAPTER Adapter,
+    NET_ADAPTER_RECEIVE_SCALING_INDIRECTION_ENTRIES *IndirectionEntries);
+
+typedef struct _NET_ADAPTER_RECEIVE_SCALING_CAPABILITIES
+{
+    ULONG Size;
+    ULONG NumberOfQueues;
+    ULONG IndirectionTableSize;
+    NET_ADAPTER_RECEIVE_SCALING_UNHASHED_TARGET_TYPE UnhashedTarget;
+    NET_ADAPTER_RECEIVE_SCALING_HASH_TYPE HashTypes;
+    NET_ADAPTER_RECEIVE_SCALING_PROTOCOL_TYPE ProtocolTypes;
+    EVT_NET_ADAPTER_RECEIVE_SCALING_ENABLE *EvtAdapterReceiveScalingEnable;
+    EVT_NET_ADAPTER_RECEIVE_SCALING_DISABLE *EvtAdapterReceiveScalingDisable;
+    EVT_NET_ADAPTER_RECEIVE_SCALING_SET_HASH_SECRET_KEY *EvtAdapterReceiveScalingSetHashSecretKey;
+    EVT_NET_ADAPTER_RECEIVE_SCALING_SET_INDIRECTION_ENTRIES *EvtAdapterReceiveScalingSetIndirectionEntries;
+    BOOLEAN SynchronizeSetIndirectionEntries;
+} NET_ADAPTER_RECEIVE_SCALING_CAPABILITIES;
+
+inline void NET_ADAPTER_RECEIVE_SCALING_CAPABILITIES_INIT(
+    NET_ADAPTER_RECEIVE_SCALING_CAPABILITIES *Capabilities,
+    ULONG NumberOfQueues,
+    NET_ADAPTER_RECEIVE_SCALING_UNHASHED_TARGET_TYPE UnhashedTarget,
+    NET_ADAPTER_RECEIVE_SCALING_HASH_TYPE HashTypes,
+    NET_ADAPTER_RECEIVE_SCALING_PROTOCOL_TYPE ProtocolTypes,
+    EVT_NET_ADAPTER_RECEIVE_SCALING_ENABLE *EvtEnable,
+    EVT_NET_ADAPTER_RECEIVE_SCALING_DISABLE *EvtDisable,
+    EVT_NET_ADAPTER_RECEIVE_SCALING_SET_HASH_SECRET_KEY *EvtSetHashSecretKey,
+    EVT_NET_ADAPTER_RECEIVE_SCALING_SET_INDIRECTION_ENTRIES *EvtSetIndirectionEntries)
+{
+    *Capabilities = {};
+    Capabilities->Size = sizeof(NET_ADAPTER_RECEIVE_SCALING_CAPABILITIES);
+    Capabilities->NumberOfQueues = NumberOfQueues;
+    Capabilities->IndirectionTableSize = 128;
+    Capabilities->UnhashedTarget = UnhashedTarget;
+    Capabilities->HashTypes = HashTypes;
+    Capabilities->ProtocolTypes = ProtocolTypes;
+    Capabilities->EvtAdapterReceiveScalingEnable = EvtEnable;
+    Capabilities->EvtAdapterReceiveScalingDisable = EvtDisable;
+    Capabilities->EvtAdapterReceiveScalingSetHashSecretKey = EvtSetHashSecretKey;
+    Capabilities->EvtAdapterReceiveScalingSetIndirectionEntries = EvtSetIndirectionEntries;
+}
+
+void NetAdapterSetReceiveScalingCapabilities(NETADAPTER Adapter, NET_ADAPTER_RECEIVE_SCALING_CAPABILITIES const *Capabilities);
+
+// Wake
+
+typedef struct _NET_ADAPTER_WAKE_MAGIC_PACKET_CAPABILITIES
+{
+    ULONG Size;
+    BOOLEAN MagicPacket;
+} NET_ADAPTER_WAKE_MAGIC_PACKET_CAPABILITIES;
+
+inline void NET_ADAPTER_WAKE_MAGIC_PACKET_CAPABILITIES_INIT(NET_ADAPTER_WAKE_MAGIC_PACKET_CAPABILITIES *Capabilities)
+{
+    *Capabilities = {};
+    Capabilities->Size = sizeof(NET_ADAPTER_WAKE_MAGIC_PACKET_CAPABILITIES);
+}
+
+void NetAdapterWakeSetMagicPacketCapabilities(NETADAPTER Adapter, NET_ADAPTER_WAKE_MAGIC_PACKET_CAPABILITIES const *Capabilities);
+
+typedef enum _NET_WAKE_SOURCE_TYPE
+{
+    NetWakeSourceTypeBitmapPattern = 1,
+    NetWakeSourceTypeMagicPacket,
+    NetWakeSourceTypeMediaChange,
+} NET_WAKE_SOURCE_TYPE;
+
+typedef struct _NET_WAKE_SOURCE_LIST
+{
+    ULONG Size;
+    void *Reserved[2];
+} NET_WAKE_SOURCE_LIST;
+
+inline void NET_WAKE_SOURCE_LIST_INIT(NET_WAKE_SOURCE_LIST *List)
+{
+    *List = {};
+    List->Size = sizeof(NET_WAKE_SOURCE_LIST);
+}
+
+void NetDeviceGetWakeSourceList(WDFDEVICE Device, NET_WAKE_SOURCE_LIST *List);
+SIZE_T NetWakeSourceListGetCount(NET_WAKE_SOURCE_LIST const *List);
+NETWAKESOURCE NetWakeSourceListGetElement(NET_WAKE_SOURCE_LIST const *List, SIZE_T Index);
+NET_WAKE_SOURCE_TYPE NetWakeSourceGetType(NETWAKESOURCE WakeSource);
+
+// Datapath capabilities
+
+typedef struct _NET_ADAPTER_DMA_CAPABILITIES
+{
+    ULONG Size;
+    WDFDMAENABLER DmaEnabler;
+} NET_ADAPTER_DMA_CAPABILITIES;
+
+inline void NET_ADAPTER_DMA_CAPABILITIES_INIT(NET_ADAPTER_DMA_CAPABILITIES *Capabilities, WDFDMAENABLER DmaEnabler)
+{
+    *Capabilities = {};
+    Capabilities->Size = sizeof(NET_ADAPTER_DMA_CAPABILITIES);
+    Capabilities->DmaEnabler = DmaEnabler;
+}
+
+typedef struct _NET_ADAPTER_TX_CAPABILITIES
+{
+    ULONG Size;
+    NET_ADAPTER_DMA_CAPABILITIES const *DmaCapabilities;
+    size_t MaximumNumberOfQueues;
+    size_t FragmentBufferAlignment;
+    size_t MaximumNumberOfFragments;
+    size_t FragmentRingNumberOfElementsHint;
+} NET_ADAPTER_TX_CAPABILITIES;
+
+inline void NET_ADAPTER_TX_CAPABILITIES_INIT_FOR_DMA(
+    NET_ADAPTER_TX_CAPABILITIES *Capabilities,
+    NET_ADAPTER_DMA_CAPABILITIES const *DmaCapabilities,
+    size_t MaximumNumberOfQueues)
+{
+    *Capabilities = {};
+    Capabilities->Size = sizeof(NET_ADAPTER_TX_CAPABILITIES);
+    Capabilities->DmaCapabilities = DmaCapabilities;
+    Capabilities->MaximumNumberOfQueues = MaximumNumberOfQueues;
+    Capabilities->FragmentBufferAlignment = 1;
+}
+
+typedef struct _NET_ADAPTER_RX_CAPABILITIES
+{
+    ULONG Size;
+    NET_ADAPTER_DMA_CAPABILITIES const *DmaCapabilities;
+    size_t MaximumNumberOfQueues;
+    size_t MaximumFrameSize;
+    size_t FragmentBufferAlignment;
+    size_t FragmentRingNumberOfElementsHint;
+} NET_ADAPTER_RX_CAPABILITIES;
+
+inline void NET_ADAPTER_RX_CAPABILITIES_INIT_SYSTEM_MANAGED_DMA(
+    NET_ADAPTER_RX_CAPABILITIES *Capabilities,
+    NET_ADAPTER_DMA_CAPABILITIES const *DmaCapabilities,
+    size_t MaximumFrameSize,
+    size_t MaximumNumberOfQueues)
+{
+    *Capabilities = {};
+    Capabilities->Size = sizeof(NET_ADAPTER_RX_CAPABILITIES);
+    Capabilities->DmaCapabilities = DmaCapabilities;
+    Capabilities->MaximumFrameSize = MaximumFrameSize;
+    Capabilities->MaximumNumberOfQueues = MaximumNumberOfQueues;
+    Capabilities->FragmentBufferAlignment = 1;
+}
+
+void NetAdapterSetDataPathCapabilities(
+    NETADAPTER Adapter,
+    NET_ADAPTER_TX_CAPABILITIES const *TxCapabilities,
+    NET_ADAPTER_RX_CAPABILITIES const *RxCapabilities);
+
+// Offloads
+
+typedef void EVT_NET_ADAPTER_OFFLOAD_SET_CHECKSUM(NETADAPTER Adapter, NETOFFLOAD Offload);
+typedef void EVT_NET_ADAPTER_OFFLOAD_SET_LSO(NETADAPTER Adapter, NETOFFLOAD Offload);
+
+typedef struct _NET_ADAPTER_OFFLOAD_CHECKSUM_CAPABILITIES
+{
+    ULONG Size;
+    BOOLEAN IPv4;
+    BOOLEAN Tcp;
+    BOOLEAN Udp;
+    EVT_NET_ADAPTER_OFFLOAD_SET_CHECKSUM *EvtAdapterOffloadSetChecksum;
+} NET_ADAPTER_OFFLOAD_CHECKSUM_CAPABILITIES;
+
+inline void NET_ADAPTER_OFFLOAD_CHECKSUM_CAPABILITIES_INIT(
+    NET_ADAPTER_OFFLOAD_CHECKSUM_CAPABILITIES *Capabilities,
+    BOOLEAN IPv4,
+    BOOLEAN Tcp,
+    BOOLEAN Udp,
+    EVT_NET_ADAPTER_OFFLOAD_SET_CHECKSUM *EvtSetChecksum)
+{
+    *Capabilities = {};
+    Capabilities->Size = sizeof(NET_ADAPTER_OFFLOAD_CHECKSUM_CAPABILITIES);
+    Capabilities->IPv4 = IPv4;
+    Capabilities->Tcp = Tcp;
+    Capabilities->Udp = Udp;
+    Capabilities->EvtAdapterOffloadSetChecksum = EvtSetChecksum;
+}
+
+typedef struct _NET_ADAPTER_OFFLOAD_LSO_CAPABILITIES
+{
+    ULONG Size;
+    BOOLEAN IPv4;
+    BOOLEAN IPv6;
+    SIZE_T MaximumOffloadSize;
+    SIZE_T MinimumSegmentCount;
+    EVT_NET_ADAPTER_OFFLOAD_SET_LSO *EvtAdapterOffloadSetLso;
+} NET_ADAPTER_OFFLOAD_LSO_CAPABILITIES;
+
+inline void NET_ADAPTER_OFFLOAD_LSO_CAPABILITIES_INIT(
+    NET_ADAPTER_OFFLOAD_LSO_CAPABILITIES *Capabilities,
+    BOOLEAN IPv4,
+    BOOLEAN IPv6,
+    SIZE_T MaximumOffloadSize,
+    SIZE_T MinimumSegmentCount,
+    EVT_NET_ADAPTER_OFFLOAD_SET_LSO *EvtSetLso)
+{
+    *Capabilities = {};
+    Capabilities->Size = sizeof(NET_ADAPTER_OFFLOAD_LSO_CAPABILITIES);
+    Capabilities->IPv4 = IPv4;
+    Capabilities->IPv6 = IPv6;
+    Capabilities->MaximumOffloadSize = MaximumOffloadSize;
+    Capabilities->MinimumSegmentCount = MinimumSegmentCount;
+    Capabilities->EvtAdapterOffloadSetLso = EvtSetLso;
+}
+
+typedef enum _NET_ADAPTER_OFFLOAD_IEEE8021Q_TAG_FLAGS
+{
+    NetAdapterOffloadIeee8021NoTaggingFlag = 0x0,
+    NetAdapterOffloadIeee8021PriorityTaggingFlag = 0x1,
+    NetAdapterOffloadIeee8021VlanTaggingFlag = 0x2,
+} NET_ADAPTER_OFFLOAD_IEEE8021Q_TAG_FLAGS;
+
+typedef struct _NET_ADAPTER_OFFLOAD_IEEE8021Q_TAG_CAPABILITIES
+{
+    ULONG Size;
+    NET_ADAPTER_OFFLOAD_IEEE8021Q_TAG_FLAGS Flags;
+} NET_ADAPTER_OFFLOAD_IEEE8021Q_TAG_CAPABILITIES;
+
+inline void NET_ADAPTER_OFFLOAD_IEEE8021Q_TAG_CAPABILITIES_INIT(
+    NET_ADAPTER_OFFLOAD_IEEE8021Q_TAG_CAPABILITIES *Capabilities,
+    NET_ADAPTER_OFFLOAD_IEEE8021Q_TAG_FLAGS Flags)
+{
+    *Capabilities = {};
+    Capabilities->Size = sizeof(NET_ADAPTER_OFFLOAD_IEEE8021Q_TAG_CAPABILITIES);
+    Capabilities->Flags = Flags;
+}
+
+void NetAdapterOffloadSetChecksumCapabilities(NETADAPTER Adapter, NET_ADAPTER_OFFLOAD_CHECKSUM_CAPABILITIES const *Capabilities);
+void NetAdapterOffloadSetLsoCapabilities(NETADAPTER Adapter, NET_ADAPTER_OFFLOAD_LSO_CAPABILITIES const *Capabilities);
+void NetAdapterOffloadSetIeee8021qTagCapabilities(NETADAPTER Adapter, NET_ADAPTER_OFFLOAD_IEEE8021Q_TAG_CAPABILITIES const *Capabilities);
+
+BOOLEAN NetOffloadIsChecksumIPv4Enabled(NETOFFLOAD Offload);
+BOOLEAN NetOffloadIsChecksumTcpEnabled(NETOFFLOAD Offload);
+BOOLEAN NetOffloadIsChecksumUdpEnabled(NETOFFLOAD Offload);
+BOOLEAN NetOffloadIsLsoIPv4Enabled(NETOFFLOAD Offload);
+BOOLEAN NetOffloadIsLsoIPv6Enabled(NETOFFLOAD Offload);
+
+// Configuration
+
+#define NET_CONFIGURATION_QUERY_ULONG_NO_FLAGS 0
+
+NTSTATUS NetAdapterOpenConfiguration(NETADAPTER Adapter, WDF_OBJECT_ATTRIBUTES *ConfigurationAttributes, NETCONFIGURATION *Configuration);
+void NetConfigurationClose(NETCONFIGURATION Configuration);
+NTSTATUS NetConfigurationQueryUlong(NETCONFIGURATION Configuration, ULONG Flags, PUNICODE_STRING ValueName, ULONG *Value);
+NTSTATUS NetConfigurationQueryLinkLayerAddress(NETCONFIGURATION Configuration, NET_ADAPTER_LINK_LAYER_ADDRESS *LinkLayerAddress);
+
+// Packet queues
+
+typedef void EVT_PACKET_QUEUE_START(NETPACKETQUEUE PacketQueue);
+typedef void EVT_PACKET_QUEUE_STOP(NETPACKETQUEUE PacketQueue);
+typedef void EVT_PACKET_QUEUE_ADVANCE(NETPACKETQUEUE PacketQueue);
+typedef void EVT_PACKET_QUEUE_SET_NOTIFICATION_ENABLED(NETPACKETQUEUE PacketQueue, BOOLEAN NotificationEnabled);
+typedef void EVT_PACKET_QUEUE_CANCEL(NETPACKETQUEUE PacketQueue);
+
+typedef struct _NET_PACKET_QUEUE_CONFIG
+{
+    ULONG Size;
+    EVT_PACKET_QUEUE_START *EvtStart;
+    EVT_PACKET_QUEUE_STOP *EvtStop;
+    EVT_PACKET_QUEUE_ADVANCE *EvtAdvance;
+    EVT_PACKET_QUEUE_SET_NOTIFICATION_ENABLED *EvtSetNotificationEnabled;
+    EVT_PACKET_QUEUE_CANCEL *EvtCancel;
+} NET_PACKET_QUEUE_CONFIG;
+
+inline void NET_PACKET_QUEUE_CONFIG_INIT(
+    NET_PACKET_QUEUE_CONFIG *Configuration,
+    EVT_PACKET_QUEUE_ADVANCE *EvtAdvance,
+    EVT_PACKET_QUEUE_SET_NOTIFICATION_ENABLED *EvtSetNotificationEnabled,
+    EVT_PACKET_QUEUE_CANCEL *EvtCancel)
+{
+    *Configuration = {};
+    Configuration->Size = sizeof(NET_PACKET_QUEUE_CONFIG);
+    Configuration->EvtAdvance = EvtAdvance;
+    Configuration->EvtSetNotificationEnabled = EvtSetNotificationEnabled;
+    Configuration->EvtCancel = EvtCancel;
+}
+
+NTSTATUS NetTxQueueCreate(
+    NETTXQUEUE_INIT *NetTxQueueInit,
+    WDF_OBJECT_ATTRIBUTES *TxQueueAttributes,
+    NET_PACKET_QUEUE_CONFIG *Configuration,
+    NETPACKETQUEUE *TxQueue);
+NTSTATUS NetRxQueueCreate(
+    NETRXQUEUE_INIT *NetRxQueueInit,
+    WDF_OBJECT_ATTRIBUTES *RxQueueAttributes,
+    NET_PACKET_QUEUE_CONFIG *Configuration,
+    NETPACKETQUEUE *RxQueue);
+
+ULONG NetRxQueueInitGetQueueId(NETRXQUEUE_INIT *NetRxQueueInit);
+
+NET_RING_COLLECTION const *NetTxQueueGetRingCollection(NETPACKETQUEUE NetTxQueue);
+NET_RING_COLLECTION const *NetRxQueueGetRingCollection(NETPACKETQUEUE NetRxQueue);
+
+void NetTxQueueGetExtension(NETPACKETQUEUE NetTxQueue, NET_EXTENSION_QUERY const *Query, NET_EXTENSION *Extension);
+void NetRxQueueGetExtension(NETPACKETQUEUE NetRxQueue, NET_EXTENSION_QUERY const *Query, NET_EXTENSION *Extension);
+
+void NetTxQueueNotifyMoreCompletedPacketsAvailable(NETPACKETQUEUE TxQueue);
+void NetRxQueueNotifyMoreReceivedPacketsAvailable(NETPACKETQUEUE RxQueue);
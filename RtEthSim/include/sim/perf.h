@@ -0,0 +1,40 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#pragma once
+
+#include "precomp.h"
+
+namespace sim
+{
+
+// Hardware cache misses of the calling thread in user mode, from a
+// perf_event counter. Kernels that do not allow it, or processors that do
+// not have it, leave the counter unavailable and Read returns 0.
+class CacheMissCounter
+{
+public:
+    CacheMissCounter();
+    ~CacheMissCounter();
+
+    CacheMissCounter(CacheMissCounter const &) = delete;
+    CacheMissCounter &operator=(CacheMissCounter const &) = delete;
+
+    bool Available() const { return m_fd >= 0; }
+
+    // Misses since the counter was opened
+    ULONG64 Read() const;
+
+private:
+    int m_fd = -1;
+};
+
+}
@@ -0,0 +1,155 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "precomp.h"
+
+#include "sim/mmio.h"
+
+namespace sim
+{
+
+// A frame as the MAC takes it off the wire, without the CRC, which the
+// model appends. Status carries the layer 3 and 4 bits of the receive
+// status word; RXS_BAR and RXS_MAR are added from the destination address.
+struct RxFrame
+{
+    std::vector<UCHAR> Data;
+    UINT16 Status = 0;
+    UINT16 IpRssTava = 0;
+    UINT16 VlanTag = 0;
+    UINT8 TcpUdpFailure = 0;
+};
+
+// A frame as the MAC put it on the wire, gathered from its descriptors
+struct TxFrame
+{
+    std::vector<UCHAR> Data;
+    UINT16 DescriptorCount;
+    // OffloadGsoMssTagc and VLAN_TAG of the first descriptor
+    UINT16 Offload;
+    UINT16 VlanTag;
+};
+
+struct InterruptRecord
+{
+    ULONG64 Time;
+    ULONG Message;
+    // Time since the oldest event the interrupt reports was latched
+    ULONG64 Latency;
+};
+
+// Behavioral model of the RTL8168E MAC, as far as RtEthSample programs it.
+//
+// The model runs when Service is called: from the host loop, and from
+// KeStallExecutionProcessor, where the driver waits on the hardware.
+// Register commands (reset, PHY and ERI access, tally dump, transmit poll)
+// are taken from what the driver last left in the registers, then frames
+// move between the wire and the descriptor rings, and finally interrupt
+// messages are raised on a rising edge of ISR & IMR.
+//
+// Receive and transmit-OK status wait out the moderation timers before
+// they can raise an interrupt, one timer unit being 10us as the driver
+// assumes. Status in ISR N is raised as message N modulo the number of
+// messages granted.
+class Rtl8168
+{
+public:
+    // Frames the receive FIFO of each queue holds while the queue has no
+    // descriptors; more are missed
+    static constexpr size_t RxFifoFrames = 512;
+
+    Rtl8168(Mmio &mmio, UCHAR const *macAddress, ULONG messageCount);
+
+    RT_MAC *Registers() const { return m_mac; }
+
+    void Service();
+
+    // Earliest time at which Service would raise an interrupt without
+    // anything else changing, or ~0 if none
+    ULONG64 NextEventTime() const;
+
+    // Messages raised since the last call, bit N for message N
+    ULONG TakeRaisedMessages();
+
+    // Drops status the driver acknowledged, for a register window that does
+    // not trap writes and so cannot clear it by itself
+    void ClearInterruptStatus(ULONG queueId);
+
+    void Receive(ULONG queueId, RxFrame frame);
+    void SetLink(bool up);
+
+    UINT16 Phy(UCHAR reg) const { return m_phy[reg & 0x1f]; }
+    UINT32 Eri(UINT16 address) const { return m_eri[(address & 0xfff) / 4]; }
+
+    bool CaptureTransmitted = true;
+    std::vector<TxFrame> Transmitted;
+    ULONG64 TransmittedFrames = 0;
+    ULONG64 TransmittedBytes = 0;
+    ULONG64 TransmitPolls = 0;
+
+    ULONG64 ReceivedFrames = 0;
+    ULONG64 MissedFrames = 0;
+
+    // Evict the receive descriptors and buffers the model writes from the
+    // processor caches, as a DMA write would, so the driver finds them cold
+    bool EvictReceivedLines = false;
+
+    bool RecordInterrupts = true;
+    std::vector<InterruptRecord> Interrupts;
+
+private:
+    void Reset();
+    void ServiceCommands();
+    void ServicePhy();
+    void ServiceEri();
+    void DumpTally();
+    void Transmit();
+    void ReceiveQueue(ULONG queueId);
+    bool DeliverFrame(ULONG queueId, RT_RX_DESC *ring, RxFrame const &frame);
+    void RaiseStatus(ULONG queueId, UINT16 bits);
+    UINT16 InterruptStatus(ULONG queueId) const;
+    void SetInterruptStatus(ULONG queueId, UINT16 value);
+    UINT16 InterruptMask(ULONG queueId) const;
+    UINT16 ModeratedStatus(ULONG queueId) const;
+    ULONG64 ModerationDelay(UINT16 bit, ULONG queueId) const;
+    void UpdateInterrupts();
+
+    RT_MAC *m_mac;
+    UCHAR m_permanentAddress[ETH_LENGTH_OF_ADDRESS];
+    ULONG m_messageCount;
+
+    UCHAR m_cmdSeen = 0;
+    UINT32 m_phyLeft;
+    UINT64 m_txRingSeen = 0;
+    UINT64 m_rxRingSeen = 0;
+
+    UINT16 m_phy[32] = {};
+    UINT32 m_eri[0x1000 / 4] = {};
+    RT_TALLY m_tally = {};
+
+    UINT32 m_txIndex = 0;
+    UINT32 m_rxIndex[RT_NUMBER_OF_QUEUES] = {};
+    std::deque<RxFrame> m_rxFifo[RT_NUMBER_OF_QUEUES];
+
+    // When each latched status bit was raised
+    ULONG64 m_statusTime[RT_NUMBER_OF_QUEUES][16] = {};
+    UINT16 m_statusTimed[RT_NUMBER_OF_QUEUES] = {};
+
+    bool m_messageLevel[RT_NUMBER_OF_QUEUES] = {};
+    ULONG m_raised = 0;
+};
+
+}
@@ -0,0 +1,40 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#pragma once
+
+// Host stand-in for evntrace.h and TraceLoggingProvider.h. Events are
+// compiled out, the arguments are never evaluated.
+
+#include "sim/kernel.h"
+
+#define TRACE_LEVEL_NONE 0
+#define TRACE_LEVEL_CRITICAL 1
+#define TRACE_LEVEL_ERROR 2
+#define TRACE_LEVEL_WARNING 3
+#define TRACE_LEVEL_INFORMATION 4
+#define TRACE_LEVEL_VERBOSE 5
+
+typedef struct _TRACELOGGING_PROVIDER
+{
+    int Unused;
+} const *TraceLoggingHProvider;
+
+#define TRACELOGGING_DECLARE_PROVIDER(hProvider) \
+    extern TraceLoggingHProvider const hProvider
+
+#define TRACELOGGING_DEFINE_PROVIDER(hProvider, providerName, providerId, ...) \
+    TraceLoggingHProvider const hProvider = nullptr
+
+#define TraceLoggingRegister(hProvider) ((void)(hProvider), STATUS_SUCCESS)
+#define TraceLoggingUnregister(hProvider) ((void)(hProvider))
+
+#define TraceLoggingWrite(...) ((void)0)
@@ -0,0 +1,447 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#pragma once
+
+// Host stand-in for the KMDF surface RtEthSample uses. Handles are opaque
+// pointers to harness objects (src/wdf.cpp) that carry typed contexts, a
+// parent and destroy callbacks the same way the framework does.
+
+#include "sim/kernel.h"
+
+#define DECLARE_WDF_HANDLE(name) \
+    struct name##__ { int unused; }; \
+    typedef struct name##__ *name
+
+typedef void *WDFOBJECT;
+
+DECLARE_WDF_HANDLE(WDFDRIVER);
+DECLARE_WDF_HANDLE(WDFDEVICE);
+DECLARE_WDF_HANDLE(WDFINTERRUPT);
+DECLARE_WDF_HANDLE(WDFSPINLOCK);
+DECLARE_WDF_HANDLE(WDFWAITLOCK);
+DECLARE_WDF_HANDLE(WDFTIMER);
+DECLARE_WDF_HANDLE(WDFWORKITEM);
+DECLARE_WDF_HANDLE(WDFMEMORY);
+DECLARE_WDF_HANDLE(WDFDMAENABLER);
+DECLARE_WDF_HANDLE(WDFCOMMONBUFFER);
+DECLARE_WDF_HANDLE(WDFCMRESLIST);
+
+typedef struct WDFDEVICE_INIT WDFDEVICE_INIT, *PWDFDEVICE_INIT;
+
+#define WDF_NO_HANDLE nullptr
+#define WDF_NO_OBJECT_ATTRIBUTES nullptr
+
+// Object attributes and typed contexts
+
+typedef void EVT_WDF_OBJECT_CONTEXT_CLEANUP(WDFOBJECT Object);
+typedef EVT_WDF_OBJECT_CONTEXT_CLEANUP *PFN_WDF_OBJECT_CONTEXT_CLEANUP;
+typedef void EVT_WDF_OBJECT_CONTEXT_DESTROY(WDFOBJECT Object);
+typedef EVT_WDF_OBJECT_CONTEXT_DESTROY *PFN_WDF_OBJECT_CONTEXT_DESTROY;
+typedef EVT_WDF_OBJECT_CONTEXT_DESTROY EVT_WDF_DEVICE_CONTEXT_DESTROY;
+
+typedef struct _WDF_OBJECT_CONTEXT_TYPE_INFO
+{
+    ULONG Size;
+    PCSTR ContextName;
+    size_t ContextSize;
+} WDF_OBJECT_CONTEXT_TYPE_INFO;
+
+typedef struct _WDF_OBJECT_ATTRIBUTES
+{
+    ULONG Size;
+    PFN_WDF_OBJECT_CONTEXT_CLEANUP EvtCleanupCallback;
+    PFN_WDF_OBJECT_CONTEXT_DESTROY EvtDestroyCallback;
+    WDFOBJECT ParentObject;
+    size_t ContextSizeOverride;
+    WDF_OBJECT_CONTEXT_TYPE_INFO const *ContextTypeInfo;
+} WDF_OBJECT_ATTRIBUTES, *PWDF_OBJECT_ATTRIBUTES;
+
+inline void WDF_OBJECT_ATTRIBUTES_INIT(WDF_OBJECT_ATTRIBUTES *Attributes)
+{
+    *Attributes = {};
+    Attributes->Size = sizeof(WDF_OBJECT_ATTRIBUTES);
+}
+
+namespace sim
+{
+// One type info per context type, shared by every translation unit
+template <typename Context>
+struct ContextTypeInfo
+{
+    static WDF_OBJECT_CONTEXT_TYPE_INFO const Value;
+};
+
+template <typename Context>
+WDF_OBJECT_CONTEXT_TYPE_INFO const ContextTypeInfo<Context>::Value =
+    { sizeof(WDF_OBJECT_CONTEXT_TYPE_INFO), "", sizeof(Context) };
+}
+
+#define WDF_GET_CONTEXT_TYPE_INFO(_contexttype) (&sim::ContextTypeInfo<_contexttype>::Value)
+
+#define WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(_attributes, _contexttype) \
+    (WDF_OBJECT_ATTRIBUTES_INIT(_attributes), \
+     (_attributes)->ContextTypeInfo = WDF_GET_CONTEXT_TYPE_INFO(_contexttype))
+
+void *WdfObjectGetTypedContextWorker(WDFOBJECT Handle, WDF_OBJECT_CONTEXT_TYPE_INFO const *TypeInfo);
+
+#define WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(_contexttype, _castingfunction) \
+    inline _contexttype *_castingfunction(WDFOBJECT Handle) \
+    { \
+        return static_cast<_contexttype *>( \
+            WdfObjectGetTypedContextWorker(Handle, WDF_GET_CONTEXT_TYPE_INFO(_contexttype))); \
+    }
+
+void WdfObjectDelete(WDFOBJECT Object);
+
+// Driver
+
+typedef NTSTATUS EVT_WDF_DRIVER_DEVICE_ADD(WDFDRIVER Driver, PWDFDEVICE_INIT DeviceInit);
+typedef EVT_WDF_DRIVER_DEVICE_ADD *PFN_WDF_DRIVER_DEVICE_ADD;
+typedef void EVT_WDF_DRIVER_UNLOAD(WDFDRIVER Driver);
+typedef EVT_WDF_DRIVER_UNLOAD *PFN_WDF_DRIVER_UNLOAD;
+
+typedef struct _WDF_DRIVER_CONFIG
+{
+    ULONG Size;
+    PFN_WDF_DRIVER_DEVICE_ADD EvtDriverDeviceAdd;
+    PFN_WDF_DRIVER_UNLOAD EvtDriverUnload;
+    ULONG DriverInitFlags;
+    ULONG DriverPoolTag;
+} WDF_DRIVER_CONFIG;
+
+inline void WDF_DRIVER_CONFIG_INIT(WDF_DRIVER_CONFIG *Config, PFN_WDF_DRIVER_DEVICE_ADD EvtDriverDeviceAdd)
+{
+    *Config = {};
+    Config->Size = sizeof(WDF_DRIVER_CONFIG);
+    Config->EvtDriverDeviceAdd = EvtDriverDeviceAdd;
+}
+
+NTSTATUS WdfDriverCreate(
+    PDRIVER_OBJECT DriverObject,
+    PUNICODE_STRING RegistryPath,
+    WDF_OBJECT_ATTRIBUTES *DriverAttributes,
+    WDF_DRIVER_CONFIG *DriverConfig,
+    WDFDRIVER *Driver);
+
+// Device and PnP/power callbacks
+
+typedef enum _WDF_POWER_DEVICE_STATE
+{
+    WdfPowerDeviceInvalid = 0,
+    WdfPowerDeviceD0,
+    WdfPowerDeviceD1,
+    WdfPowerDeviceD2,
+    WdfPowerDeviceD3,
+    WdfPowerDeviceD3Final,
+    WdfPowerDevicePrepareForHibernation,
+    WdfPowerDeviceMaximum,
+} WDF_POWER_DEVICE_STATE;
+
+typedef NTSTATUS EVT_WDF_DEVICE_PREPARE_HARDWARE(WDFDEVICE Device, WDFCMRESLIST ResourcesRaw, WDFCMRESLIST ResourcesTranslated);
+typedef NTSTATUS EVT_WDF_DEVICE_RELEASE_HARDWARE(WDFDEVICE Device, WDFCMRESLIST ResourcesTranslated);
+typedef NTSTATUS EVT_WDF_DEVICE_D0_ENTRY(WDFDEVICE Device, WDF_POWER_DEVICE_STATE PreviousState);
+typedef NTSTATUS EVT_WDF_DEVICE_D0_EXIT(WDFDEVICE Device, WDF_POWER_DEVICE_STATE TargetState);
+typedef NTSTATUS EVT_WDF_DEVICE_ARM_WAKE_FROM_SX(WDFDEVICE Device);
+typedef void EVT_WDF_DEVICE_DISARM_WAKE_FROM_SX(WDFDEVICE Device);
+
+typedef struct _WDF_PNPPOWER_EVENT_CALLBACKS
+{
+    ULONG Size;
+    EVT_WDF_DEVICE_D0_ENTRY *EvtDeviceD0Entry;
+    EVT_WDF_DEVICE_D0_EXIT *EvtDeviceD0Exit;
+    EVT_WDF_DEVICE_PREPARE_HARDWARE *EvtDevicePrepareHardware;
+    EVT_WDF_DEVICE_RELEASE_HARDWARE *EvtDeviceReleaseHardware;
+} WDF_PNPPOWER_EVENT_CALLBACKS;
+
+inline void WDF_PNPPOWER_EVENT_CALLBACKS_INIT(WDF_PNPPOWER_EVENT_CALLBACKS *Callbacks)
+{
+    *Callbacks = {};
+    Callbacks->Size = sizeof(WDF_PNPPOWER_EVENT_CALLBACKS);
+}
+
+typedef struct _WDF_POWER_POLICY_EVENT_CALLBACKS
+{
+    ULONG Size;
+    EVT_WDF_DEVICE_ARM_WAKE_FROM_SX *EvtDeviceArmWakeFromSx;
+    EVT_WDF_DEVICE_DISARM_WAKE_FROM_SX *EvtDeviceDisarmWakeFromSx;
+} WDF_POWER_POLICY_EVENT_CALLBACKS;
+
+inline void WDF_POWER_POLICY_EVENT_CALLBACKS_INIT(WDF_POWER_POLICY_EVENT_CALLBACKS *Callbacks)
+{
+    *Callbacks = {};
+    Callbacks->Size = sizeof(WDF_POWER_POLICY_EVENT_CALLBACKS);
+}
+
+void WdfDeviceInitSetPnpPowerEventCallbacks(PWDFDEVICE_INIT DeviceInit, WDF_PNPPOWER_EVENT_CALLBACKS *Callbacks);
+void WdfDeviceInitSetPowerPolicyEventCallbacks(PWDFDEVICE_INIT DeviceInit, WDF_POWER_POLICY_EVENT_CALLBACKS *Callbacks);
+
+NTSTATUS WdfDeviceCreate(PWDFDEVICE_INIT *DeviceInit, WDF_OBJECT_ATTRIBUTES *DeviceAttributes, WDFDEVICE *Device);
+
+#define FILE_64_BYTE_ALIGNMENT 0x0000003f
+#define FILE_256_BYTE_ALIGNMENT 0x000000ff
+
+void WdfDeviceSetAlignmentRequirement(WDFDEVICE Device, ULONG AlignmentRequirement);
+
+typedef enum _WDF_DEVICE_FAILED_ACTION
+{
+    WdfDeviceFailedUndefined = 0,
+    WdfDeviceFailedAttemptRestart,
+    WdfDeviceFailedNoRestart,
+} WDF_DEVICE_FAILED_ACTION;
+
+void WdfDeviceSetFailed(WDFDEVICE Device, WDF_DEVICE_FAILED_ACTION FailedAction);
+
+typedef enum _WDF_POWER_POLICY_S0_IDLE_CAPABILITIES
+{
+    IdleCapsInvalid = 0,
+    IdleCannotWakeFromS0,
+    IdleCanWakeFromS0,
+    IdleUsbSelectiveSuspend,
+} WDF_POWER_POLICY_S0_IDLE_CAPABILITIES;
+
+typedef enum _WDF_POWER_POLICY_S0_IDLE_USER_CONTROL
+{
+    IdleUserControlInvalid = 0,
+    IdleDoNotAllowUserControl,
+    IdleAllowUserControl,
+} WDF_POWER_POLICY_S0_IDLE_USER_CONTROL;
+
+typedef struct _WDF_DEVICE_POWER_POLICY_IDLE_SETTINGS
+{
+    ULONG Size;
+    WDF_POWER_POLICY_S0_IDLE_CAPABILITIES IdleCaps;
+    WDF_POWER_POLICY_S0_IDLE_USER_CONTROL UserControlOfIdleSettings;
+} WDF_DEVICE_POWER_POLICY_IDLE_SETTINGS;
+
+inline void WDF_DEVICE_POWER_POLICY_IDLE_SETTINGS_INIT(
+    WDF_DEVICE_POWER_POLICY_IDLE_SETTINGS *Settings,
+    WDF_POWER_POLICY_S0_IDLE_CAPABILITIES IdleCaps)
+{
+    *Settings = {};
+    Settings->Size = sizeof(WDF_DEVICE_POWER_POLICY_IDLE_SETTINGS);
+    Settings->IdleCaps = IdleCaps;
+}
+
+typedef enum _WDF_POWER_POLICY_SX_WAKE_USER_CONTROL
+{
+    WakeUserControlInvalid = 0,
+    WakeDoNotAllowUserControl,
+    WakeAllowUserControl,
+} WDF_POWER_POLICY_SX_WAKE_USER_CONTROL;
+
+typedef struct _WDF_DEVICE_POWER_POLICY_WAKE_SETTINGS
+{
+    ULONG Size;
+    WDF_POWER_POLICY_SX_WAKE_USER_CONTROL UserControlOfWakeSettings;
+} WDF_DEVICE_POWER_POLICY_WAKE_SETTINGS;
+
+inline void WDF_DEVICE_POWER_POLICY_WAKE_SETTINGS_INIT(WDF_DEVICE_POWER_POLICY_WAKE_SETTINGS *Settings)
+{
+    *Settings = {};
+    Settings->Size = sizeof(WDF_DEVICE_POWER_POLICY_WAKE_SETTINGS);
+}
+
+NTSTATUS WdfDeviceAssignS0IdleSettings(WDFDEVICE Device, WDF_DEVICE_POWER_POLICY_IDLE_SETTINGS *Settings);
+NTSTATUS WdfDeviceAssignSxWakeSettings(WDFDEVICE Device, WDF_DEVICE_POWER_POLICY_WAKE_SETTINGS *Settings);
+
+// Resources
+
+ULONG WdfCmResourceListGetCount(WDFCMRESLIST List);
+PCM_PARTIAL_RESOURCE_DESCRIPTOR WdfCmResourceListGetDescriptor(WDFCMRESLIST List, ULONG Index);
+
+// Interrupts
+
+typedef BOOLEAN EVT_WDF_INTERRUPT_ISR(WDFINTERRUPT Interrupt, ULONG MessageID);
+typedef EVT_WDF_INTERRUPT_ISR *PFN_WDF_INTERRUPT_ISR;
+typedef void EVT_WDF_INTERRUPT_DPC(WDFINTERRUPT Interrupt, WDFOBJECT AssociatedObject);
+typedef EVT_WDF_INTERRUPT_DPC *PFN_WDF_INTERRUPT_DPC;
+typedef NTSTATUS EVT_WDF_INTERRUPT_ENABLE(WDFINTERRUPT Interrupt, WDFDEVICE AssociatedDevice);
+typedef EVT_WDF_INTERRUPT_ENABLE *PFN_WDF_INTERRUPT_ENABLE;
+typedef NTSTATUS EVT_WDF_INTERRUPT_DISABLE(WDFINTERRUPT Interrupt, WDFDEVICE AssociatedDevice);
+typedef EVT_WDF_INTERRUPT_DISABLE *PFN_WDF_INTERRUPT_DISABLE;
+
+typedef struct _WDF_INTERRUPT_CONFIG
+{
+    ULONG Size;
+    WDFSPINLOCK SpinLock;
+    BOOLEAN ShareVector;
+    BOOLEAN FloatingSave;
+    BOOLEAN AutomaticSerialization;
+    PFN_WDF_INTERRUPT_ISR EvtInterruptIsr;
+    PFN_WDF_INTERRUPT_DPC EvtInterruptDpc;
+    PFN_WDF_INTERRUPT_ENABLE EvtInterruptEnable;
+    PFN_WDF_INTERRUPT_DISABLE EvtInterruptDisable;
+    PCM_PARTIAL_RESOURCE_DESCRIPTOR InterruptRaw;
+    PCM_PARTIAL_RESOURCE_DESCRIPTOR InterruptTranslated;
+    KIRQL SynchronizeIrql;
+} WDF_INTERRUPT_CONFIG;
+
+inline void WDF_INTERRUPT_CONFIG_INIT(
+    WDF_INTERRUPT_CONFIG *Configuration,
+    PFN_WDF_INTERRUPT_ISR EvtInterruptIsr,
+    PFN_WDF_INTERRUPT_DPC EvtInterruptDpc)
+{
+    *Configuration = {};
+    Configuration->Size = sizeof(WDF_INTERRUPT_CONFIG);
+    Configuration->EvtInterruptIsr = EvtInterruptIsr;
+    Configuration->EvtInterruptDpc = EvtInterruptDpc;
+}
+
+NTSTATUS WdfInterruptCreate(
+    WDFDEVICE Device,
+    WDF_INTERRUPT_CONFIG *Configuration,
+    WDF_OBJECT_ATTRIBUTES *Attributes,
+    WDFINTERRUPT *Interrupt);
+BOOLEAN WdfInterruptQueueDpcForIsr(WDFINTERRUPT Interrupt);
+void WdfInterruptAcquireLock(WDFINTERRUPT Interrupt);
+void WdfInterruptReleaseLock(WDFINTERRUPT Interrupt);
+
+// Locks
+
+NTSTATUS WdfSpinLockCreate(WDF_OBJECT_ATTRIBUTES *SpinLockAttributes, WDFSPINLOCK *SpinLock);
+void WdfSpinLockAcquire(WDFSPINLOCK SpinLock);
+void WdfSpinLockRelease(WDFSPINLOCK SpinLock);
+
+NTSTATUS WdfWaitLockCreate(WDF_OBJECT_ATTRIBUTES *LockAttributes, WDFWAITLOCK *Lock);
+NTSTATUS WdfWaitLockAcquire(WDFWAITLOCK Lock, LONGLONG *Timeout);
+void WdfWaitLockRelease(WDFWAITLOCK Lock);
+
+// Timers
+
+typedef void EVT_WDF_TIMER(WDFTIMER Timer);
+typedef EVT_WDF_TIMER *PFN_WDF_TIMER;
+
+typedef struct _WDF_TIMER_CONFIG
+{
+    ULONG Size;
+    PFN_WDF_TIMER EvtTimerFunc;
+    ULONG Period;
+    BOOLEAN AutomaticSerialization;
+    ULONG TolerableDelay;
+} WDF_TIMER_CONFIG;
+
+inline void WDF_TIMER_CONFIG_INIT_PERIODIC(WDF_TIMER_CONFIG *Config, PFN_WDF_TIMER EvtTimerFunc, LONG Period)
+{
+    *Config = {};
+    Config->Size = sizeof(WDF_TIMER_CONFIG);
+    Config->EvtTimerFunc = EvtTimerFunc;
+    Config->Period = Period;
+    Config->AutomaticSerialization = TRUE;
+}
+
+#define WDF_REL_TIMEOUT_IN_MS(Time) (-((LONGLONG)(Time) * 10 * 1000))
+
+NTSTATUS WdfTimerCreate(WDF_TIMER_CONFIG *Config, WDF_OBJECT_ATTRIBUTES *Attributes, WDFTIMER *Timer);
+BOOLEAN WdfTimerStart(WDFTIMER Timer, LONGLONG DueTime);
+BOOLEAN WdfTimerStop(WDFTIMER Timer, BOOLEAN Wait);
+WDFOBJECT WdfTimerGetParentObject(WDFTIMER Timer);
+
+// Work items
+
+typedef void EVT_WDF_WORKITEM(WDFWORKITEM WorkItem);
+typedef EVT_WDF_WORKITEM *PFN_WDF_WORKITEM;
+
+typedef struct _WDF_WORKITEM_CONFIG
+{
+    ULONG Size;
+    PFN_WDF_WORKITEM EvtWorkItemFunc;
+    BOOLEAN AutomaticSerialization;
+} WDF_WORKITEM_CONFIG;
+
+inline void WDF_WORKITEM_CONFIG_INIT(WDF_WORKITEM_CONFIG *Config, PFN_WDF_WORKITEM EvtWorkItemFunc)
+{
+    *Config = {};
+    Config->Size = sizeof(WDF_WORKITEM_CONFIG);
+    Config->EvtWorkItemFunc = EvtWorkItemFunc;
+    Config->AutomaticSerialization = TRUE;
+}
+
+NTSTATUS WdfWorkItemCreate(WDF_WORKITEM_CONFIG *Config, WDF_OBJECT_ATTRIBUTES *Attributes, WDFWORKITEM *WorkItem);
+void WdfWorkItemEnqueue(WDFWORKITEM WorkItem);
+void WdfWorkItemFlush(WDFWORKITEM WorkItem);
+WDFOBJECT WdfWorkItemGetParentObject(WDFWORKITEM WorkItem);
+
+// Memory
+
+NTSTATUS WdfMemoryCreate(
+    WDF_OBJECT_ATTRIBUTES *Attributes,
+    POOL_TYPE PoolType,
+    ULONG PoolTag,
+    size_t BufferSize,
+    WDFMEMORY *Memory,
+    PVOID *Buffer);
+
+// DMA. Logical addresses are the host virtual addresses, so the device
+// model can follow descriptor and buffer addresses directly.
+
+typedef enum _WDF_DMA_PROFILE
+{
+    WdfDmaProfileInvalid = 0,
+    WdfDmaProfilePacket,
+    WdfDmaProfileScatterGather,
+    WdfDmaProfilePacket64,
+    WdfDmaProfileScatterGather64,
+    WdfDmaProfileScatterGatherDuplex,
+    WdfDmaProfileScatterGather64Duplex,
+} WDF_DMA_PROFILE;
+
+#define WDF_DMA_ENABLER_CONFIG_REQUIRE_SINGLE_TRANSFER 0x00000001
+
+typedef struct _WDF_DMA_ENABLER_CONFIG
+{
+    ULONG Size;
+    WDF_DMA_PROFILE Profile;
+    size_t MaximumLength;
+    ULONG Flags;
+    ULONG WdmDmaVersionOverride;
+} WDF_DMA_ENABLER_CONFIG;
+
+inline void WDF_DMA_ENABLER_CONFIG_INIT(WDF_DMA_ENABLER_CONFIG *Config, WDF_DMA_PROFILE Profile, size_t MaximumLength)
+{
+    *Config = {};
+    Config->Size = sizeof(WDF_DMA_ENABLER_CONFIG);
+    Config->Profile = Profile;
+    Config->MaximumLength = MaximumLength;
+}
+
+NTSTATUS WdfDmaEnablerCreate(
+    WDFDEVICE Device,
+    WDF_DMA_ENABLER_CONFIG *Config,
+    WDF_OBJECT_ATTRIBUTES *Attributes,
+    WDFDMAENABLER *DmaEnablerHandle);
+
+typedef struct _WDF_COMMON_BUFFER_CONFIG
+{
+    ULONG Size;
+    ULONG AlignmentRequirement;
+} WDF_COMMON_BUFFER_CONFIG;
+
+inline void WDF_COMMON_BUFFER_CONFIG_INIT(WDF_COMMON_BUFFER_CONFIG *Config, ULONG AlignmentRequirement)
+{
+    *Config = {};
+    Config->Size = sizeof(WDF_COMMON_BUFFER_CONFIG);
+    Config->AlignmentRequirement = AlignmentRequirement;
+}
+
+NTSTATUS WdfCommonBufferCreate(
+    WDFDMAENABLER DmaEnabler,
+    size_t Length,
+    WDF_OBJECT_ATTRIBUTES *Attributes,
+    WDFCOMMONBUFFER *CommonBuffer);
+NTSTATUS WdfCommonBufferCreateWithConfig(
+    WDFDMAENABLER DmaEnabler,
+    size_t Length,
+    WDF_COMMON_BUFFER_CONFIG *Config,
+    WDF_OBJECT_ATTRIBUTES *Attributes,
+    WDFCOMMONBUFFER *CommonBuffer);
+PVOID WdfCommonBufferGetAlignedVirtualAddress(WDFCOMMONBUFFER CommonBuffer);
+PHYSICAL_ADDRESS WdfCommonBufferGetAlignedLogicalAddress(WDFCOMMONBUFFER CommonBuffer);
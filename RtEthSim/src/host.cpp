@@ -0,0 +1,859 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#include "sim/host.h"
+
+#include <chrono>
+#include <stdexcept>
+
+#include "internal.h"
+
+EXTERN_C DRIVER_INITIALIZE DriverEntry;
+
+namespace sim
+{
+
+// Where the register window claims to be, the driver only passes it back
+static LONGLONG const RegisterBase = 0xf7d00000;
+
+// Each round that does work costs the processor this long, in 100ns units
+static ULONG64 const RoundTime = 10;
+
+static ULONG const FragmentBufferAlignment = 64;
+
+static UCHAR const HashSecretKey[40] =
+{
+    0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+    0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+    0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+    0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+    0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa,
+};
+
+static void
+Check(NTSTATUS status, char const *what)
+{
+    if (! NT_SUCCESS(status))
+    {
+        char message[128];
+        snprintf(message, sizeof(message), "%s failed with 0x%08x", what, (unsigned)status);
+        throw std::runtime_error(message);
+    }
+}
+
+template <typename T>
+static T *
+FindChild(Object *parent)
+{
+    for (Object *child : parent->Children)
+    {
+        if (auto *found = dynamic_cast<T *>(child))
+        {
+            return found;
+        }
+    }
+
+    return nullptr;
+}
+
+struct RingIndices
+{
+    UINT32 PacketBegin, PacketNext, PacketEnd;
+    UINT32 FragmentBegin, FragmentNext, FragmentEnd;
+
+    explicit RingIndices(Queue const *queue) :
+        PacketBegin(queue->PacketRing.BeginIndex),
+        PacketNext(queue->PacketRing.NextIndex),
+        PacketEnd(queue->PacketRing.EndIndex),
+        FragmentBegin(queue->FragmentRing.BeginIndex),
+        FragmentNext(queue->FragmentRing.NextIndex),
+        FragmentEnd(queue->FragmentRing.EndIndex)
+    {
+    }
+
+    bool operator==(RingIndices const &other) const
+    {
+        return 0 == memcmp(this, &other, sizeof(*this));
+    }
+};
+
+static UINT32
+RingFree(NET_RING const *ring)
+{
+    return (ring->BeginIndex - ring->EndIndex - 1) & ring->ElementIndexMask;
+}
+
+static UCHAR *
+AlignedBuffer(std::vector<UCHAR> &storage)
+{
+    return static_cast<UCHAR *>(ALIGN_UP_POINTER_BY(storage.data(), FragmentBufferAlignment));
+}
+
+Host::Host(HostConfig const &config)
+{
+    NT_ASSERT(config.MessageCount == 1 || config.MessageCount == 2 || config.MessageCount == 4);
+
+    TheMachine = Machine();
+    TheMachine.Keywords = config.Keywords;
+
+    m_mmio.reset(new Mmio(config.TrapMmio));
+    m_model.reset(new Rtl8168(*m_mmio, config.MacAddress, config.MessageCount));
+
+    if (config.CountCacheMisses)
+    {
+        m_cacheMisses.reset(new CacheMissCounter());
+    }
+
+    TheMachine.Window = m_mmio.get();
+    TheMachine.Model = m_model.get();
+
+    DRIVER_OBJECT driverObject = {};
+    WCHAR registryPath[] = L"\\Registry\\Machine\\System\\CurrentControlSet\\Services\\RtEthSample";
+    UNICODE_STRING registryPathString =
+        { (USHORT)(sizeof(registryPath) - sizeof(WCHAR)), (USHORT)sizeof(registryPath), registryPath };
+
+    Check(DriverEntry(&driverObject, &registryPathString), "DriverEntry");
+
+    Driver *driver = TheMachine.TheDriver;
+    WDFDEVICE_INIT deviceInit;
+    Check(driver->Config.EvtDriverDeviceAdd(ToHandle<WDFDRIVER>(driver), &deviceInit), "EvtDriverDeviceAdd");
+
+    auto *device = FindChild<sim::Device>(driver);
+    auto *adapter = FindChild<sim::Adapter>(device);
+    m_device = ToHandle<WDFDEVICE>(device);
+    m_netAdapter = ToHandle<NETADAPTER>(adapter);
+    m_adapter = RtGetAdapterContext(m_netAdapter);
+
+    // A register window, then one interrupt descriptor per message
+    auto *raw = new ResourceList();
+    auto *translated = new ResourceList();
+
+    CM_PARTIAL_RESOURCE_DESCRIPTOR memory = {};
+    memory.Type = CmResourceTypeMemory;
+    memory.u.Memory.Start.QuadPart = RegisterBase;
+    memory.u.Memory.Length = Mmio::Size;
+    raw->Descriptors.push_back(memory);
+    translated->Descriptors.push_back(memory);
+
+    for (ULONG i = 0; i < config.MessageCount; i++)
+    {
+        CM_PARTIAL_RESOURCE_DESCRIPTOR interrupt = {};
+        interrupt.Type = CmResourceTypeInterrupt;
+        interrupt.Flags = CM_RESOURCE_INTERRUPT_LATCHED | CM_RESOURCE_INTERRUPT_MESSAGE;
+        interrupt.u.MessageInterrupt.Raw.MessageCount = (USHORT)config.MessageCount;
+        interrupt.u.MessageInterrupt.Raw.Vector = i;
+        raw->Descriptors.push_back(interrupt);
+
+        interrupt.u.MessageInterrupt.Translated.Level = 5;
+        interrupt.u.MessageInterrupt.Translated.Vector = 0x80 + i;
+        translated->Descriptors.push_back(interrupt);
+    }
+
+    m_resourcesRaw = ToHandle<WDFCMRESLIST>(raw);
+    m_resourcesTranslated = ToHandle<WDFCMRESLIST>(translated);
+    TheMachine.RawResources = raw;
+
+    Check(device->PnpPower.EvtDevicePrepareHardware(m_device, m_resourcesRaw, m_resourcesTranslated),
+        "EvtDevicePrepareHardware");
+
+    NT_ASSERT(adapter->Started);
+
+    // The stack turns on every offload the adapter offers
+    Offload offload;
+    offload.ChecksumIPv4 = adapter->Checksum.IPv4;
+    offload.ChecksumTcp = adapter->Checksum.Tcp;
+    offload.ChecksumUdp = adapter->Checksum.Udp;
+    offload.LsoIPv4 = adapter->Lso.IPv4;
+    offload.LsoIPv6 = adapter->Lso.IPv6;
+
+    if (adapter->Checksum.EvtAdapterOffloadSetChecksum != nullptr)
+    {
+        adapter->Checksum.EvtAdapterOffloadSetChecksum(m_netAdapter, ToHandle<NETOFFLOAD>(&offload));
+    }
+
+    if (adapter->Lso.EvtAdapterOffloadSetLso != nullptr)
+    {
+        adapter->Lso.EvtAdapterOffloadSetLso(m_netAdapter, ToHandle<NETOFFLOAD>(&offload));
+    }
+
+    Check(device->PnpPower.EvtDeviceD0Entry(m_device, WdfPowerDeviceD3Final), "EvtDeviceD0Entry");
+
+    for (Interrupt *interrupt : TheMachine.Interrupts)
+    {
+        if (interrupt->Config.EvtInterruptEnable != nullptr)
+        {
+            Check(interrupt->Config.EvtInterruptEnable(ToHandle<WDFINTERRUPT>(interrupt), m_device),
+                "EvtInterruptEnable");
+        }
+    }
+
+    SetPacketFilter(NetPacketFilterFlagDirected | NetPacketFilterFlagMulticast | NetPacketFilterFlagBroadcast);
+
+    StartDatapath();
+}
+
+Host::~Host()
+{
+    StopDatapath();
+
+    auto *device = As<sim::Device>(m_device);
+
+    for (Interrupt *interrupt : TheMachine.Interrupts)
+    {
+        if (interrupt->Config.EvtInterruptDisable != nullptr)
+        {
+            interrupt->Config.EvtInterruptDisable(ToHandle<WDFINTERRUPT>(interrupt), m_device);
+        }
+    }
+
+    device->PnpPower.EvtDeviceD0Exit(m_device, WdfPowerDeviceD3Final);
+    device->PnpPower.EvtDeviceReleaseHardware(m_device, m_resourcesTranslated);
+
+    // The framework takes the interrupts away with the hardware
+    while (! TheMachine.Interrupts.empty())
+    {
+        Delete(TheMachine.Interrupts.back());
+    }
+
+    TheMachine.RawResources = nullptr;
+    Delete(ToObject(m_resourcesRaw));
+    Delete(ToObject(m_resourcesTranslated));
+
+    if (TheMachine.TheDriver != nullptr)
+    {
+        Driver *driver = TheMachine.TheDriver;
+        if (driver->Config.EvtDriverUnload != nullptr)
+        {
+            driver->Config.EvtDriverUnload(ToHandle<WDFDRIVER>(driver));
+        }
+
+        Delete(driver);
+    }
+
+    NT_ASSERT(! TheMachine.RegistersMapped);
+
+    TheMachine.Model = nullptr;
+    TheMachine.Window = nullptr;
+}
+
+void
+Host::StartDatapath()
+{
+    auto *adapter = As<sim::Adapter>(m_netAdapter);
+
+    NETTXQUEUE_INIT txInit;
+    txInit.Owner = adapter;
+    Check(adapter->Datapath.EvtAdapterCreateTxQueue(m_netAdapter, &txInit), "EvtAdapterCreateTxQueue");
+    m_txQueue.Instance = txInit.Created;
+    m_txQueue.Buffers.resize(m_txQueue.Instance->FragmentRing.NumberOfElements);
+
+    // With receive side scaling the framework creates a queue per RSS queue
+    ULONG const rxQueueCount = adapter->ReceiveScaling.Size != 0
+        ? adapter->ReceiveScaling.NumberOfQueues
+        : 1;
+
+    m_rxQueues.resize(rxQueueCount);
+
+    for (ULONG queueId = 0; queueId < rxQueueCount; queueId++)
+    {
+        NETRXQUEUE_INIT rxInit;
+        rxInit.Owner = adapter;
+        rxInit.QueueId = queueId;
+        Check(adapter->Datapath.EvtAdapterCreateRxQueue(m_netAdapter, &rxInit), "EvtAdapterCreateRxQueue");
+
+        QueueState &rx = m_rxQueues[queueId];
+        rx.Instance = rxInit.Created;
+        rx.BufferSize = adapter->Rx.MaximumFrameSize;
+        rx.Buffers.resize(rx.Instance->FragmentRing.NumberOfElements);
+
+        for (auto &buffer : rx.Buffers)
+        {
+            buffer.resize(rx.BufferSize + FragmentBufferAlignment);
+        }
+
+        ReturnRxBuffers(rx);
+    }
+
+    for (QueueState &rx : m_rxQueues)
+    {
+        rx.Instance->Config.EvtStart(ToHandle<NETPACKETQUEUE>(rx.Instance));
+    }
+
+    m_txQueue.Instance->Config.EvtStart(ToHandle<NETPACKETQUEUE>(m_txQueue.Instance));
+
+    if (adapter->ReceiveScaling.Size != 0)
+    {
+        NET_ADAPTER_RECEIVE_SCALING_HASH_SECRET_KEY key = { HashSecretKey, sizeof(HashSecretKey) };
+        Check(adapter->ReceiveScaling.EvtAdapterReceiveScalingSetHashSecretKey(m_netAdapter, &key),
+            "EvtAdapterReceiveScalingSetHashSecretKey");
+
+        std::vector<ULONG> table(adapter->ReceiveScaling.IndirectionTableSize);
+        for (size_t i = 0; i < table.size(); i++)
+        {
+            table[i] = (ULONG)(i % rxQueueCount);
+        }
+
+        Check(SetIndirectionTable(table), "EvtAdapterReceiveScalingSetIndirectionEntries");
+
+        Check(adapter->ReceiveScaling.EvtAdapterReceiveScalingEnable(
+                m_netAdapter,
+                NetAdapterReceiveScalingHashTypeToeplitz,
+                NetAdapterReceiveScalingProtocolTypeIPv4 |
+                NetAdapterReceiveScalingProtocolTypeIPv6 |
+                NetAdapterReceiveScalingProtocolTypeTcp),
+            "EvtAdapterReceiveScalingEnable");
+    }
+}
+
+void
+Host::StopDatapath()
+{
+    // Transmit cannot be cancelled on this hardware, it drains instead
+    m_txQueue.Instance->Config.EvtCancel(ToHandle<NETPACKETQUEUE>(m_txQueue.Instance));
+
+    ULONG64 const deadline = TheMachine.Now + 1000 * 10000ULL;
+    NET_RING const *txPackets = &m_txQueue.Instance->PacketRing;
+
+    while (txPackets->BeginIndex != txPackets->EndIndex)
+    {
+        if (TheMachine.Now > deadline)
+        {
+            throw std::runtime_error("the transmit queue did not drain");
+        }
+
+        m_model->Service();
+        Advance(m_txQueue);
+        TheMachine.Now += RoundTime;
+    }
+
+    for (QueueState &rx : m_rxQueues)
+    {
+        rx.Instance->Config.EvtCancel(ToHandle<NETPACKETQUEUE>(rx.Instance));
+        CollectRx(rx);
+
+        NT_ASSERT(rx.Instance->PacketRing.BeginIndex == rx.Instance->PacketRing.EndIndex);
+        NT_ASSERT(rx.Instance->FragmentRing.BeginIndex == rx.Instance->FragmentRing.EndIndex);
+    }
+
+    m_txQueue.Instance->Config.EvtStop(ToHandle<NETPACKETQUEUE>(m_txQueue.Instance));
+
+    for (QueueState &rx : m_rxQueues)
+    {
+        rx.Instance->Config.EvtStop(ToHandle<NETPACKETQUEUE>(rx.Instance));
+    }
+
+    Delete(m_txQueue.Instance);
+    m_txQueue = QueueState();
+
+    for (QueueState &rx : m_rxQueues)
+    {
+        Delete(rx.Instance);
+    }
+
+    m_rxQueues.clear();
+}
+
+bool
+Host::Send(TxPacket const &packet)
+{
+    NT_ASSERT(packet.FragmentCount > 0 && packet.Data.size() >= packet.FragmentCount);
+
+    Queue *queue = m_txQueue.Instance;
+    NET_RING *pr = &queue->PacketRing;
+    NET_RING *fr = &queue->FragmentRing;
+
+    if (RingFree(pr) < 1 || RingFree(fr) < packet.FragmentCount)
+    {
+        return false;
+    }
+
+    UINT32 const packetIndex = pr->EndIndex;
+    NET_PACKET *netPacket = NetRingGetPacketAtIndex(pr, packetIndex);
+    *netPacket = {};
+    netPacket->FragmentIndex = fr->EndIndex;
+    netPacket->FragmentCount = packet.FragmentCount;
+    netPacket->Layout = packet.Layout;
+
+    queue->Checksum[packetIndex] = packet.Checksum;
+    queue->Lso[packetIndex] = {};
+    queue->Lso[packetIndex].TCP.Mss = packet.Mss;
+    queue->Ieee8021q[packetIndex] = packet.Ieee8021q;
+
+    size_t const size = packet.Data.size();
+    size_t offset = 0;
+
+    for (UINT16 i = 0; i < packet.FragmentCount; i++)
+    {
+        size_t const length = size * (i + 1) / packet.FragmentCount - offset;
+        UINT32 const fragmentIndex = fr->EndIndex;
+
+        std::vector<UCHAR> &buffer = m_txQueue.Buffers[fragmentIndex];
+        buffer.assign(packet.Data.begin() + offset, packet.Data.begin() + offset + length);
+
+        NET_FRAGMENT *fragment = NetRingGetFragmentAtIndex(fr, fragmentIndex);
+        *fragment = {};
+        fragment->ValidLength = length;
+        fragment->Capacity = length;
+
+        queue->VirtualAddress[fragmentIndex].VirtualAddress = buffer.data();
+        queue->LogicalAddress[fragmentIndex].LogicalAddress = (LOGICAL_ADDRESS)(ULONG_PTR)buffer.data();
+
+        fr->EndIndex = NetRingIncrementIndex(fr, fragmentIndex);
+        offset += length;
+    }
+
+    pr->EndIndex = NetRingIncrementIndex(pr, packetIndex);
+
+    m_txPending = true;
+    m_txOutstanding++;
+
+    return true;
+}
+
+void
+Host::Receive(RxFrame frame, ULONG queueId)
+{
+    m_model->Receive(queueId, std::move(frame));
+}
+
+void
+Host::ReturnRxBuffers(QueueState &queue)
+{
+    NET_RING *pr = &queue.Instance->PacketRing;
+    NET_RING *fr = &queue.Instance->FragmentRing;
+
+    // Everything the driver has handed back goes straight back to it
+    pr->EndIndex = (pr->BeginIndex - 1) & pr->ElementIndexMask;
+
+    UINT32 const end = (fr->BeginIndex - 1) & fr->ElementIndexMask;
+    for (UINT32 index = fr->EndIndex; index != end; index = NetRingIncrementIndex(fr, index))
+    {
+        UCHAR *buffer = AlignedBuffer(queue.Buffers[index]);
+
+        NET_FRAGMENT *fragment = NetRingGetFragmentAtIndex(fr, index);
+        *fragment = {};
+        fragment->Capacity = queue.BufferSize;
+
+        queue.Instance->VirtualAddress[index].VirtualAddress = buffer;
+        queue.Instance->LogicalAddress[index].LogicalAddress = (LOGICAL_ADDRESS)(ULONG_PTR)buffer;
+    }
+
+    fr->EndIndex = end;
+}
+
+void
+Host::CollectRx(QueueState &queue)
+{
+    NET_RING const *pr = &queue.Instance->PacketRing;
+    NET_RING const *fr = &queue.Instance->FragmentRing;
+
+    for (; queue.Returned != pr->BeginIndex; queue.Returned = NetRingIncrementIndex(pr, queue.Returned))
+    {
+        NET_PACKET const *packet = NetRingGetPacketAtIndex(pr, queue.Returned);
+
+        if (packet->Ignore)
+        {
+            continue;
+        }
+
+        Counters.RxPacketsIndicated++;
+
+        if (! m_record)
+        {
+            continue;
+        }
+
+        RxPacket received = {};
+        received.QueueId = queue.Instance->QueueId;
+        received.FragmentCount = packet->FragmentCount;
+        received.Layout = packet->Layout;
+        received.Checksum = queue.Instance->Checksum[queue.Returned];
+        received.Ieee8021q = queue.Instance->Ieee8021q[queue.Returned];
+
+        for (UINT16 i = 0; i < packet->FragmentCount; i++)
+        {
+            UINT32 const index = (packet->FragmentIndex + i) & fr->ElementIndexMask;
+            NET_FRAGMENT const *fragment = NetRingGetFragmentAtIndex(fr, index);
+            UCHAR const *data = AlignedBuffer(queue.Buffers[index]) + fragment->Offset;
+
+            received.Data.insert(received.Data.end(), data, data + fragment->ValidLength);
+        }
+
+        m_received.push_back(std::move(received));
+    }
+}
+
+void
+Host::CollectTx(QueueState &queue)
+{
+    NET_RING const *pr = &queue.Instance->PacketRing;
+
+    for (; queue.Returned != pr->BeginIndex; queue.Returned = NetRingIncrementIndex(pr, queue.Returned))
+    {
+        NT_ASSERT(m_txOutstanding > 0);
+
+        m_txOutstanding--;
+        Counters.TxPacketsCompleted++;
+    }
+}
+
+// Advances a queue and hands its results to the stack. Returns whether the
+// driver made progress.
+bool
+Host::Advance(QueueState &queue)
+{
+    Queue *instance = queue.Instance;
+    RingIndices const before(instance);
+
+    ULONG64 const missesBefore = m_cacheMisses ? m_cacheMisses->Read() : 0;
+    auto const start = std::chrono::steady_clock::now();
+
+    instance->Config.EvtAdvance(ToHandle<NETPACKETQUEUE>(instance));
+
+    auto const elapsed = std::chrono::steady_clock::now() - start;
+    ULONG64 const nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    ULONG64 const misses = m_cacheMisses ? m_cacheMisses->Read() - missesBefore : 0;
+
+    bool progress = ! (RingIndices(instance) == before);
+
+    if (instance->Transmit)
+    {
+        Counters.TxAdvances++;
+        Counters.TxAdvanceNanoseconds += nanoseconds;
+        Counters.TxAdvanceCacheMisses += misses;
+        progress = progress || m_txPending;
+        m_txPending = false;
+
+        CollectTx(queue);
+    }
+    else
+    {
+        Counters.RxAdvances++;
+        Counters.RxAdvanceNanoseconds += nanoseconds;
+        Counters.RxAdvanceCacheMisses += misses;
+
+        CollectRx(queue);
+        ReturnRxBuffers(queue);
+    }
+
+    return progress;
+}
+
+bool
+Host::PollQueues()
+{
+    bool busy = false;
+
+    std::vector<QueueState *> queues;
+    for (QueueState &rx : m_rxQueues)
+    {
+        queues.push_back(&rx);
+    }
+    queues.push_back(&m_txQueue);
+
+    for (QueueState *queue : queues)
+    {
+        Queue *instance = queue->Instance;
+        NETPACKETQUEUE const handle = ToHandle<NETPACKETQUEUE>(instance);
+
+        if (queue->State == PollState::Armed)
+        {
+            bool const moreToSend = instance->Transmit && m_txPending;
+
+            if (! instance->Notified && ! moreToSend)
+            {
+                continue;
+            }
+
+            // The driver disarms itself before it notifies
+            if (! instance->Notified)
+            {
+                instance->Config.EvtSetNotificationEnabled(handle, FALSE);
+            }
+
+            instance->Notified = false;
+            queue->State = PollState::Polling;
+        }
+
+        busy = true;
+
+        if (Advance(*queue))
+        {
+            continue;
+        }
+
+        instance->Notified = false;
+        instance->Config.EvtSetNotificationEnabled(handle, TRUE);
+        queue->State = PollState::Armed;
+
+        if (Advance(*queue) && ! instance->Notified)
+        {
+            instance->Config.EvtSetNotificationEnabled(handle, FALSE);
+            queue->State = PollState::Polling;
+        }
+    }
+
+    return busy;
+}
+
+void
+Host::DeliverInterrupts()
+{
+    ULONG const raised = m_model->TakeRaisedMessages();
+
+    for (ULONG message = 0; message < RT_NUMBER_OF_QUEUES; message++)
+    {
+        if (0 == (raised & (1 << message)))
+        {
+            continue;
+        }
+
+        RT_MAC const *registers = m_model->Registers();
+        UINT16 const imrBefore[RT_NUMBER_OF_QUEUES] =
+            { registers->IMR0, registers->IMR1, registers->IMR2, registers->IMR3 };
+
+        for (Interrupt *interrupt : TheMachine.Interrupts)
+        {
+            if (interrupt->MessageId == message)
+            {
+                Counters.Isrs++;
+
+                m_mmio->SetInIsr(true);
+                interrupt->Config.EvtInterruptIsr(ToHandle<WDFINTERRUPT>(interrupt), message);
+                m_mmio->SetInIsr(false);
+            }
+        }
+
+        // Without trapping, the driver's write one to clear acknowledgments
+        // are plain stores; drop the status it read as the hardware would
+        if (! m_mmio->Trapping())
+        {
+            bool const perQueue = TheMachine.Interrupts.size() >= RT_NUMBER_OF_QUEUES &&
+                m_adapter->RxInterrupt[0] != m_adapter->RxInterrupt[1];
+
+            for (ULONG queueId = 0; queueId < RT_NUMBER_OF_QUEUES; queueId++)
+            {
+                bool const read = perQueue
+                    ? queueId == message && (queueId == 0 || imrBefore[queueId] != 0)
+                    : queueId == 0 || imrBefore[queueId] != 0;
+
+                if (read)
+                {
+                    m_model->ClearInterruptStatus(queueId);
+                }
+            }
+        }
+    }
+
+    for (Interrupt *interrupt : TheMachine.Interrupts)
+    {
+        if (interrupt->DpcQueued)
+        {
+            Counters.Dpcs++;
+        }
+    }
+
+    TheMachine.RunQueuedDpcs();
+}
+
+void
+Host::RunTimersAndWorkItems()
+{
+    // Copies, a callback may delete or create timers
+    std::vector<Timer *> const timers = TheMachine.Timers;
+
+    for (Timer *timer : timers)
+    {
+        if (timer->Running && timer->Due <= TheMachine.Now)
+        {
+            if (timer->Config.Period != 0)
+            {
+                timer->Due += (ULONG64)timer->Config.Period * 10000;
+            }
+            else
+            {
+                timer->Running = false;
+            }
+
+            timer->Config.EvtTimerFunc(ToHandle<WDFTIMER>(timer));
+        }
+    }
+
+    std::vector<WorkItem *> const workItems = TheMachine.WorkItems;
+
+    for (WorkItem *workItem : workItems)
+    {
+        WdfWorkItemFlush(ToHandle<WDFWORKITEM>(workItem));
+    }
+}
+
+bool
+Host::Step()
+{
+    m_model->Service();
+
+    ULONG64 const dpcs = Counters.Dpcs;
+    ULONG64 const isrs = Counters.Isrs;
+
+    DeliverInterrupts();
+    RunTimersAndWorkItems();
+
+    bool busy = PollQueues();
+    busy = busy || Counters.Dpcs != dpcs || Counters.Isrs != isrs;
+
+    if (busy)
+    {
+        TheMachine.Now += RoundTime;
+    }
+
+    return busy;
+}
+
+ULONG64
+Host::NextEvent() const
+{
+    ULONG64 next = m_model->NextEventTime();
+
+    for (Timer const *timer : TheMachine.Timers)
+    {
+        if (timer->Running)
+        {
+            next = min(next, timer->Due);
+        }
+    }
+
+    return next;
+}
+
+void
+Host::Run(ULONG64 duration)
+{
+    ULONG64 const end = TheMachine.Now + duration;
+
+    while (TheMachine.Now < end)
+    {
+        if (! Step())
+        {
+            ULONG64 const next = NextEvent();
+            TheMachine.Now = next > TheMachine.Now ? min(next, end) : TheMachine.Now + RoundTime;
+        }
+    }
+}
+
+bool
+Host::RunUntilIdle(ULONG64 limit)
+{
+    ULONG64 const end = TheMachine.Now + limit;
+
+    while (TheMachine.Now < end)
+    {
+        if (Step())
+        {
+            continue;
+        }
+
+        if (m_txOutstanding == 0 && m_model->NextEventTime() == ~0ULL)
+        {
+            return true;
+        }
+
+        ULONG64 const next = NextEvent();
+        TheMachine.Now = next > TheMachine.Now ? min(next, end) : TheMachine.Now + RoundTime;
+    }
+
+    return false;
+}
+
+std::vector<RxPacket>
+Host::TakeReceived()
+{
+    std::vector<RxPacket> received;
+    received.swap(m_received);
+    return received;
+}
+
+size_t
+Host::TxOutstanding() const
+{
+    return m_txOutstanding;
+}
+
+NTSTATUS
+Host::SetIndirectionTable(std::vector<ULONG> const &queueIds)
+{
+    std::vector<IndirectionEntry> entries(queueIds.size());
+    for (size_t i = 0; i < queueIds.size(); i++)
+    {
+        entries[i] = { (UINT32)i, queueIds[i] };
+    }
+
+    return SetIndirectionEntries(entries);
+}
+
+NTSTATUS
+Host::SetIndirectionEntries(std::vector<IndirectionEntry> const &entries)
+{
+    auto *adapter = As<sim::Adapter>(m_netAdapter);
+
+    std::vector<NET_ADAPTER_RECEIVE_SCALING_INDIRECTION_ENTRY> driverEntries(entries.size());
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        NT_ASSERT(entries[i].QueueId < m_rxQueues.size());
+
+        driverEntries[i].Index = entries[i].Index;
+        driverEntries[i].PacketQueue = ToHandle<NETPACKETQUEUE>(m_rxQueues[entries[i].QueueId].Instance);
+    }
+
+    NET_ADAPTER_RECEIVE_SCALING_INDIRECTION_ENTRIES indirectionEntries = { driverEntries.size(), driverEntries.data() };
+
+    return adapter->ReceiveScaling.EvtAdapterReceiveScalingSetIndirectionEntries(m_netAdapter, &indirectionEntries);
+}
+
+void
+Host::SetPacketFilter(NET_PACKET_FILTER_FLAGS filter)
+{
+    As<sim::Adapter>(m_netAdapter)->PacketFilter.EvtSetPacketFilter(m_netAdapter, filter);
+}
+
+void
+Host::SetMulticastList(std::vector<std::vector<UCHAR>> const &addresses)
+{
+    std::vector<NET_ADAPTER_LINK_LAYER_ADDRESS> list(addresses.size());
+    for (size_t i = 0; i < addresses.size(); i++)
+    {
+        list[i].Length = (USHORT)addresses[i].size();
+        RtlCopyMemory(list[i].Address, addresses[i].data(), min(addresses[i].size(), sizeof(list[i].Address)));
+    }
+
+    As<sim::Adapter>(m_netAdapter)->Multicast.EvtSetMulticastList(m_netAdapter, (ULONG)list.size(), list.data());
+}
+
+ULONG64
+Host::Now() const
+{
+    return TheMachine.Now;
+}
+
+void
+Host::SetRecording(bool record)
+{
+    m_record = record;
+    m_model->CaptureTransmitted = record;
+    m_model->RecordInterrupts = record;
+}
+
+bool
+Host::CountingCacheMisses() const
+{
+    return m_cacheMisses && m_cacheMisses->Available();
+}
+
+}
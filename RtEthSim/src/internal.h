@@ -0,0 +1,261 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#pragma once
+
+// Objects behind the WDF and NetAdapterCx handles, and the state the
+// framework and kernel stand-ins share with the host loop.
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "precomp.h"
+
+#include "sim/mmio.h"
+#include "sim/rtl8168.h"
+
+namespace sim
+{
+
+// A framework object. Children are deleted before their parent, and an
+// object's context stays valid until its destroy callback has run.
+struct Object
+{
+    Object() = default;
+    virtual ~Object() = default;
+
+    Object(Object const &) = delete;
+    Object &operator=(Object const &) = delete;
+
+    Object *Parent = nullptr;
+    std::vector<Object *> Children;
+
+    WDF_OBJECT_CONTEXT_TYPE_INFO const *ContextType = nullptr;
+    void *Context = nullptr;
+
+    PFN_WDF_OBJECT_CONTEXT_CLEANUP EvtCleanup = nullptr;
+    PFN_WDF_OBJECT_CONTEXT_DESTROY EvtDestroy = nullptr;
+};
+
+// Applies attributes to a new object and links it to its parent, which is
+// the one in the attributes if any, defaultParent otherwise
+void Attach(Object *object, WDF_OBJECT_ATTRIBUTES const *attributes, Object *defaultParent);
+
+void Delete(Object *object);
+
+template <typename Handle>
+Object *
+ToObject(Handle handle)
+{
+    return static_cast<Object *>(static_cast<void *>(handle));
+}
+
+template <typename Handle>
+Handle
+ToHandle(Object *object)
+{
+    return reinterpret_cast<Handle>(object);
+}
+
+template <typename T, typename Handle>
+T *
+As(Handle handle)
+{
+    T *object = dynamic_cast<T *>(ToObject(handle));
+    NT_ASSERT(object != nullptr);
+    return object;
+}
+
+struct Driver : Object
+{
+    WDF_DRIVER_CONFIG Config = {};
+};
+
+struct Device : Object
+{
+    WDF_PNPPOWER_EVENT_CALLBACKS PnpPower = {};
+    WDF_POWER_POLICY_EVENT_CALLBACKS PowerPolicy = {};
+    bool Failed = false;
+};
+
+struct ResourceList : Object
+{
+    std::vector<CM_PARTIAL_RESOURCE_DESCRIPTOR> Descriptors;
+};
+
+struct Lock : Object
+{
+};
+
+struct DmaEnabler : Object
+{
+};
+
+struct Interrupt : Object
+{
+    WDF_INTERRUPT_CONFIG Config = {};
+    Device *AssociatedDevice = nullptr;
+    ULONG MessageId = 0;
+    bool DpcQueued = false;
+};
+
+struct Timer : Object
+{
+    WDF_TIMER_CONFIG Config = {};
+    bool Running = false;
+    ULONG64 Due = 0;
+};
+
+struct WorkItem : Object
+{
+    WDF_WORKITEM_CONFIG Config = {};
+    bool Enqueued = false;
+};
+
+struct Memory : Object
+{
+    ~Memory() override;
+
+    void *Buffer = nullptr;
+};
+
+struct CommonBuffer : Object
+{
+    ~CommonBuffer() override;
+
+    void *Allocation = nullptr;
+    UCHAR *Aligned = nullptr;
+};
+
+struct Adapter : Object
+{
+    Device *Owner = nullptr;
+    bool Started = false;
+
+    NET_ADAPTER_DATAPATH_CALLBACKS Datapath = {};
+
+    NET_ADAPTER_LINK_LAYER_CAPABILITIES LinkLayer = {};
+    ULONG MtuSize = 0;
+    NET_ADAPTER_LINK_LAYER_ADDRESS PermanentAddress = {};
+    NET_ADAPTER_LINK_LAYER_ADDRESS CurrentAddress = {};
+    NET_ADAPTER_LINK_STATE LinkState = {};
+
+    NET_ADAPTER_PACKET_FILTER_CAPABILITIES PacketFilter = {};
+    NET_ADAPTER_MULTICAST_CAPABILITIES Multicast = {};
+    NET_ADAPTER_RECEIVE_SCALING_CAPABILITIES ReceiveScaling = {};
+    NET_ADAPTER_WAKE_MAGIC_PACKET_CAPABILITIES MagicPacket = {};
+
+    NET_ADAPTER_TX_CAPABILITIES Tx = {};
+    NET_ADAPTER_RX_CAPABILITIES Rx = {};
+
+    NET_ADAPTER_OFFLOAD_CHECKSUM_CAPABILITIES Checksum = {};
+    NET_ADAPTER_OFFLOAD_LSO_CAPABILITIES Lso = {};
+    NET_ADAPTER_OFFLOAD_IEEE8021Q_TAG_CAPABILITIES Ieee8021q = {};
+};
+
+// A packet queue and the rings and extensions the framework would own.
+// Both rings have the same number of elements.
+struct Queue : Object
+{
+    bool Transmit = false;
+    ULONG QueueId = 0;
+
+    NET_PACKET_QUEUE_CONFIG Config = {};
+
+    NET_RING PacketRing = {};
+    NET_RING FragmentRing = {};
+    NET_RING_COLLECTION Rings = {};
+
+    std::vector<NET_PACKET> Packets;
+    std::vector<NET_FRAGMENT> Fragments;
+
+    std::vector<NET_PACKET_CHECKSUM> Checksum;
+    std::vector<NET_PACKET_LSO> Lso;
+    std::vector<NET_PACKET_IEEE8021Q> Ieee8021q;
+    std::vector<NET_FRAGMENT_VIRTUAL_ADDRESS> VirtualAddress;
+    std::vector<NET_FRAGMENT_LOGICAL_ADDRESS> LogicalAddress;
+
+    // Set by the driver's notification, cleared when the host polls again
+    bool Notified = false;
+    bool NotificationEnabled = false;
+};
+
+struct Configuration : Object
+{
+};
+
+// The offload state the stack asks for, handed to the offload callbacks
+struct Offload : Object
+{
+    bool ChecksumIPv4 = false;
+    bool ChecksumTcp = false;
+    bool ChecksumUdp = false;
+    bool LsoIPv4 = false;
+    bool LsoIPv6 = false;
+};
+// Everything the harness shares between the stand-ins and the host loop.
+// There is one simulated machine per process at a time.
+struct Machine
+{
+    ULONG64 Now = 0;
+
+    Rtl8168 *Model = nullptr;
+    Mmio *Window = nullptr;
+
+    Driver *TheDriver = nullptr;
+
+    // The raw resources handed to EvtDevicePrepareHardware; an interrupt
+    // created for the Nth interrupt descriptor is connected to message N
+    ResourceList *RawResources = nullptr;
+
+    std::vector<Interrupt *> Interrupts;
+    std::vector<Timer *> Timers;
+    std::vector<WorkItem *> WorkItems;
+
+    std::map<std::wstring, ULONG> Keywords;
+
+    // Set while the hardware is being prepared, so the registers are mapped
+    // only for a device that was given them
+    bool RegistersMapped = false;
+
+    void RunQueuedDpcs();
+};
+
+extern Machine TheMachine;
+
+}
+
+struct WDFDEVICE_INIT
+{
+    WDF_PNPPOWER_EVENT_CALLBACKS PnpPower = {};
+    WDF_POWER_POLICY_EVENT_CALLBACKS PowerPolicy = {};
+    bool NetConfigured = false;
+};
+
+struct NETADAPTER_INIT
+{
+    sim::Device *Owner = nullptr;
+    NET_ADAPTER_DATAPATH_CALLBACKS Datapath = {};
+};
+
+struct NETTXQUEUE_INIT
+{
+    sim::Adapter *Owner = nullptr;
+    sim::Queue *Created = nullptr;
+};
+
+struct NETRXQUEUE_INIT
+{
+    sim::Adapter *Owner = nullptr;
+    ULONG QueueId = 0;
+    sim::Queue *Created = nullptr;
+};
@@ -0,0 +1,104 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#include "internal.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace sim
+{
+
+Machine TheMachine;
+
+bool PrefetchEnabled = true;
+
+void
+AssertFailed(char const *expression, char const *file, int line)
+{
+    fprintf(stderr, "%s:%d: assertion failed: %s\n", file, line, expression);
+    abort();
+}
+
+void
+Machine::RunQueuedDpcs()
+{
+    // A DPC may queue another, run until none is left
+    for (bool ran = true; ran; )
+    {
+        ran = false;
+
+        for (Interrupt *interrupt : Interrupts)
+        {
+            if (interrupt->DpcQueued)
+            {
+                interrupt->DpcQueued = false;
+                interrupt->Config.EvtInterruptDpc(
+                    ToHandle<WDFINTERRUPT>(interrupt),
+                    ToHandle<WDFOBJECT>(interrupt->AssociatedDevice));
+                ran = true;
+            }
+        }
+    }
+}
+
+}
+
+using sim::TheMachine;
+
+ULONG64
+KeQueryInterruptTime()
+{
+    return TheMachine.Now;
+}
+
+void
+KeStallExecutionProcessor(ULONG MicroSeconds)
+{
+    // The device keeps working while the processor spins, but nothing else
+    // runs: interrupts raised meanwhile are delivered by the host loop
+    TheMachine.Now += (ULONG64)MicroSeconds * 10;
+
+    if (TheMachine.Model != nullptr)
+    {
+        TheMachine.Model->Service();
+    }
+}
+
+void
+KeFlushQueuedDpcs()
+{
+    TheMachine.RunQueuedDpcs();
+}
+
+PVOID
+MmMapIoSpaceEx(PHYSICAL_ADDRESS PhysicalAddress, SIZE_T NumberOfBytes, ULONG Protect)
+{
+    UNREFERENCED_PARAMETER(PhysicalAddress);
+    UNREFERENCED_PARAMETER(Protect);
+
+    if (TheMachine.Window == nullptr || NumberOfBytes > sim::Mmio::Size)
+    {
+        return nullptr;
+    }
+
+    TheMachine.RegistersMapped = true;
+    return TheMachine.Window->DriverView();
+}
+
+void
+MmUnmapIoSpace(PVOID BaseAddress, SIZE_T NumberOfBytes)
+{
+    UNREFERENCED_PARAMETER(NumberOfBytes);
+
+    NT_ASSERT(TheMachine.Window != nullptr && BaseAddress == TheMachine.Window->DriverView());
+    TheMachine.RegistersMapped = false;
+}
@@ -0,0 +1,248 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#include "sim/mmio.h"
+
+#include <stdexcept>
+
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+namespace sim
+{
+
+static Mmio *TrapWindow;
+
+static size_t const PageSize = 4096;
+
+// x86 page fault error code bit for a write access, and the trap flag
+static greg_t const PageFaultWrite = 0x2;
+static greg_t const TrapFlag = 0x100;
+
+// Width of the interrupt status register starting at offset, 0 otherwise
+static size_t
+IsrWidth(size_t offset)
+{
+    switch (offset)
+    {
+    case 0x3e:
+        return 2;
+    case 0x86:
+    case 0x87:
+    case 0xc1:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static UINT16
+ReadIsr(UCHAR const *window, size_t offset)
+{
+    return IsrWidth(offset) == 2
+        ? (UINT16)(window[offset] | (window[offset + 1] << 8))
+        : window[offset];
+}
+
+static void
+WriteIsr(UCHAR *window, size_t offset, UINT16 value)
+{
+    window[offset] = (UCHAR)value;
+
+    if (IsrWidth(offset) == 2)
+    {
+        window[offset + 1] = (UCHAR)(value >> 8);
+    }
+}
+
+Mmio::Mmio(bool trap) : m_trap(trap)
+{
+    m_fd = memfd_create("rtethsim-mmio", 0);
+    if (m_fd < 0 || ftruncate(m_fd, PageSize) != 0)
+    {
+        throw std::runtime_error("cannot create the register window");
+    }
+
+    void *driverView = mmap(nullptr, PageSize, trap ? PROT_NONE : PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    void *deviceView = mmap(nullptr, PageSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (driverView == MAP_FAILED || deviceView == MAP_FAILED)
+    {
+        throw std::runtime_error("cannot map the register window");
+    }
+
+    m_driverView = static_cast<UCHAR *>(driverView);
+    m_deviceView = static_cast<UCHAR *>(deviceView);
+
+    if (trap)
+    {
+        if (TrapWindow != nullptr)
+        {
+            throw std::logic_error("only one register window can trap at a time");
+        }
+
+        TrapWindow = this;
+
+        struct sigaction action = {};
+        action.sa_flags = SA_SIGINFO | SA_NODEFER;
+        action.sa_sigaction = OnAccess;
+        sigaction(SIGSEGV, &action, nullptr);
+
+        action.sa_sigaction = OnStep;
+        sigaction(SIGTRAP, &action, nullptr);
+    }
+}
+
+Mmio::~Mmio()
+{
+    if (m_trap)
+    {
+        signal(SIGSEGV, SIG_DFL);
+        signal(SIGTRAP, SIG_DFL);
+        TrapWindow = nullptr;
+    }
+
+    munmap(m_driverView, PageSize);
+    munmap(m_deviceView, PageSize);
+    close(m_fd);
+}
+
+void
+Mmio::OnAccess(int, siginfo_t *info, void *context)
+{
+    Mmio *window = TrapWindow;
+    UCHAR *address = static_cast<UCHAR *>(info->si_addr);
+
+    if (window == nullptr ||
+        address < window->m_driverView ||
+        address >= window->m_driverView + PageSize)
+    {
+        // Not ours, let the access fault again without the handler
+        signal(SIGSEGV, SIG_DFL);
+        return;
+    }
+
+    auto *uc = static_cast<ucontext_t *>(context);
+
+    window->m_offset = address - window->m_driverView;
+    window->m_write = 0 != (uc->uc_mcontext.gregs[REG_ERR] & PageFaultWrite);
+
+    if (window->m_offset < Size)
+    {
+        if (window->m_write)
+        {
+            window->m_writes[window->m_offset]++;
+            window->m_isrWrites[window->m_offset] += window->m_inIsr;
+
+            if (IsrWidth(window->m_offset))
+            {
+                window->m_before = ReadIsr(window->m_deviceView, window->m_offset);
+            }
+        }
+        else
+        {
+            window->m_reads[window->m_offset]++;
+            window->m_isrReads[window->m_offset] += window->m_inIsr;
+        }
+    }
+
+    mprotect(window->m_driverView, PageSize, PROT_READ | PROT_WRITE);
+    uc->uc_mcontext.gregs[REG_EFL] |= TrapFlag;
+}
+
+void
+Mmio::OnStep(int, siginfo_t *, void *context)
+{
+    Mmio *window = TrapWindow;
+    auto *uc = static_cast<ucontext_t *>(context);
+
+    if (window == nullptr || 0 == (uc->uc_mcontext.gregs[REG_EFL] & TrapFlag))
+    {
+        signal(SIGTRAP, SIG_DFL);
+        return;
+    }
+
+    size_t const offset = window->m_offset;
+
+    if (window->m_write && offset < Size)
+    {
+        if (window->m_writeCount < WriteLogSize)
+        {
+            UINT32 value = 0;
+            memcpy(&value, window->m_deviceView + offset, min(sizeof(value), Size - offset));
+            window->m_writeLog[window->m_writeCount++] = { (UINT16)offset, value };
+        }
+
+        // Bits written as one clear the status, bits written as zero keep it
+        if (IsrWidth(offset))
+        {
+            UINT16 const written = ReadIsr(window->m_deviceView, offset);
+            WriteIsr(window->m_deviceView, offset, window->m_before & ~written);
+        }
+    }
+
+    mprotect(window->m_driverView, PageSize, PROT_NONE);
+    uc->uc_mcontext.gregs[REG_EFL] &= ~TrapFlag;
+}
+
+static ULONG64
+Sum(ULONG64 const *counts, size_t offset, size_t length)
+{
+    ULONG64 count = 0;
+    for (size_t i = offset; i < offset + length && i < Mmio::Size; i++)
+    {
+        count += counts[i];
+    }
+
+    return count;
+}
+
+ULONG64
+Mmio::Reads(size_t offset, size_t length) const
+{
+    return Sum(m_reads, offset, length);
+}
+
+ULONG64
+Mmio::Writes(size_t offset, size_t length) const
+{
+    return Sum(m_writes, offset, length);
+}
+
+ULONG64
+Mmio::IsrReads(size_t offset, size_t length) const
+{
+    return Sum(m_isrReads, offset, length);
+}
+
+ULONG64
+Mmio::IsrWrites(size_t offset, size_t length) const
+{
+    return Sum(m_isrWrites, offset, length);
+}
+
+std::vector<MmioWrite>
+Mmio::WriteLog() const
+{
+    return std::vector<MmioWrite>(m_writeLog, m_writeLog + m_writeCount);
+}
+
+void
+Mmio::ResetCounts()
+{
+    memset(m_reads, 0, sizeof(m_reads));
+    memset(m_writes, 0, sizeof(m_writes));
+    memset(m_isrReads, 0, sizeof(m_isrReads));
+    memset(m_isrWrites, 0, sizeof(m_isrWrites));
+    m_writeCount = 0;
+}
+
+}
@@ -0,0 +1,459 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#include "internal.h"
+
+#include <cwchar>
+
+using namespace sim;
+
+// Device and adapter
+
+NTSTATUS
+NetDeviceInitConfig(PWDFDEVICE_INIT DeviceInit)
+{
+    DeviceInit->NetConfigured = true;
+    return STATUS_SUCCESS;
+}
+
+NETADAPTER_INIT *
+NetAdapterInitAllocate(WDFDEVICE Device)
+{
+    auto *adapterInit = new NETADAPTER_INIT();
+    adapterInit->Owner = As<sim::Device>(Device);
+    return adapterInit;
+}
+
+void
+NetAdapterInitFree(NETADAPTER_INIT *AdapterInit)
+{
+    delete AdapterInit;
+}
+
+void
+NetAdapterInitSetDatapathCallbacks(NETADAPTER_INIT *AdapterInit, NET_ADAPTER_DATAPATH_CALLBACKS const *DatapathCallbacks)
+{
+    AdapterInit->Datapath = *DatapathCallbacks;
+}
+
+NTSTATUS
+NetAdapterCreate(NETADAPTER_INIT *AdapterInit, WDF_OBJECT_ATTRIBUTES *AdapterAttributes, NETADAPTER *Adapter)
+{
+    auto *adapter = new sim::Adapter();
+    Attach(adapter, AdapterAttributes, AdapterInit->Owner);
+    adapter->Owner = AdapterInit->Owner;
+    adapter->Datapath = AdapterInit->Datapath;
+
+    *Adapter = ToHandle<NETADAPTER>(adapter);
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+NetAdapterStart(NETADAPTER Adapter)
+{
+    auto *adapter = As<sim::Adapter>(Adapter);
+
+    // The datapath capabilities size the rings, they cannot be left out
+    if (adapter->Tx.Size == 0 || adapter->Rx.Size == 0)
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    adapter->Started = true;
+    return STATUS_SUCCESS;
+}
+
+// Capabilities and state
+
+void
+NetAdapterSetLinkLayerCapabilities(NETADAPTER Adapter, NET_ADAPTER_LINK_LAYER_CAPABILITIES const *Capabilities)
+{
+    As<sim::Adapter>(Adapter)->LinkLayer = *Capabilities;
+}
+
+void
+NetAdapterSetLinkLayerMtuSize(NETADAPTER Adapter, ULONG MtuSize)
+{
+    As<sim::Adapter>(Adapter)->MtuSize = MtuSize;
+}
+
+void
+NetAdapterSetPermanentLinkLayerAddress(NETADAPTER Adapter, NET_ADAPTER_LINK_LAYER_ADDRESS *LinkLayerAddress)
+{
+    As<sim::Adapter>(Adapter)->PermanentAddress = *LinkLayerAddress;
+}
+
+void
+NetAdapterSetCurrentLinkLayerAddress(NETADAPTER Adapter, NET_ADAPTER_LINK_LAYER_ADDRESS *LinkLayerAddress)
+{
+    As<sim::Adapter>(Adapter)->CurrentAddress = *LinkLayerAddress;
+}
+
+void
+NetAdapterSetPacketFilterCapabilities(NETADAPTER Adapter, NET_ADAPTER_PACKET_FILTER_CAPABILITIES const *Capabilities)
+{
+    As<sim::Adapter>(Adapter)->PacketFilter = *Capabilities;
+}
+
+void
+NetAdapterSetMulticastCapabilities(NETADAPTER Adapter, NET_ADAPTER_MULTICAST_CAPABILITIES const *Capabilities)
+{
+    As<sim::Adapter>(Adapter)->Multicast = *Capabilities;
+}
+
+void
+NetAdapterSetLinkState(NETADAPTER Adapter, NET_ADAPTER_LINK_STATE *LinkState)
+{
+    As<sim::Adapter>(Adapter)->LinkState = *LinkState;
+}
+
+void
+NetAdapterSetReceiveScalingCapabilities(NETADAPTER Adapter, NET_ADAPTER_RECEIVE_SCALING_CAPABILITIES const *Capabilities)
+{
+    As<sim::Adapter>(Adapter)->ReceiveScaling = *Capabilities;
+}
+
+void
+NetAdapterWakeSetMagicPacketCapabilities(NETADAPTER Adapter, NET_ADAPTER_WAKE_MAGIC_PACKET_CAPABILITIES const *Capabilities)
+{
+    As<sim::Adapter>(Adapter)->MagicPacket = *Capabilities;
+}
+
+void
+NetAdapterSetDataPathCapabilities(
+    NETADAPTER Adapter,
+    NET_ADAPTER_TX_CAPABILITIES const *TxCapabilities,
+    NET_ADAPTER_RX_CAPABILITIES const *RxCapabilities)
+{
+    auto *adapter = As<sim::Adapter>(Adapter);
+
+    // The DMA capabilities live on the caller's stack
+    adapter->Tx = *TxCapabilities;
+    adapter->Tx.DmaCapabilities = nullptr;
+    adapter->Rx = *RxCapabilities;
+    adapter->Rx.DmaCapabilities = nullptr;
+}
+
+void
+NetAdapterOffloadSetChecksumCapabilities(NETADAPTER Adapter, NET_ADAPTER_OFFLOAD_CHECKSUM_CAPABILITIES const *Capabilities)
+{
+    As<sim::Adapter>(Adapter)->Checksum = *Capabilities;
+}
+
+void
+NetAdapterOffloadSetLsoCapabilities(NETADAPTER Adapter, NET_ADAPTER_OFFLOAD_LSO_CAPABILITIES const *Capabilities)
+{
+    As<sim::Adapter>(Adapter)->Lso = *Capabilities;
+}
+
+void
+NetAdapterOffloadSetIeee8021qTagCapabilities(NETADAPTER Adapter, NET_ADAPTER_OFFLOAD_IEEE8021Q_TAG_CAPABILITIES const *Capabilities)
+{
+    As<sim::Adapter>(Adapter)->Ieee8021q = *Capabilities;
+}
+
+BOOLEAN
+NetOffloadIsChecksumIPv4Enabled(NETOFFLOAD Offload)
+{
+    return As<sim::Offload>(Offload)->ChecksumIPv4;
+}
+
+BOOLEAN
+NetOffloadIsChecksumTcpEnabled(NETOFFLOAD Offload)
+{
+    return As<sim::Offload>(Offload)->ChecksumTcp;
+}
+
+BOOLEAN
+NetOffloadIsChecksumUdpEnabled(NETOFFLOAD Offload)
+{
+    return As<sim::Offload>(Offload)->ChecksumUdp;
+}
+
+BOOLEAN
+NetOffloadIsLsoIPv4Enabled(NETOFFLOAD Offload)
+{
+    return As<sim::Offload>(Offload)->LsoIPv4;
+}
+
+BOOLEAN
+NetOffloadIsLsoIPv6Enabled(NETOFFLOAD Offload)
+{
+    return As<sim::Offload>(Offload)->LsoIPv6;
+}
+
+// Configuration, the keywords come from the host
+
+NTSTATUS
+NetAdapterOpenConfiguration(NETADAPTER Adapter, WDF_OBJECT_ATTRIBUTES *ConfigurationAttributes, NETCONFIGURATION *Configuration)
+{
+    auto *configuration = new sim::Configuration();
+    Attach(configuration, ConfigurationAttributes, ToObject(Adapter));
+
+    *Configuration = ToHandle<NETCONFIGURATION>(configuration);
+    return STATUS_SUCCESS;
+}
+
+void
+NetConfigurationClose(NETCONFIGURATION Configuration)
+{
+    Delete(As<sim::Configuration>(Configuration));
+}
+
+NTSTATUS
+NetConfigurationQueryUlong(NETCONFIGURATION Configuration, ULONG Flags, PUNICODE_STRING ValueName, ULONG *Value)
+{
+    UNREFERENCED_PARAMETER(Configuration);
+    UNREFERENCED_PARAMETER(Flags);
+
+    auto const keyword = TheMachine.Keywords.find(
+        std::wstring(ValueName->Buffer, ValueName->Length / sizeof(WCHAR)));
+
+    if (keyword == TheMachine.Keywords.end())
+    {
+        return STATUS_NOT_FOUND;
+    }
+
+    *Value = keyword->second;
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+NetConfigurationQueryLinkLayerAddress(NETCONFIGURATION Configuration, NET_ADAPTER_LINK_LAYER_ADDRESS *LinkLayerAddress)
+{
+    UNREFERENCED_PARAMETER(Configuration);
+    UNREFERENCED_PARAMETER(LinkLayerAddress);
+
+    return STATUS_NOT_FOUND;
+}
+
+// Wake sources, the host never arms the device for wake
+
+void
+NetDeviceGetWakeSourceList(WDFDEVICE Device, NET_WAKE_SOURCE_LIST *List)
+{
+    UNREFERENCED_PARAMETER(Device);
+
+    NET_WAKE_SOURCE_LIST_INIT(List);
+}
+
+SIZE_T
+NetWakeSourceListGetCount(NET_WAKE_SOURCE_LIST const *List)
+{
+    UNREFERENCED_PARAMETER(List);
+
+    return 0;
+}
+
+NETWAKESOURCE
+NetWakeSourceListGetElement(NET_WAKE_SOURCE_LIST const *List, SIZE_T Index)
+{
+    UNREFERENCED_PARAMETER(List);
+    UNREFERENCED_PARAMETER(Index);
+
+    NT_ASSERT(! "the wake source list is empty");
+    return nullptr;
+}
+
+NET_WAKE_SOURCE_TYPE
+NetWakeSourceGetType(NETWAKESOURCE WakeSource)
+{
+    UNREFERENCED_PARAMETER(WakeSource);
+
+    NT_ASSERT(! "the wake source list is empty");
+    return NetWakeSourceTypeMagicPacket;
+}
+
+// Packet queues
+
+static UINT32
+RoundUpToPowerOfTwo(size_t count)
+{
+    UINT32 size = 1;
+    while (size < count)
+    {
+        size <<= 1;
+    }
+
+    return size;
+}
+
+static void
+InitializeRing(NET_RING *ring, UCHAR *buffer, UINT16 stride, UINT32 count)
+{
+    *ring = {};
+    ring->ElementStride = stride;
+    ring->NumberOfElements = count;
+    ring->ElementIndexMask = count - 1;
+    ring->Buffer = buffer;
+}
+
+static sim::Queue *
+CreateQueue(
+    sim::Adapter *adapter,
+    bool transmit,
+    ULONG queueId,
+    size_t elementsHint,
+    WDF_OBJECT_ATTRIBUTES *attributes,
+    NET_PACKET_QUEUE_CONFIG *configuration)
+{
+    UINT32 const count = RoundUpToPowerOfTwo(max(elementsHint, (size_t)2));
+
+    auto *queue = new sim::Queue();
+    Attach(queue, attributes, adapter);
+    queue->Transmit = transmit;
+    queue->QueueId = queueId;
+    queue->Config = *configuration;
+
+    queue->Packets.resize(count);
+    queue->Fragments.resize(count);
+    queue->Checksum.resize(count);
+    queue->Lso.resize(count);
+    queue->Ieee8021q.resize(count);
+    queue->VirtualAddress.resize(count);
+    queue->LogicalAddress.resize(count);
+
+    InitializeRing(&queue->PacketRing,
+        reinterpret_cast<UCHAR *>(queue->Packets.data()), sizeof(NET_PACKET), count);
+    InitializeRing(&queue->FragmentRing,
+        reinterpret_cast<UCHAR *>(queue->Fragments.data()), sizeof(NET_FRAGMENT), count);
+
+    queue->Rings.Rings[NetRingTypePacket] = &queue->PacketRing;
+    queue->Rings.Rings[NetRingTypeFragment] = &queue->FragmentRing;
+
+    return queue;
+}
+
+NTSTATUS
+NetTxQueueCreate(
+    NETTXQUEUE_INIT *NetTxQueueInit,
+    WDF_OBJECT_ATTRIBUTES *TxQueueAttributes,
+    NET_PACKET_QUEUE_CONFIG *Configuration,
+    NETPACKETQUEUE *TxQueue)
+{
+    sim::Adapter *adapter = NetTxQueueInit->Owner;
+
+    sim::Queue *queue = CreateQueue(
+        adapter,
+        true,
+        0,
+        adapter->Tx.FragmentRingNumberOfElementsHint,
+        TxQueueAttributes,
+        Configuration);
+
+    NetTxQueueInit->Created = queue;
+
+    *TxQueue = ToHandle<NETPACKETQUEUE>(queue);
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+NetRxQueueCreate(
+    NETRXQUEUE_INIT *NetRxQueueInit,
+    WDF_OBJECT_ATTRIBUTES *RxQueueAttributes,
+    NET_PACKET_QUEUE_CONFIG *Configuration,
+    NETPACKETQUEUE *RxQueue)
+{
+    sim::Adapter *adapter = NetRxQueueInit->Owner;
+
+    sim::Queue *queue = CreateQueue(
+        adapter,
+        false,
+        NetRxQueueInit->QueueId,
+        adapter->Rx.FragmentRingNumberOfElementsHint,
+        RxQueueAttributes,
+        Configuration);
+
+    NetRxQueueInit->Created = queue;
+
+    *RxQueue = ToHandle<NETPACKETQUEUE>(queue);
+    return STATUS_SUCCESS;
+}
+
+ULONG
+NetRxQueueInitGetQueueId(NETRXQUEUE_INIT *NetRxQueueInit)
+{
+    return NetRxQueueInit->QueueId;
+}
+
+NET_RING_COLLECTION const *
+NetTxQueueGetRingCollection(NETPACKETQUEUE NetTxQueue)
+{
+    return &As<sim::Queue>(NetTxQueue)->Rings;
+}
+
+NET_RING_COLLECTION const *
+NetRxQueueGetRingCollection(NETPACKETQUEUE NetRxQueue)
+{
+    return &As<sim::Queue>(NetRxQueue)->Rings;
+}
+
+template <typename T>
+static void
+SetExtension(NET_EXTENSION *extension, std::vector<T> &storage)
+{
+    extension->Base = reinterpret_cast<UCHAR *>(storage.data());
+    extension->Stride = sizeof(T);
+    extension->Enabled = TRUE;
+}
+
+// Every extension the driver asks for is enabled, as it would be with all
+// offloads turned on
+static void
+GetExtension(sim::Queue *queue, NET_EXTENSION_QUERY const *query, NET_EXTENSION *extension)
+{
+    *extension = {};
+
+    if (0 == wcscmp(query->Name, NET_PACKET_EXTENSION_CHECKSUM_NAME))
+    {
+        SetExtension(extension, queue->Checksum);
+    }
+    else if (0 == wcscmp(query->Name, NET_PACKET_EXTENSION_LSO_NAME))
+    {
+        SetExtension(extension, queue->Lso);
+    }
+    else if (0 == wcscmp(query->Name, NET_PACKET_EXTENSION_IEEE8021Q_NAME))
+    {
+        SetExtension(extension, queue->Ieee8021q);
+    }
+    else if (0 == wcscmp(query->Name, NET_FRAGMENT_EXTENSION_VIRTUAL_ADDRESS_NAME))
+    {
+        SetExtension(extension, queue->VirtualAddress);
+    }
+    else if (0 == wcscmp(query->Name, NET_FRAGMENT_EXTENSION_LOGICAL_ADDRESS_NAME))
+    {
+        SetExtension(extension, queue->LogicalAddress);
+    }
+}
+
+void
+NetTxQueueGetExtension(NETPACKETQUEUE NetTxQueue, NET_EXTENSION_QUERY const *Query, NET_EXTENSION *Extension)
+{
+    GetExtension(As<sim::Queue>(NetTxQueue), Query, Extension);
+}
+
+void
+NetRxQueueGetExtension(NETPACKETQUEUE NetRxQueue, NET_EXTENSION_QUERY const *Query, NET_EXTENSION *Extension)
+{
+    GetExtension(As<sim::Queue>(NetRxQueue), Query, Extension);
+}
+
+void
+NetTxQueueNotifyMoreCompletedPacketsAvailable(NETPACKETQUEUE TxQueue)
+{
+    As<sim::Queue>(TxQueue)->Notified = true;
+}
+
+void
+NetRxQueueNotifyMoreReceivedPacketsAvailable(NETPACKETQUEUE RxQueue)
+{
+    As<sim::Queue>(RxQueue)->Notified = true;
+}
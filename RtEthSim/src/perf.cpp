@@ -0,0 +1,54 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#include "sim/perf.h"
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace sim
+{
+
+CacheMissCounter::CacheMissCounter()
+{
+    perf_event_attr attr = {};
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    m_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+CacheMissCounter::~CacheMissCounter()
+{
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+    }
+}
+
+ULONG64
+CacheMissCounter::Read() const
+{
+    ULONG64 count = 0;
+
+    if (m_fd < 0 || read(m_fd, &count, sizeof(count)) != sizeof(count))
+    {
+        return 0;
+    }
+
+    return count;
+}
+
+}
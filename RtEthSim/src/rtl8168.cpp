@@ -0,0 +1,632 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#include "sim/rtl8168.h"
+
+#include "link.h"
+
+namespace sim
+{
+
+// RTL8168E, the TCR bits the driver reads the chip version from
+static ULONG const TcrVersionMask = 0x7cf00000;
+static ULONG const TcrVersion = 0x2c000000;
+
+// PhyAccessReg bit the driver never writes. The model leaves it set after
+// each PHY access, so the next command always reads as a change.
+static ULONG const PhyarIdle = BIT_30;
+
+static ULONG const EriWrite = 0x80000000;
+static UINT16 const EriRdsar[RT_NUMBER_OF_QUEUES] = { 0, 0xd0, 0xd8, 0xe0 };
+
+// In 100ns units
+static ULONG64 const ModerationTimerUnit = 100;
+
+// Guards against walking a descriptor ring that never hands anything back
+static UINT32 const MaxDescriptorWalk = 4096;
+
+static UINT64
+Address64(ULONG low, ULONG high)
+{
+    return ((UINT64)high << 32) | low;
+}
+
+Rtl8168::Rtl8168(Mmio &mmio, UCHAR const *macAddress, ULONG messageCount) :
+    m_mac(reinterpret_cast<RT_MAC *>(mmio.DeviceView())),
+    m_messageCount(messageCount)
+{
+    static_assert(sizeof(RT_MAC) <= Mmio::Size, "RT_MAC fits the window");
+
+    RtlCopyMemory(m_permanentAddress, macAddress, sizeof(m_permanentAddress));
+
+    m_phy[PHY_REG_BMCR] = MDI_CR_AUTO_SELECT | MDI_CR_FULL_HALF | MDI_CR_1000;
+    m_phy[PHY_REG_BMSR] = 0x7949 | PHY_REG_BMSR_AUTO_NEG_COMPLETE | BIT_2;
+    m_phy[PHY_REG_ANAR] = 0x01e1;
+    m_phy[PHY_REG_GBCR] = 0x0300;
+
+    Reset();
+
+    m_mac->TCR = TcrVersion;
+    m_mac->PhyAccessReg = PhyarIdle;
+    m_phyLeft = PhyarIdle;
+
+    SetLink(true);
+    m_mac->ISR0 = 0;
+    m_statusTimed[0] = 0;
+}
+
+void
+Rtl8168::Reset()
+{
+    RtlCopyMemory(m_mac->ID, m_permanentAddress, sizeof(m_permanentAddress));
+
+    m_mac->MulticastReg0 = m_mac->MulticastReg1 = m_mac->MulticastReg2 = m_mac->MulticastReg3 = 0;
+    m_mac->MulticastReg4 = m_mac->MulticastReg5 = m_mac->MulticastReg6 = m_mac->MulticastReg7 = 0;
+    RtlZeroMemory(m_mac->RssIndirectionTable, sizeof(m_mac->RssIndirectionTable));
+
+    m_mac->IMR0 = 0;
+    m_mac->IMR1 = m_mac->IMR2 = m_mac->IMR3 = 0;
+    m_mac->ISR0 = 0;
+    m_mac->ISR1 = m_mac->ISR2 = m_mac->ISR3 = 0;
+    RtlZeroMemory(m_statusTimed, sizeof(m_statusTimed));
+
+    m_mac->CmdReg = 0;
+    m_mac->TPPoll = 0;
+    m_cmdSeen = 0;
+
+    m_txIndex = 0;
+    RtlZeroMemory(m_rxIndex, sizeof(m_rxIndex));
+}
+
+void
+Rtl8168::Service()
+{
+    ServiceCommands();
+
+    Transmit();
+
+    for (ULONG queueId = 0; queueId < RT_NUMBER_OF_QUEUES; queueId++)
+    {
+        ReceiveQueue(queueId);
+    }
+
+    UpdateInterrupts();
+}
+
+void
+Rtl8168::ServiceCommands()
+{
+    if (m_mac->CmdReg & CR_RST)
+    {
+        Reset();
+    }
+
+    // Each engine starts over at the first descriptor when it is enabled,
+    // or when its ring moves
+    UCHAR const cmd = m_mac->CmdReg;
+    UCHAR const enabled = cmd & ~m_cmdSeen;
+    m_cmdSeen = cmd;
+
+    UINT64 const txRing = Address64(m_mac->TNPDSLow, m_mac->TNPDSHigh);
+    if ((enabled & CR_TE) || txRing != m_txRingSeen)
+    {
+        m_txIndex = 0;
+        m_txRingSeen = txRing;
+    }
+
+    UINT64 const rxRing = Address64(m_mac->RDSARLow, m_mac->RDSARHigh);
+    if (enabled & CR_RE)
+    {
+        RtlZeroMemory(m_rxIndex, sizeof(m_rxIndex));
+    }
+    if (rxRing != m_rxRingSeen)
+    {
+        m_rxIndex[0] = 0;
+        m_rxRingSeen = rxRing;
+    }
+
+    ServicePhy();
+    ServiceEri();
+
+    if (m_mac->DTCCRLow & DTCCR_Cmd)
+    {
+        DumpTally();
+        m_mac->DTCCRLow &= ~DTCCR_Cmd;
+    }
+
+    if (m_mac->TPPoll & TPPoll_NPQ)
+    {
+        m_mac->TPPoll &= ~TPPoll_NPQ;
+        TransmitPolls++;
+    }
+
+    m_mac->TCR = (m_mac->TCR & ~TcrVersionMask) | TcrVersion;
+}
+
+void
+Rtl8168::ServicePhy()
+{
+    ULONG const access = m_mac->PhyAccessReg;
+    if (access == m_phyLeft)
+    {
+        return;
+    }
+
+    UCHAR const reg = (access >> 16) & 0x1f;
+
+    if (access & PHYAR_Flag)
+    {
+        // The reset completes right away
+        m_phy[reg] = (reg == PHY_REG_BMCR)
+            ? (UINT16)(access & ~MDI_CR_RESET)
+            : (UINT16)access;
+
+        m_phyLeft = PhyarIdle | (access & ~PHYAR_Flag);
+    }
+    else
+    {
+        m_phyLeft = PhyarIdle | PHYAR_Flag | ((ULONG)reg << 16) | m_phy[reg];
+    }
+
+    m_mac->PhyAccessReg = m_phyLeft;
+}
+
+void
+Rtl8168::ServiceEri()
+{
+    ULONG const access = m_mac->ERIAccess;
+    if (0 == (access & EriWrite))
+    {
+        return;
+    }
+
+    UINT16 const address = access & 0xfff;
+    m_eri[address / 4] = m_mac->ERIData;
+
+    for (ULONG queueId = 1; queueId < RT_NUMBER_OF_QUEUES; queueId++)
+    {
+        if (address == EriRdsar[queueId] || address == EriRdsar[queueId] + 4)
+        {
+            m_rxIndex[queueId] = 0;
+        }
+    }
+
+    m_mac->ERIAccess = access & ~EriWrite;
+}
+
+void
+Rtl8168::DumpTally()
+{
+    UINT64 const address = Address64(m_mac->DTCCRLow & ~0x3fU, m_mac->DTCCRHigh);
+    if (address != 0)
+    {
+        RtlCopyMemory(reinterpret_cast<void *>(address), &m_tally, sizeof(m_tally));
+    }
+}
+
+void
+Rtl8168::Transmit()
+{
+    if (0 == (m_mac->CmdReg & CR_TE) || m_txRingSeen == 0)
+    {
+        return;
+    }
+
+    RT_TX_DESC *ring = reinterpret_cast<RT_TX_DESC *>(m_txRingSeen);
+
+    for (;;)
+    {
+        // Gather the frame from RXS_FS to RXS_LS, but only once the driver
+        // has handed over all of its descriptors
+        UINT32 index = m_txIndex;
+        UINT32 count = 0;
+        bool complete = false;
+
+        while (count < MaxDescriptorWalk)
+        {
+            RT_TX_DESC const *txd = &ring[index];
+            if (0 == (txd->TxDescDataIpv6Rss_All.status & TXS_OWN))
+            {
+                break;
+            }
+
+            count++;
+            index = (txd->TxDescDataIpv6Rss_All.status & TXS_EOR) ? 0 : index + 1;
+
+            if (txd->TxDescDataIpv6Rss_All.status & TXS_LS)
+            {
+                complete = true;
+                break;
+            }
+        }
+
+        if (! complete)
+        {
+            return;
+        }
+
+        TxFrame frame = {};
+        frame.DescriptorCount = (UINT16)count;
+        frame.Offload = ring[m_txIndex].TxDescDataIpv6Rss_All.OffloadGsoMssTagc;
+        frame.VlanTag = ring[m_txIndex].TxDescDataIpv6Rss_All.VLAN_TAG.Value;
+
+        size_t length = 0;
+        for (UINT32 i = 0; i < count; i++)
+        {
+            RT_TX_DESC *txd = &ring[m_txIndex];
+            UINT16 const status = txd->TxDescDataIpv6Rss_All.status;
+
+            if (CaptureTransmitted)
+            {
+                UCHAR const *buffer = reinterpret_cast<UCHAR const *>(txd->BufferAddress);
+                frame.Data.insert(frame.Data.end(), buffer, buffer + txd->TxDescDataIpv6Rss_All.length);
+            }
+            length += txd->TxDescDataIpv6Rss_All.length;
+
+            txd->TxDescDataIpv6Rss_All.status = status & ~TXS_OWN;
+            m_txIndex = (status & TXS_EOR) ? 0 : m_txIndex + 1;
+        }
+
+        TransmittedFrames++;
+        TransmittedBytes += length;
+        m_tally.TxOK++;
+
+        if (CaptureTransmitted)
+        {
+            Transmitted.push_back(std::move(frame));
+        }
+
+        RaiseStatus(0, ISRIMR_TOK);
+    }
+}
+
+void
+Rtl8168::Receive(ULONG queueId, RxFrame frame)
+{
+    NT_ASSERT(queueId < RT_NUMBER_OF_QUEUES);
+
+    if (m_rxFifo[queueId].size() >= RxFifoFrames)
+    {
+        MissedFrames++;
+        m_tally.MissPkt++;
+        RaiseStatus(0, ISRIMR_RX_FOVW);
+        return;
+    }
+
+    m_rxFifo[queueId].push_back(std::move(frame));
+}
+
+void
+Rtl8168::ReceiveQueue(ULONG queueId)
+{
+    std::deque<RxFrame> &fifo = m_rxFifo[queueId];
+
+    if (fifo.empty())
+    {
+        return;
+    }
+
+    UINT64 const ringAddress = (queueId == 0)
+        ? m_rxRingSeen
+        : Address64(Eri(EriRdsar[queueId]), Eri(EriRdsar[queueId] + 4));
+
+    // Frames arriving while the receiver is off never make it in
+    if (0 == (m_mac->CmdReg & CR_RE) || ringAddress == 0)
+    {
+        MissedFrames += fifo.size();
+        m_tally.MissPkt += (USHORT)fifo.size();
+        fifo.clear();
+        return;
+    }
+
+    RT_RX_DESC *ring = reinterpret_cast<RT_RX_DESC *>(ringAddress);
+
+    while (! fifo.empty())
+    {
+        if (! DeliverFrame(queueId, ring, fifo.front()))
+        {
+            RaiseStatus(queueId, queueId == 0 ? ISRIMR_RDU : ISR123_RDU);
+            return;
+        }
+
+        fifo.pop_front();
+    }
+}
+
+static size_t const CacheLineSize = 64;
+
+static void
+EvictLines(void const *address, size_t length)
+{
+    ULONG_PTR line = (ULONG_PTR)address & ~(CacheLineSize - 1);
+
+    for (; line < (ULONG_PTR)address + length; line += CacheLineSize)
+    {
+        __builtin_ia32_clflush(reinterpret_cast<void const *>(line));
+    }
+}
+
+bool
+Rtl8168::DeliverFrame(ULONG queueId, RT_RX_DESC *ring, RxFrame const &frame)
+{
+    size_t const length = frame.Data.size() + FRAME_CRC_SIZE;
+
+    // Find enough descriptors owned by the hardware to hold the frame
+    UINT32 index = m_rxIndex[queueId];
+    UINT32 count = 0;
+    size_t capacity = 0;
+
+    while (capacity < length)
+    {
+        RT_RX_DESC const *rxd = &ring[index];
+        if (0 == (rxd->RxDescDataIpv6Rss.status & RXS_OWN) || count == MaxDescriptorWalk)
+        {
+            return false;
+        }
+
+        capacity += rxd->RxDescDataIpv6Rss.length;
+        count++;
+        index = (rxd->RxDescDataIpv6Rss.status & RXS_EOR) ? 0 : index + 1;
+    }
+
+    UINT16 status = frame.Status;
+    if (ETH_IS_BROADCAST(frame.Data.data()))
+    {
+        status |= RXS_BAR;
+        m_tally.RxOKBrd++;
+    }
+    else if (ETH_IS_MULTICAST(frame.Data.data()))
+    {
+        status |= RXS_MAR;
+        m_tally.RxOKMul++;
+    }
+    else
+    {
+        m_tally.RxOKPhy++;
+    }
+
+    // The CRC follows the data, it is not checked by anything
+    UCHAR const crc[FRAME_CRC_SIZE] = {};
+    size_t copied = 0;
+
+    for (UINT32 i = 0; i < count; i++)
+    {
+        RT_RX_DESC *rxd = &ring[m_rxIndex[queueId]];
+        UCHAR *buffer = reinterpret_cast<UCHAR *>(rxd->BufferAddress);
+        size_t const chunk = min((size_t)rxd->RxDescDataIpv6Rss.length, length - copied);
+
+        for (size_t j = 0; j < chunk; j++, copied++)
+        {
+            buffer[j] = copied < frame.Data.size()
+                ? frame.Data[copied]
+                : crc[copied - frame.Data.size()];
+        }
+
+        UINT16 const eor = rxd->RxDescDataIpv6Rss.status & RXS_EOR;
+        UINT16 descriptorStatus = eor | (i == 0 ? RXS_FS : 0);
+
+        if (i + 1 == count)
+        {
+            descriptorStatus |= RXS_LS | status;
+            rxd->RxDescDataIpv6Rss.length = (unsigned short)length;
+            rxd->RxDescDataIpv6Rss.TcpUdpFailure = frame.TcpUdpFailure;
+            rxd->RxDescDataIpv6Rss.IpRssTava = frame.IpRssTava;
+            rxd->RxDescDataIpv6Rss.VLAN_TAG.Value = frame.VlanTag;
+        }
+
+        rxd->RxDescDataIpv6Rss.status = descriptorStatus;
+        m_rxIndex[queueId] = eor ? 0 : m_rxIndex[queueId] + 1;
+
+        if (EvictReceivedLines)
+        {
+            EvictLines(buffer, chunk);
+            EvictLines(rxd, sizeof(*rxd));
+        }
+    }
+
+    ReceivedFrames++;
+    m_tally.RxOK++;
+
+    RaiseStatus(queueId, queueId == 0 ? ISRIMR_ROK : ISR123_ROK);
+
+    return true;
+}
+
+void
+Rtl8168::SetLink(bool up)
+{
+    m_mac->PhyStatus = up
+        ? (PHY_STATUS_CABLE_PLUG | PHY_STATUS_1000MF | PHY_STATUS_LINK_ON | PHY_STATUS_FULL_DUPLEX)
+        : 0;
+
+    RaiseStatus(0, ISRIMR_LINK_CHG);
+}
+
+UINT16
+Rtl8168::InterruptStatus(ULONG queueId) const
+{
+    switch (queueId)
+    {
+    case 0: return m_mac->ISR0;
+    case 1: return m_mac->ISR1;
+    case 2: return m_mac->ISR2;
+    default: return m_mac->ISR3;
+    }
+}
+
+void
+Rtl8168::SetInterruptStatus(ULONG queueId, UINT16 value)
+{
+    switch (queueId)
+    {
+    case 0: m_mac->ISR0 = value; break;
+    case 1: m_mac->ISR1 = (UINT8)value; break;
+    case 2: m_mac->ISR2 = (UINT8)value; break;
+    default: m_mac->ISR3 = (UINT8)value; break;
+    }
+}
+
+UINT16
+Rtl8168::InterruptMask(ULONG queueId) const
+{
+    switch (queueId)
+    {
+    case 0: return m_mac->IMR0;
+    case 1: return m_mac->IMR1;
+    case 2: return m_mac->IMR2;
+    default: return m_mac->IMR3;
+    }
+}
+
+void
+Rtl8168::RaiseStatus(ULONG queueId, UINT16 bits)
+{
+    ULONG64 const now = KeQueryInterruptTime();
+    UINT16 const status = InterruptStatus(queueId);
+
+    for (UINT16 bit = 0; bit < 16; bit++)
+    {
+        UINT16 const mask = (UINT16)(1 << bit);
+        if ((bits & mask) && ! (status & mask))
+        {
+            m_statusTime[queueId][bit] = now;
+            m_statusTimed[queueId] |= mask;
+        }
+    }
+
+    SetInterruptStatus(queueId, status | bits);
+}
+
+void
+Rtl8168::ClearInterruptStatus(ULONG queueId)
+{
+    SetInterruptStatus(queueId, 0);
+    m_statusTimed[queueId] = 0;
+}
+
+ULONG64
+Rtl8168::ModerationDelay(UINT16 bit, ULONG queueId) const
+{
+    if (bit == 0)
+    {
+        // ISRIMR_ROK and ISR123_ROK
+        return m_mac->IntMiti.RxTimerNum * ModerationTimerUnit;
+    }
+
+    if (queueId == 0 && (1 << bit) == ISRIMR_TOK)
+    {
+        return m_mac->IntMiti.TxTimerNum * ModerationTimerUnit;
+    }
+
+    return 0;
+}
+
+// Latched status that is enabled and has waited out its moderation timer
+UINT16
+Rtl8168::ModeratedStatus(ULONG queueId) const
+{
+    ULONG64 const now = KeQueryInterruptTime();
+    UINT16 const pending = InterruptStatus(queueId) & InterruptMask(queueId);
+    UINT16 due = 0;
+
+    for (UINT16 bit = 0; bit < 16; bit++)
+    {
+        UINT16 const mask = (UINT16)(1 << bit);
+        if ((pending & mask) &&
+            m_statusTime[queueId][bit] + ModerationDelay(bit, queueId) <= now)
+        {
+            due |= mask;
+        }
+    }
+
+    return due;
+}
+
+void
+Rtl8168::UpdateInterrupts()
+{
+    ULONG64 const now = KeQueryInterruptTime();
+
+    // Status the driver cleared no longer has a time
+    for (ULONG queueId = 0; queueId < RT_NUMBER_OF_QUEUES; queueId++)
+    {
+        m_statusTimed[queueId] &= InterruptStatus(queueId);
+    }
+
+    bool level[RT_NUMBER_OF_QUEUES] = {};
+    ULONG64 oldest[RT_NUMBER_OF_QUEUES];
+
+    for (ULONG queueId = 0; queueId < RT_NUMBER_OF_QUEUES; queueId++)
+    {
+        ULONG const message = queueId & (m_messageCount - 1);
+        UINT16 const due = ModeratedStatus(queueId);
+
+        if (message == queueId)
+        {
+            oldest[message] = now;
+        }
+
+        for (UINT16 bit = 0; bit < 16; bit++)
+        {
+            if (due & (1 << bit))
+            {
+                level[message] = true;
+                oldest[message] = min(oldest[message], m_statusTime[queueId][bit]);
+            }
+        }
+    }
+
+    for (ULONG message = 0; message < m_messageCount && message < RT_NUMBER_OF_QUEUES; message++)
+    {
+        if (level[message] && ! m_messageLevel[message])
+        {
+            m_raised |= 1 << message;
+
+            if (RecordInterrupts)
+            {
+                Interrupts.push_back({ now, message, now - oldest[message] });
+            }
+        }
+
+        m_messageLevel[message] = level[message];
+    }
+}
+
+ULONG64
+Rtl8168::NextEventTime() const
+{
+    ULONG64 next = ~0ULL;
+
+    for (ULONG queueId = 0; queueId < RT_NUMBER_OF_QUEUES; queueId++)
+    {
+        UINT16 const pending = InterruptStatus(queueId) & InterruptMask(queueId);
+
+        for (UINT16 bit = 0; bit < 16; bit++)
+        {
+            if (pending & (1 << bit))
+            {
+                next = min(next, m_statusTime[queueId][bit] + ModerationDelay(bit, queueId));
+            }
+        }
+    }
+
+    return next;
+}
+
+ULONG
+Rtl8168::TakeRaisedMessages()
+{
+    ULONG const raised = m_raised;
+    m_raised = 0;
+    return raised;
+}
+
+}
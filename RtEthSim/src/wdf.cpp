@@ -0,0 +1,579 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#include "internal.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace sim
+{
+
+static size_t const ContextAlignment = 64;
+static size_t const PageSize = 4096;
+
+static void *
+AllocateZeroed(size_t alignment, size_t size)
+{
+    size = (max(size, (size_t)1) + alignment - 1) & ~(alignment - 1);
+
+    void *buffer = aligned_alloc(alignment, size);
+    if (buffer != nullptr)
+    {
+        memset(buffer, 0, size);
+    }
+
+    return buffer;
+}
+
+template <typename T>
+static void
+Forget(std::vector<T *> &list, Object *object)
+{
+    list.erase(std::remove(list.begin(), list.end(), object), list.end());
+}
+
+void
+Attach(Object *object, WDF_OBJECT_ATTRIBUTES const *attributes, Object *defaultParent)
+{
+    object->Parent = defaultParent;
+
+    if (attributes != nullptr)
+    {
+        if (attributes->ParentObject != nullptr)
+        {
+            object->Parent = ToObject(attributes->ParentObject);
+        }
+
+        if (attributes->ContextTypeInfo != nullptr)
+        {
+            object->ContextType = attributes->ContextTypeInfo;
+            object->Context = AllocateZeroed(ContextAlignment,
+                attributes->ContextSizeOverride != 0
+                    ? attributes->ContextSizeOverride
+                    : attributes->ContextTypeInfo->ContextSize);
+            NT_ASSERT(object->Context != nullptr);
+        }
+
+        object->EvtCleanup = attributes->EvtCleanupCallback;
+        object->EvtDestroy = attributes->EvtDestroyCallback;
+    }
+
+    if (object->Parent != nullptr)
+    {
+        object->Parent->Children.push_back(object);
+    }
+}
+
+void
+Delete(Object *object)
+{
+    // Children go first, the most recently created one first
+    while (! object->Children.empty())
+    {
+        Delete(object->Children.back());
+    }
+
+    WDFOBJECT const handle = ToHandle<WDFOBJECT>(object);
+
+    if (object->EvtCleanup != nullptr)
+    {
+        object->EvtCleanup(handle);
+    }
+
+    if (object->EvtDestroy != nullptr)
+    {
+        object->EvtDestroy(handle);
+    }
+
+    if (object->Parent != nullptr)
+    {
+        Forget(object->Parent->Children, object);
+    }
+
+    Forget(TheMachine.Interrupts, object);
+    Forget(TheMachine.Timers, object);
+    Forget(TheMachine.WorkItems, object);
+
+    if (TheMachine.TheDriver == object)
+    {
+        TheMachine.TheDriver = nullptr;
+    }
+
+    free(object->Context);
+    delete object;
+}
+
+Memory::~Memory()
+{
+    free(Buffer);
+}
+
+CommonBuffer::~CommonBuffer()
+{
+    free(Allocation);
+}
+
+}
+
+using namespace sim;
+
+// Objects and contexts
+
+void *
+WdfObjectGetTypedContextWorker(WDFOBJECT Handle, WDF_OBJECT_CONTEXT_TYPE_INFO const *TypeInfo)
+{
+    Object *object = ToObject(Handle);
+
+    NT_ASSERT(object->ContextType == TypeInfo);
+    return object->Context;
+}
+
+void
+WdfObjectDelete(WDFOBJECT Object)
+{
+    Delete(ToObject(Object));
+}
+
+// Driver
+
+NTSTATUS
+WdfDriverCreate(
+    PDRIVER_OBJECT DriverObject,
+    PUNICODE_STRING RegistryPath,
+    WDF_OBJECT_ATTRIBUTES *DriverAttributes,
+    WDF_DRIVER_CONFIG *DriverConfig,
+    WDFDRIVER *Driver)
+{
+    UNREFERENCED_PARAMETER(DriverObject);
+    UNREFERENCED_PARAMETER(RegistryPath);
+
+    NT_ASSERT(TheMachine.TheDriver == nullptr);
+
+    auto *driver = new sim::Driver();
+    Attach(driver, DriverAttributes, nullptr);
+    driver->Config = *DriverConfig;
+
+    TheMachine.TheDriver = driver;
+
+    if (Driver != nullptr)
+    {
+        *Driver = ToHandle<WDFDRIVER>(driver);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+// Device
+
+void
+WdfDeviceInitSetPnpPowerEventCallbacks(PWDFDEVICE_INIT DeviceInit, WDF_PNPPOWER_EVENT_CALLBACKS *Callbacks)
+{
+    DeviceInit->PnpPower = *Callbacks;
+}
+
+void
+WdfDeviceInitSetPowerPolicyEventCallbacks(PWDFDEVICE_INIT DeviceInit, WDF_POWER_POLICY_EVENT_CALLBACKS *Callbacks)
+{
+    DeviceInit->PowerPolicy = *Callbacks;
+}
+
+NTSTATUS
+WdfDeviceCreate(PWDFDEVICE_INIT *DeviceInit, WDF_OBJECT_ATTRIBUTES *DeviceAttributes, WDFDEVICE *Device)
+{
+    // NetAdapterCx has to have seen the init first
+    NT_ASSERT((*DeviceInit)->NetConfigured);
+
+    auto *device = new sim::Device();
+    Attach(device, DeviceAttributes, TheMachine.TheDriver);
+    device->PnpPower = (*DeviceInit)->PnpPower;
+    device->PowerPolicy = (*DeviceInit)->PowerPolicy;
+
+    *DeviceInit = nullptr;
+    *Device = ToHandle<WDFDEVICE>(device);
+
+    return STATUS_SUCCESS;
+}
+
+void
+WdfDeviceSetAlignmentRequirement(WDFDEVICE Device, ULONG AlignmentRequirement)
+{
+    UNREFERENCED_PARAMETER(Device);
+
+    // Common buffers are page aligned regardless
+    NT_ASSERT(AlignmentRequirement < PageSize);
+}
+
+void
+WdfDeviceSetFailed(WDFDEVICE Device, WDF_DEVICE_FAILED_ACTION FailedAction)
+{
+    UNREFERENCED_PARAMETER(FailedAction);
+
+    As<sim::Device>(Device)->Failed = true;
+}
+
+NTSTATUS
+WdfDeviceAssignS0IdleSettings(WDFDEVICE Device, WDF_DEVICE_POWER_POLICY_IDLE_SETTINGS *Settings)
+{
+    UNREFERENCED_PARAMETER(Device);
+    UNREFERENCED_PARAMETER(Settings);
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfDeviceAssignSxWakeSettings(WDFDEVICE Device, WDF_DEVICE_POWER_POLICY_WAKE_SETTINGS *Settings)
+{
+    UNREFERENCED_PARAMETER(Device);
+    UNREFERENCED_PARAMETER(Settings);
+
+    return STATUS_SUCCESS;
+}
+
+// Resources
+
+ULONG
+WdfCmResourceListGetCount(WDFCMRESLIST List)
+{
+    return (ULONG)As<ResourceList>(List)->Descriptors.size();
+}
+
+PCM_PARTIAL_RESOURCE_DESCRIPTOR
+WdfCmResourceListGetDescriptor(WDFCMRESLIST List, ULONG Index)
+{
+    auto &descriptors = As<ResourceList>(List)->Descriptors;
+
+    return Index < descriptors.size() ? &descriptors[Index] : nullptr;
+}
+
+// Interrupts
+
+NTSTATUS
+WdfInterruptCreate(
+    WDFDEVICE Device,
+    WDF_INTERRUPT_CONFIG *Configuration,
+    WDF_OBJECT_ATTRIBUTES *Attributes,
+    WDFINTERRUPT *Interrupt)
+{
+    ResourceList const *resources = TheMachine.RawResources;
+    NT_ASSERT(resources != nullptr);
+
+    ULONG messageId = 0;
+    bool found = false;
+
+    for (auto const &descriptor : resources->Descriptors)
+    {
+        if (&descriptor == Configuration->InterruptRaw)
+        {
+            found = true;
+            break;
+        }
+
+        if (descriptor.Type == CmResourceTypeInterrupt)
+        {
+            messageId++;
+        }
+    }
+
+    if (! found)
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    auto *interrupt = new sim::Interrupt();
+    Attach(interrupt, Attributes, ToObject(Device));
+    interrupt->Config = *Configuration;
+    interrupt->AssociatedDevice = As<sim::Device>(Device);
+    interrupt->MessageId = messageId;
+
+    TheMachine.Interrupts.push_back(interrupt);
+
+    *Interrupt = ToHandle<WDFINTERRUPT>(interrupt);
+    return STATUS_SUCCESS;
+}
+
+BOOLEAN
+WdfInterruptQueueDpcForIsr(WDFINTERRUPT Interrupt)
+{
+    auto *interrupt = As<sim::Interrupt>(Interrupt);
+
+    if (interrupt->DpcQueued)
+    {
+        return FALSE;
+    }
+
+    interrupt->DpcQueued = true;
+    return TRUE;
+}
+
+// The host runs one thing at a time, so nothing needs locking
+
+void
+WdfInterruptAcquireLock(WDFINTERRUPT Interrupt)
+{
+    UNREFERENCED_PARAMETER(Interrupt);
+}
+
+void
+WdfInterruptReleaseLock(WDFINTERRUPT Interrupt)
+{
+    UNREFERENCED_PARAMETER(Interrupt);
+}
+
+// Locks
+
+NTSTATUS
+WdfSpinLockCreate(WDF_OBJECT_ATTRIBUTES *SpinLockAttributes, WDFSPINLOCK *SpinLock)
+{
+    auto *lock = new sim::Lock();
+    Attach(lock, SpinLockAttributes, TheMachine.TheDriver);
+
+    *SpinLock = ToHandle<WDFSPINLOCK>(lock);
+    return STATUS_SUCCESS;
+}
+
+void
+WdfSpinLockAcquire(WDFSPINLOCK SpinLock)
+{
+    UNREFERENCED_PARAMETER(SpinLock);
+}
+
+void
+WdfSpinLockRelease(WDFSPINLOCK SpinLock)
+{
+    UNREFERENCED_PARAMETER(SpinLock);
+}
+
+NTSTATUS
+WdfWaitLockCreate(WDF_OBJECT_ATTRIBUTES *LockAttributes, WDFWAITLOCK *Lock)
+{
+    auto *lock = new sim::Lock();
+    Attach(lock, LockAttributes, TheMachine.TheDriver);
+
+    *Lock = ToHandle<WDFWAITLOCK>(lock);
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfWaitLockAcquire(WDFWAITLOCK Lock, LONGLONG *Timeout)
+{
+    UNREFERENCED_PARAMETER(Lock);
+    UNREFERENCED_PARAMETER(Timeout);
+
+    return STATUS_SUCCESS;
+}
+
+void
+WdfWaitLockRelease(WDFWAITLOCK Lock)
+{
+    UNREFERENCED_PARAMETER(Lock);
+}
+
+// Timers
+
+NTSTATUS
+WdfTimerCreate(WDF_TIMER_CONFIG *Config, WDF_OBJECT_ATTRIBUTES *Attributes, WDFTIMER *Timer)
+{
+    // A timer has to be given a parent
+    if (Attributes == nullptr || Attributes->ParentObject == nullptr)
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    auto *timer = new sim::Timer();
+    Attach(timer, Attributes, nullptr);
+    timer->Config = *Config;
+
+    TheMachine.Timers.push_back(timer);
+
+    *Timer = ToHandle<WDFTIMER>(timer);
+    return STATUS_SUCCESS;
+}
+
+BOOLEAN
+WdfTimerStart(WDFTIMER Timer, LONGLONG DueTime)
+{
+    auto *timer = As<sim::Timer>(Timer);
+    BOOLEAN const wasRunning = timer->Running;
+
+    // Negative due times are relative, in 100ns units like the clock
+    timer->Due = DueTime < 0 ? TheMachine.Now + (ULONG64)-DueTime : (ULONG64)DueTime;
+    timer->Running = true;
+
+    return wasRunning;
+}
+
+BOOLEAN
+WdfTimerStop(WDFTIMER Timer, BOOLEAN Wait)
+{
+    UNREFERENCED_PARAMETER(Wait);
+
+    auto *timer = As<sim::Timer>(Timer);
+    BOOLEAN const wasRunning = timer->Running;
+
+    timer->Running = false;
+
+    return wasRunning;
+}
+
+WDFOBJECT
+WdfTimerGetParentObject(WDFTIMER Timer)
+{
+    return ToHandle<WDFOBJECT>(As<sim::Timer>(Timer)->Parent);
+}
+
+// Work items
+
+NTSTATUS
+WdfWorkItemCreate(WDF_WORKITEM_CONFIG *Config, WDF_OBJECT_ATTRIBUTES *Attributes, WDFWORKITEM *WorkItem)
+{
+    if (Attributes == nullptr || Attributes->ParentObject == nullptr)
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    auto *workItem = new sim::WorkItem();
+    Attach(workItem, Attributes, nullptr);
+    workItem->Config = *Config;
+
+    TheMachine.WorkItems.push_back(workItem);
+
+    *WorkItem = ToHandle<WDFWORKITEM>(workItem);
+    return STATUS_SUCCESS;
+}
+
+void
+WdfWorkItemEnqueue(WDFWORKITEM WorkItem)
+{
+    As<sim::WorkItem>(WorkItem)->Enqueued = true;
+}
+
+void
+WdfWorkItemFlush(WDFWORKITEM WorkItem)
+{
+    auto *workItem = As<sim::WorkItem>(WorkItem);
+
+    if (workItem->Enqueued)
+    {
+        workItem->Enqueued = false;
+        workItem->Config.EvtWorkItemFunc(WorkItem);
+    }
+}
+
+WDFOBJECT
+WdfWorkItemGetParentObject(WDFWORKITEM WorkItem)
+{
+    return ToHandle<WDFOBJECT>(As<sim::WorkItem>(WorkItem)->Parent);
+}
+
+// Memory
+
+NTSTATUS
+WdfMemoryCreate(
+    WDF_OBJECT_ATTRIBUTES *Attributes,
+    POOL_TYPE PoolType,
+    ULONG PoolTag,
+    size_t BufferSize,
+    WDFMEMORY *Memory,
+    PVOID *Buffer)
+{
+    UNREFERENCED_PARAMETER(PoolType);
+    UNREFERENCED_PARAMETER(PoolTag);
+
+    void *buffer = AllocateZeroed(ContextAlignment, BufferSize);
+    if (buffer == nullptr)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    auto *memory = new sim::Memory();
+    memory->Buffer = buffer;
+    Attach(memory, Attributes, TheMachine.TheDriver);
+
+    *Memory = ToHandle<WDFMEMORY>(memory);
+
+    if (Buffer != nullptr)
+    {
+        *Buffer = buffer;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+// DMA
+
+NTSTATUS
+WdfDmaEnablerCreate(
+    WDFDEVICE Device,
+    WDF_DMA_ENABLER_CONFIG *Config,
+    WDF_OBJECT_ATTRIBUTES *Attributes,
+    WDFDMAENABLER *DmaEnablerHandle)
+{
+    UNREFERENCED_PARAMETER(Config);
+
+    auto *enabler = new sim::DmaEnabler();
+    Attach(enabler, Attributes, ToObject(Device));
+
+    *DmaEnablerHandle = ToHandle<WDFDMAENABLER>(enabler);
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfCommonBufferCreateWithConfig(
+    WDFDMAENABLER DmaEnabler,
+    size_t Length,
+    WDF_COMMON_BUFFER_CONFIG *Config,
+    WDF_OBJECT_ATTRIBUTES *Attributes,
+    WDFCOMMONBUFFER *CommonBuffer)
+{
+    if (Config != nullptr && Config->AlignmentRequirement >= PageSize)
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    void *allocation = AllocateZeroed(PageSize, Length);
+    if (allocation == nullptr)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    auto *buffer = new sim::CommonBuffer();
+    buffer->Allocation = allocation;
+    buffer->Aligned = static_cast<UCHAR *>(allocation);
+    Attach(buffer, Attributes, As<sim::DmaEnabler>(DmaEnabler));
+
+    *CommonBuffer = ToHandle<WDFCOMMONBUFFER>(buffer);
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfCommonBufferCreate(
+    WDFDMAENABLER DmaEnabler,
+    size_t Length,
+    WDF_OBJECT_ATTRIBUTES *Attributes,
+    WDFCOMMONBUFFER *CommonBuffer)
+{
+    return WdfCommonBufferCreateWithConfig(DmaEnabler, Length, nullptr, Attributes, CommonBuffer);
+}
+
+PVOID
+WdfCommonBufferGetAlignedVirtualAddress(WDFCOMMONBUFFER CommonBuffer)
+{
+    return As<sim::CommonBuffer>(CommonBuffer)->Aligned;
+}
+
+PHYSICAL_ADDRESS
+WdfCommonBufferGetAlignedLogicalAddress(WDFCOMMONBUFFER CommonBuffer)
+{
+    PHYSICAL_ADDRESS address;
+    address.QuadPart = (LONGLONG)(ULONG_PTR)As<sim::CommonBuffer>(CommonBuffer)->Aligned;
+    return address;
+}
@@ -0,0 +1,53 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#pragma once
+
+// Just enough of a test framework for the harness tests: CHECK records a
+// failure and carries on, the test's main returns CheckResult().
+
+#include <cstdio>
+
+namespace check
+{
+inline int Failures = 0;
+}
+
+#define CHECK(Expression) \
+    ((Expression) ? (void)0 : \
+        (fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #Expression), \
+         (void)check::Failures++))
+
+#define CHECK_EQ(Actual, Expected) \
+    do { \
+        auto const actual_ = (Actual); \
+        auto const expected_ = (Expected); \
+        if (! (actual_ == expected_)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s == %s (%llu != %llu)\n", \
+                __FILE__, __LINE__, #Actual, #Expected, \
+                (unsigned long long)actual_, (unsigned long long)expected_); \
+            check::Failures++; \
+        } \
+    } while (0)
+
+inline int
+CheckResult(char const *name)
+{
+    if (check::Failures != 0)
+    {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, check::Failures);
+        return 1;
+    }
+
+    printf("%s: passed\n", name);
+    return 0;
+}
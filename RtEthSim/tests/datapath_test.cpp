@@ -0,0 +1,212 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+// Brings the driver up on the host and moves frames through both rings,
+// with and without trapped registers and with one or four messages.
+
+#include "sim/host.h"
+
+#include "check.h"
+
+using namespace sim;
+
+static std::vector<UCHAR>
+MakeFrame(UCHAR const *destination, size_t length, UINT32 seed)
+{
+    std::vector<UCHAR> frame(length);
+    memcpy(frame.data(), destination, ETH_LENGTH_OF_ADDRESS);
+
+    UCHAR const source[ETH_LENGTH_OF_ADDRESS] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+    memcpy(frame.data() + ETH_LENGTH_OF_ADDRESS, source, ETH_LENGTH_OF_ADDRESS);
+    frame[12] = 0x08;
+    frame[13] = 0x00;
+
+    for (size_t i = ETH_LENGTH_OF_HEADER; i < length; i++)
+    {
+        frame[i] = (UCHAR)(seed * 31 + i);
+    }
+
+    return frame;
+}
+
+static TxPacket
+MakeTxPacket(std::vector<UCHAR> data, UINT16 fragmentCount)
+{
+    TxPacket packet;
+    packet.Data = std::move(data);
+    packet.FragmentCount = fragmentCount;
+    packet.Layout.Layer2Type = NetPacketLayer2TypeEthernet;
+    packet.Layout.Layer2HeaderLength = ETH_LENGTH_OF_HEADER;
+    return packet;
+}
+
+static void
+TestBringUp()
+{
+    HostConfig config;
+    Host host(config);
+
+    RT_ADAPTER const *adapter = host.Adapter();
+    CHECK(adapter->CSRAddress != nullptr);
+    CHECK_EQ(host.RxQueueCount(), 1u);
+    CHECK(0 == memcmp(adapter->PermanentAddress.Address, config.MacAddress, ETH_LENGTH_OF_ADDRESS));
+
+    // Transmit and receive are on, the link change from power up is handled
+    CHECK((host.Device().Registers()->CmdReg & (CR_TE | CR_RE)) == (CR_TE | CR_RE));
+    CHECK(host.RunUntilIdle());
+    CHECK(adapter->LinkSpeed != 0);
+}
+
+static void
+TestTransmit(HostConfig const &config)
+{
+    Host host(config);
+    CHECK(host.RunUntilIdle());
+
+    UCHAR const peer[ETH_LENGTH_OF_ADDRESS] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    std::vector<std::vector<UCHAR>> sent;
+
+    // Sizes either side of the bounce buffer, fragment counts up to the most
+    // the driver takes
+    size_t const sizes[] = { 60, 64, 128, 200, 256, 600, 1514 };
+    UINT32 seed = 0;
+
+    for (int round = 0; round < 20; round++)
+    {
+        for (size_t size : sizes)
+        {
+            UINT16 const fragments = (UINT16)(1 + (seed % RT_MAX_PHYS_BUF_COUNT));
+            std::vector<UCHAR> frame = MakeFrame(peer, size, seed++);
+
+            while (! host.Send(MakeTxPacket(frame, min(fragments, (UINT16)size))))
+            {
+                host.Step();
+            }
+
+            sent.push_back(std::move(frame));
+        }
+
+        host.Run(50 * 10);
+    }
+
+    CHECK(host.RunUntilIdle());
+    CHECK_EQ(host.TxOutstanding(), 0u);
+    CHECK_EQ(host.Counters.TxPacketsCompleted, sent.size());
+
+    std::vector<TxFrame> const &transmitted = host.Device().Transmitted;
+    CHECK_EQ(transmitted.size(), sent.size());
+
+    for (size_t i = 0; i < min(sent.size(), transmitted.size()); i++)
+    {
+        CHECK(transmitted[i].Data == sent[i]);
+    }
+}
+
+static void
+TestReceive(HostConfig const &config)
+{
+    Host host(config);
+    CHECK(host.RunUntilIdle());
+
+    UCHAR const *station = config.MacAddress;
+    UCHAR const broadcast[ETH_LENGTH_OF_ADDRESS] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+    std::vector<std::vector<UCHAR>> expected[RT_NUMBER_OF_QUEUES];
+    size_t const sizes[] = { 60, 61, 128, 512, 1000, 1514 };
+    ULONG const queueCount = (ULONG)host.RxQueueCount();
+    UINT32 seed = 0;
+
+    // More frames than the ring holds, delivered in bursts
+    for (int burst = 0; burst < 40; burst++)
+    {
+        for (size_t size : sizes)
+        {
+            ULONG const queueId = seed % queueCount;
+            std::vector<UCHAR> frame = MakeFrame(seed % 7 == 0 ? broadcast : station, size, seed);
+            seed++;
+
+            RxFrame rx;
+            rx.Data = frame;
+            host.Receive(std::move(rx), queueId);
+            expected[queueId].push_back(std::move(frame));
+        }
+
+        host.Run(100 * 10);
+    }
+
+    CHECK(host.RunUntilIdle());
+    CHECK_EQ(host.Device().MissedFrames, 0u);
+
+    std::vector<RxPacket> const received = host.TakeReceived();
+    CHECK_EQ(received.size(), (size_t)seed);
+
+    size_t next[RT_NUMBER_OF_QUEUES] = {};
+    for (RxPacket const &packet : received)
+    {
+        CHECK(packet.QueueId < queueCount);
+        if (packet.QueueId >= queueCount || next[packet.QueueId] >= expected[packet.QueueId].size())
+        {
+            continue;
+        }
+
+        // In order within a queue, without the CRC
+        CHECK(packet.Data == expected[packet.QueueId][next[packet.QueueId]]);
+        CHECK_EQ(packet.FragmentCount, 1u);
+        next[packet.QueueId]++;
+    }
+}
+
+static void
+TestTrappedRegisters()
+{
+    HostConfig config;
+    config.TrapMmio = true;
+
+    TestTransmit(config);
+    TestReceive(config);
+
+    // The trap sees what the driver does to the registers
+    Host host(config);
+    CHECK(host.RunUntilIdle());
+
+    RxFrame rx;
+    rx.Data = MakeFrame(config.MacAddress, 60, 0);
+    host.Receive(std::move(rx));
+    CHECK(host.RunUntilIdle());
+    CHECK_EQ(host.TakeReceived().size(), 1u);
+
+    CHECK(host.Registers().Writes(FIELD_OFFSET(RT_MAC, CmdReg)) > 0);
+    CHECK(host.Registers().Reads(FIELD_OFFSET(RT_MAC, ISR0), 2) > 0);
+}
+
+int
+main()
+{
+    TestBringUp();
+
+    HostConfig config;
+    TestTransmit(config);
+    TestReceive(config);
+
+    HostConfig perQueue;
+    perQueue.MessageCount = 4;
+    perQueue.Keywords[L"*RSS"] = 1;
+    TestReceive(perQueue);
+
+    HostConfig shared;
+    shared.MessageCount = 2;
+    shared.Keywords[L"*RSS"] = 1;
+    TestReceive(shared);
+
+    TestTrappedRegisters();
+
+    return CheckResult("datapath_test");
+}
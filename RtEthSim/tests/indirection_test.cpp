@@ -0,0 +1,200 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+// Register writes the driver makes to the RSS indirection table for
+// typical rebalance patterns, counted through the trapped register
+// window, against the RT_INDIRECTION_TABLE_SIZE dwords a full rewrite
+// costs per call.
+
+#include "sim/host.h"
+
+#include "check.h"
+
+using namespace sim;
+
+static UINT32 const TableEntries = 128;
+
+// What the hardware table should hold: bit 0 of each entry's queue in the
+// first half of the dwords, bit 1 in the second
+static std::vector<UINT32>
+ExpectedTable(std::vector<ULONG> const &queues)
+{
+    std::vector<UINT32> table(RT_INDIRECTION_TABLE_SIZE);
+
+    for (UINT32 index = 0; index < queues.size(); index++)
+    {
+        UINT32 const bit = 1u << (index & 0x1f);
+
+        if (queues[index] & 1)
+        {
+            table[index >> 5] |= bit;
+        }
+
+        if (queues[index] & 2)
+        {
+            table[(index >> 5) + RT_INDIRECTION_TABLE_SIZE / 2] |= bit;
+        }
+    }
+
+    return table;
+}
+
+static std::vector<UINT32>
+HardwareTable(Host &host)
+{
+    RT_MAC const *mac = host.Device().Registers();
+    return std::vector<UINT32>(mac->RssIndirectionTable, mac->RssIndirectionTable + RT_INDIRECTION_TABLE_SIZE);
+}
+
+struct Pattern
+{
+    char const *Name;
+    // Each call's entries, handed to the driver back to back
+    std::vector<std::vector<IndirectionEntry>> Calls;
+    ULONG64 ExpectedWrites;
+};
+
+// Applies a pattern, lets the ERI work item write the table, and returns
+// the table writes it made
+static ULONG64
+Apply(Host &host, std::vector<ULONG> &queues, Pattern const &pattern)
+{
+    host.Registers().ResetCounts();
+
+    for (std::vector<IndirectionEntry> const &call : pattern.Calls)
+    {
+        CHECK(NT_SUCCESS(host.SetIndirectionEntries(call)));
+
+        for (IndirectionEntry const &entry : call)
+        {
+            queues[entry.Index] = entry.QueueId;
+        }
+    }
+
+    CHECK(host.RunUntilIdle());
+    CHECK(HardwareTable(host) == ExpectedTable(queues));
+
+    return host.Registers().Writes(FIELD_OFFSET(RT_MAC, RssIndirectionTable), sizeof(RT_MAC::RssIndirectionTable));
+}
+
+static std::vector<IndirectionEntry>
+Move(std::vector<ULONG> const &queues, ULONG from, ULONG to)
+{
+    std::vector<IndirectionEntry> entries;
+
+    for (UINT32 index = 0; index < queues.size(); index++)
+    {
+        if (queues[index] == from)
+        {
+            entries.push_back({ index, to });
+        }
+    }
+
+    return entries;
+}
+
+int
+main()
+{
+    HostConfig config;
+    config.MessageCount = 4;
+    config.TrapMmio = true;
+    config.Keywords[L"*RSS"] = 1;
+
+    Host host(config);
+    CHECK(host.RunUntilIdle());
+    CHECK_EQ(host.RxQueueCount(), 4u);
+
+    // Round robin, as the host programmed it on start
+    std::vector<ULONG> queues(TableEntries);
+    for (UINT32 index = 0; index < TableEntries; index++)
+    {
+        queues[index] = index % 4;
+    }
+
+    CHECK(HardwareTable(host) == ExpectedTable(queues));
+
+    std::vector<ULONG> const start = queues;
+
+    printf("%-32s %6s %8s %12s\n", "pattern", "calls", "writes", "full writes");
+
+    auto run = [&](Pattern const &pattern)
+    {
+        ULONG64 const count = Apply(host, queues, pattern);
+        ULONG64 const full = pattern.Calls.size() * RT_INDIRECTION_TABLE_SIZE;
+
+        printf("%-32s %6zu %8llu %12llu\n", pattern.Name, pattern.Calls.size(),
+            (unsigned long long)count, (unsigned long long)full);
+
+        CHECK_EQ(count, pattern.ExpectedWrites);
+    };
+
+    {
+        // The stack restating the whole table
+        std::vector<IndirectionEntry> all;
+        for (UINT32 index = 0; index < TableEntries; index++)
+        {
+            all.push_back({ index, queues[index] });
+        }
+
+        run({ "unchanged table", { all }, 0 });
+    }
+
+    // A single flow to a queue differing in one bit, then in both
+    run({ "one entry, one plane", { { { 4, 1 } } }, 1 });
+    run({ "one entry, both planes", { { { 8, 3 } } }, 2 });
+
+    // Draining a queue onto its neighbour: 3 -> 2 clears plane 0 bits in
+    // every dword of the first half
+    run({ "drain queue 3 to queue 2", { Move(queues, 3, 2) }, RT_INDIRECTION_TABLE_SIZE / 2 });
+
+    // Moving the flows back a few per call, before the work item runs,
+    // costs no more than moving them in one call
+    {
+        std::vector<IndirectionEntry> back;
+        for (UINT32 index = 0; index < TableEntries; index++)
+        {
+            if (start[index] == 3)
+            {
+                back.push_back({ index, 3 });
+            }
+        }
+
+        Pattern pattern = { "restore queue 3, 4 per call", {}, RT_INDIRECTION_TABLE_SIZE / 2 };
+        for (size_t i = 0; i < back.size(); i += 4)
+        {
+            pattern.Calls.push_back(std::vector<IndirectionEntry>(back.begin() + i, back.begin() + min(i + 4, back.size())));
+        }
+
+        run(pattern);
+    }
+
+    // A few flows within one dword of queue 0 go to queue 1
+    {
+        std::vector<IndirectionEntry> entries;
+        for (UINT32 index = 32; index < 64; index++)
+        {
+            if (queues[index] == 0 && entries.size() < 6)
+            {
+                entries.push_back({ index, 1 });
+            }
+        }
+
+        run({ "6 flows in one dword, 0 to 1", { entries }, 1 });
+    }
+
+    // And a flow that moves away and back before the work item runs
+    run({ "move and move back", { { { 17, 2 } }, { { 17, queues[17] } } }, 0 });
+
+    CHECK(HardwareTable(host) == ExpectedTable(queues));
+
+    return CheckResult("indirection_test");
+}
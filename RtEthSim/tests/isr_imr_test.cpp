@@ -0,0 +1,282 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+// ISR and IMR accesses of the interrupt path, counted through the trapped
+// register window, against the driver's own skip counters. Before the
+// driver tracked the queues, every interrupt of the shared interrupt read
+// all four ISRs and wrote all four IMRs.
+
+#include "sim/host.h"
+
+#include "check.h"
+
+using namespace sim;
+
+struct QueueRegisters
+{
+    size_t Isr;
+    size_t Imr;
+    size_t Width;
+};
+
+static QueueRegisters const Registers[RT_NUMBER_OF_QUEUES] =
+{
+    { FIELD_OFFSET(RT_MAC, ISR0), FIELD_OFFSET(RT_MAC, IMR0), 2 },
+    { FIELD_OFFSET(RT_MAC, ISR1), FIELD_OFFSET(RT_MAC, IMR1), 1 },
+    { FIELD_OFFSET(RT_MAC, ISR2), FIELD_OFFSET(RT_MAC, IMR2), 1 },
+    { FIELD_OFFSET(RT_MAC, ISR3), FIELD_OFFSET(RT_MAC, IMR3), 1 },
+};
+
+struct InterruptCounters
+{
+    ULONG64 Interrupts;
+    ULONG64 Disabled;
+    ULONG64 IsrReadsSkipped;
+    ULONG64 ImrWritesSkipped;
+};
+
+static InterruptCounters
+Counters(RT_INTERRUPT const *interrupt)
+{
+    return {
+        interrupt->NumInterrupts,
+        interrupt->NumInterruptsDisabled,
+        interrupt->NumIsrReadsSkipped,
+        interrupt->NumImrWritesSkipped,
+    };
+}
+
+static UINT16
+RegisterValue(UINT32 value, size_t width)
+{
+    return width == 2 ? (UINT16)value : (UINT8)value;
+}
+
+// Every IMR write changes the register, every ISR write clears something
+static void
+CheckWriteLog(Host &host, UINT16 const (&imrBefore)[RT_NUMBER_OF_QUEUES])
+{
+    UINT16 imr[RT_NUMBER_OF_QUEUES];
+    memcpy(imr, imrBefore, sizeof(imr));
+
+    for (MmioWrite const &write : host.Registers().WriteLog())
+    {
+        for (ULONG queueId = 0; queueId < RT_NUMBER_OF_QUEUES; queueId++)
+        {
+            QueueRegisters const &registers = Registers[queueId];
+            UINT16 const value = RegisterValue(write.Value, registers.Width);
+
+            if (write.Offset == registers.Imr)
+            {
+                CHECK(value != imr[queueId]);
+                imr[queueId] = value;
+            }
+            else if (write.Offset == registers.Isr)
+            {
+                CHECK(value != 0);
+            }
+        }
+    }
+}
+
+template <typename Traffic>
+static void
+RunScenario(char const *name, ULONG messageCount, Traffic traffic)
+{
+    HostConfig config;
+    config.MessageCount = messageCount;
+    config.TrapMmio = true;
+    config.Keywords[L"*RSS"] = 1;
+
+    Host host(config);
+    CHECK(host.RunUntilIdle());
+    CHECK_EQ(host.RxQueueCount(), (size_t)RT_NUMBER_OF_QUEUES);
+
+    RT_ADAPTER const *adapter = host.Adapter();
+    bool const perQueue = adapter->RxInterrupt[0] != adapter->RxInterrupt[1];
+    CHECK_EQ(perQueue, messageCount >= RT_NUMBER_OF_QUEUES);
+
+    InterruptCounters before[RT_NUMBER_OF_QUEUES];
+    UINT16 imrBefore[RT_NUMBER_OF_QUEUES];
+    RT_MAC const *mac = host.Device().Registers();
+
+    for (ULONG queueId = 0; queueId < RT_NUMBER_OF_QUEUES; queueId++)
+    {
+        before[queueId] = Counters(adapter->RxInterrupt[queueId]);
+        imrBefore[queueId] = queueId == 0 ? mac->IMR0 : queueId == 1 ? mac->IMR1 : queueId == 2 ? mac->IMR2 : mac->IMR3;
+    }
+
+    host.Registers().ResetCounts();
+
+    traffic(host);
+    CHECK(host.RunUntilIdle());
+
+    Mmio const &mmio = host.Registers();
+    ULONG64 isrReads[RT_NUMBER_OF_QUEUES];
+    ULONG64 isrWrites = 0;
+    ULONG64 imrWrites = 0;
+    ULONG64 otherImrWrites = 0;
+    InterruptCounters delta[RT_NUMBER_OF_QUEUES];
+
+    for (ULONG queueId = 0; queueId < RT_NUMBER_OF_QUEUES; queueId++)
+    {
+        QueueRegisters const &registers = Registers[queueId];
+        InterruptCounters const after = Counters(adapter->RxInterrupt[queueId]);
+
+        // Only the ISRs touch the ISRs; the IMRs are also written when a
+        // queue arms or disarms its notification
+        CHECK_EQ(mmio.IsrReads(registers.Isr), mmio.Reads(registers.Isr));
+        CHECK_EQ(mmio.IsrWrites(registers.Isr), mmio.Writes(registers.Isr));
+
+        isrReads[queueId] = mmio.IsrReads(registers.Isr);
+        isrWrites += mmio.IsrWrites(registers.Isr);
+        imrWrites += mmio.IsrWrites(registers.Imr);
+        otherImrWrites += mmio.Writes(registers.Imr) - mmio.IsrWrites(registers.Imr);
+
+        delta[queueId] = {
+            after.Interrupts - before[queueId].Interrupts,
+            after.Disabled - before[queueId].Disabled,
+            after.IsrReadsSkipped - before[queueId].IsrReadsSkipped,
+            after.ImrWritesSkipped - before[queueId].ImrWritesSkipped,
+        };
+    }
+
+    CheckWriteLog(host, imrBefore);
+
+    ULONG64 interrupts = 0;
+    ULONG64 isrReadsSkipped = 0;
+    ULONG64 imrWritesSkipped = 0;
+    ULONG const interruptCount = perQueue ? RT_NUMBER_OF_QUEUES : 1;
+
+    for (ULONG i = 0; i < interruptCount; i++)
+    {
+        interrupts += delta[i].Interrupts;
+        isrReadsSkipped += delta[i].IsrReadsSkipped;
+        imrWritesSkipped += delta[i].ImrWritesSkipped;
+    }
+
+    CHECK(interrupts > 0);
+
+    ULONG64 const reads = isrReads[0] + isrReads[1] + isrReads[2] + isrReads[3];
+
+    if (perQueue)
+    {
+        // Each interrupt reads its own ISR, or counts why it did not
+        for (ULONG queueId = 0; queueId < RT_NUMBER_OF_QUEUES; queueId++)
+        {
+            CHECK_EQ(isrReads[queueId] + delta[queueId].IsrReadsSkipped, delta[queueId].Interrupts);
+        }
+    }
+    else
+    {
+        // ISR0 on every interrupt, ISR1-3 unless the hardware was inactive
+        // or the queue was not armed
+        ULONG64 const active = delta[0].Interrupts - delta[0].Disabled;
+        CHECK_EQ(isrReads[0], delta[0].Interrupts);
+        CHECK_EQ(isrReads[1] + isrReads[2] + isrReads[3] + delta[0].IsrReadsSkipped, 3 * active);
+
+        // Fewer than reading every ISR and writing every IMR
+        CHECK(reads + imrWrites < 8 * interrupts);
+    }
+
+    printf("%-26s %7s %10llu %7.2f %7.2f %7.2f %9llu %11llu %11llu\n",
+        name, perQueue ? "queue" : "shared",
+        (unsigned long long)interrupts,
+        (double)reads / interrupts,
+        (double)isrWrites / interrupts,
+        (double)imrWrites / interrupts,
+        (unsigned long long)otherImrWrites,
+        (unsigned long long)isrReadsSkipped,
+        (unsigned long long)imrWritesSkipped);
+}
+
+static RxFrame
+Frame(UCHAR const *destination)
+{
+    RxFrame frame;
+    frame.Data.assign(128, 0);
+    memcpy(frame.Data.data(), destination, ETH_LENGTH_OF_ADDRESS);
+    return frame;
+}
+
+static UCHAR const Station[ETH_LENGTH_OF_ADDRESS] = { 0x00, 0xe0, 0x4c, 0x68, 0x00, 0x01 };
+
+int
+main()
+{
+    // Per interrupt: ISR reads and acknowledgments, and IMR writes from
+    // the ISR. Before, the shared interrupt made 4 reads and 4 IMR writes.
+    printf("%-26s %7s %10s %7s %7s %7s %9s %11s %11s\n",
+        "traffic", "mode", "interrupts", "isr rd", "isr wr", "imr wr",
+        "arm imr", "isr skipped", "imr skipped");
+
+    // Only queue 0 sees traffic; the other queues stay armed and idle, and
+    // nothing rewrites their IMRs
+    auto const queue0 = [](Host &host)
+    {
+        for (int i = 0; i < 200; i++)
+        {
+            host.Receive(Frame(Station), 0);
+            host.Run(50 * 10);
+        }
+
+        CHECK_EQ(host.Registers().Writes(FIELD_OFFSET(RT_MAC, IMR1)), 0u);
+        CHECK_EQ(host.Registers().Writes(FIELD_OFFSET(RT_MAC, IMR2)), 0u);
+        CHECK_EQ(host.Registers().Writes(FIELD_OFFSET(RT_MAC, IMR3)), 0u);
+    };
+
+    // Queues 1-3 are flooded and keep polling, with their IMRs clear,
+    // while queue 0 takes an interrupt for each of its frames
+    auto const flood = [](Host &host)
+    {
+        for (int i = 0; i < 4000; i++)
+        {
+            if (i % 50 == 0)
+            {
+                host.Receive(Frame(Station), 0);
+            }
+
+            for (ULONG queueId = 1; queueId < RT_NUMBER_OF_QUEUES; queueId++)
+            {
+                host.Receive(Frame(Station), queueId);
+            }
+
+            host.Run(10);
+        }
+    };
+
+    // Transmit completions only
+    auto const transmit = [](Host &host)
+    {
+        UCHAR const peer[ETH_LENGTH_OF_ADDRESS] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+        TxPacket packet;
+        packet.Data.assign(128, 0);
+        memcpy(packet.Data.data(), peer, ETH_LENGTH_OF_ADDRESS);
+        packet.Layout.Layer2Type = NetPacketLayer2TypeEthernet;
+        packet.Layout.Layer2HeaderLength = ETH_LENGTH_OF_HEADER;
+
+        for (int i = 0; i < 300; i++)
+        {
+            CHECK(host.Send(packet));
+            host.Run(20 * 10);
+        }
+    };
+
+    RunScenario("receive, queue 0 only", 1, queue0);
+    RunScenario("receive, 1-3 flooded", 1, flood);
+    RunScenario("transmit", 1, transmit);
+    RunScenario("receive, queue 0 only", 4, queue0);
+    RunScenario("receive, 1-3 flooded", 4, flood);
+    RunScenario("transmit", 4, transmit);
+
+    return CheckResult("isr_imr_test");
+}
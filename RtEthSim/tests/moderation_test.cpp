@@ -0,0 +1,180 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+// Receive load in steps, from request/response to line rate and back,
+// under each interrupt moderation setting. Prints the interrupt rate and
+// the mean frame latency of every step, and checks that the adaptive
+// level follows the load: no delay when light, as much as Low when heavy,
+// and back to no delay as soon as the load falls off.
+
+#include <deque>
+
+#include "sim/host.h"
+
+#include "check.h"
+
+using namespace sim;
+
+struct LoadStep
+{
+    char const *Name;
+    // Frames per millisecond
+    ULONG Rate;
+    size_t FrameSize;
+};
+
+static LoadStep const Steps[] =
+{
+    { "light", 1, 64 },
+    { "medium", 30, 1514 },
+    { "bulk", 80, 1514 },
+    { "small flood", 1000, 64 },
+    { "light again", 1, 64 },
+};
+
+// Each step lasts 20ms, in 100ns units
+static ULONG64 const StepTime = 20 * 10000;
+
+static ULONG64 const RoundTime = 10;
+
+struct StepResult
+{
+    double InterruptsPerSecond;
+    // Mean from arrival to indication, in microseconds
+    double Latency;
+    ULONG Profile;
+};
+
+struct Setting
+{
+    char const *Name;
+    ULONG Mode;
+    ULONG Level;
+};
+
+static Setting const Settings[] =
+{
+    { "disabled", RtInterruptModerationDisabled, RtInterruptModerationLow },
+    { "low", RtInterruptModerationEnabled, RtInterruptModerationLow },
+    { "medium", RtInterruptModerationEnabled, RtInterruptModerationMedium },
+    { "adaptive", RtInterruptModerationEnabled, RtInterruptModerationAdaptive },
+};
+
+static std::vector<StepResult>
+RunSteps(Setting const &setting)
+{
+    HostConfig config;
+    config.Keywords[L"*InterruptModeration"] = setting.Mode;
+    config.Keywords[L"InterruptModerationLevel"] = setting.Level;
+
+    Host host(config);
+    CHECK(host.RunUntilIdle());
+    host.Device().CaptureTransmitted = false;
+
+    std::vector<StepResult> results;
+    std::deque<ULONG64> arrivals;
+    ULONG64 frames = 0;
+
+    for (LoadStep const &step : Steps)
+    {
+        RxFrame frame;
+        frame.Data.assign(step.FrameSize, 0);
+        memcpy(frame.Data.data(), config.MacAddress, ETH_LENGTH_OF_ADDRESS);
+
+        ULONG64 const period = 10000 / step.Rate;
+        ULONG64 const start = host.Now();
+        size_t const firstInterrupt = host.Device().Interrupts.size();
+
+        ULONG64 latency = 0;
+        ULONG64 indicated = 0;
+        ULONG64 next = start;
+
+        // Frames arrive at a steady rate; a frame's latency runs from its
+        // arrival to its indication, to within 1us
+        while (host.Now() - start < StepTime || ! arrivals.empty())
+        {
+            if (host.Now() >= next && host.Now() - start < StepTime)
+            {
+                host.Receive(frame);
+                arrivals.push_back(host.Now());
+                frames++;
+                next += period;
+            }
+
+            host.Run(RoundTime);
+
+            size_t const received = host.TakeReceived().size();
+            for (size_t i = 0; i < received && ! arrivals.empty(); i++)
+            {
+                latency += host.Now() - arrivals.front();
+                arrivals.pop_front();
+                indicated++;
+            }
+        }
+
+        size_t const count = host.Device().Interrupts.size() - firstInterrupt;
+
+        StepResult result;
+        result.InterruptsPerSecond = count * 1e7 / (host.Now() - start);
+        result.Latency = indicated != 0 ? latency / 10.0 / indicated : 0;
+        result.Profile = host.Adapter()->AdaptiveModeration.Profile;
+        results.push_back(result);
+    }
+
+    CHECK(host.RunUntilIdle());
+    CHECK_EQ(host.Counters.RxPacketsIndicated, frames);
+    CHECK_EQ(host.Device().MissedFrames, 0u);
+
+    return results;
+}
+
+int
+main()
+{
+    std::vector<StepResult> results[ARRAYSIZE(Settings)];
+
+    printf("%-10s %-12s %12s %12s %8s\n", "setting", "step", "interrupts/s", "latency us", "profile");
+
+    for (size_t s = 0; s < ARRAYSIZE(Settings); s++)
+    {
+        results[s] = RunSteps(Settings[s]);
+
+        for (size_t i = 0; i < ARRAYSIZE(Steps); i++)
+        {
+            printf("%-10s %-12s %12.0f %12.1f %8lu\n",
+                Settings[s].Name, Steps[i].Name,
+                results[s][i].InterruptsPerSecond, results[s][i].Latency,
+                (unsigned long)results[s][i].Profile);
+        }
+    }
+
+    std::vector<StepResult> const &disabled = results[0];
+    std::vector<StepResult> const &low = results[1];
+    std::vector<StepResult> const &adaptive = results[3];
+
+    // Light load: no delay added, where Low holds every frame ~500us
+    CHECK_EQ(adaptive[0].Profile, 0u);
+    CHECK(adaptive[0].Latency < 20);
+    CHECK(adaptive[0].Latency * 10 < low[0].Latency);
+
+    // The profile follows the load up, to the top one at line rate, with
+    // far fewer interrupts than without moderation
+    CHECK(adaptive[1].Profile > adaptive[0].Profile);
+    CHECK_EQ(adaptive[2].Profile, 4u);
+    CHECK(adaptive[2].InterruptsPerSecond * 4 < disabled[2].InterruptsPerSecond);
+    CHECK(adaptive[2].InterruptsPerSecond < low[2].InterruptsPerSecond * 2);
+
+    // And back down within a few frames once the load falls off
+    CHECK_EQ(adaptive[4].Profile, 0u);
+    CHECK(adaptive[4].Latency * 4 < low[4].Latency);
+
+    return CheckResult("moderation_test");
+}
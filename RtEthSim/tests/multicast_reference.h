@@ -0,0 +1,48 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+#pragma once
+
+// The multicast hash as RtEthSample computed it before the CRC became
+// table driven, a bit at a time.
+
+inline ULONG
+ReferenceComputeCrc(UCHAR const *buffer, UINT length)
+{
+    ULONG crc = 0xffffffff;
+
+    for (UINT i = 0; i < length; i++)
+    {
+        UCHAR curByte = buffer[i];
+
+        for (UINT j = 0; j < 8; j++)
+        {
+            ULONG carry = ((crc & 0x80000000) ? 1 : 0) ^ (curByte & 0x01);
+            crc <<= 1;
+            curByte >>= 1;
+
+            if (carry)
+            {
+                crc = (crc ^ 0x04c11db6) | carry;
+            }
+        }
+    }
+
+    return crc;
+}
+
+inline UCHAR
+ReferenceMulticastBit(UCHAR const *address)
+{
+    ULONG crc = ReferenceComputeCrc(address, ETH_LENGTH_OF_ADDRESS);
+
+    return (UCHAR)((crc >> 26) & 0x3f);
+}
@@ -0,0 +1,182 @@
+/*++
+
+    THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+    ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+    THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    Copyright (c) Microsoft Corporation. All rights reserved
+
+--*/
+
+// The table driven multicast hash against the bit at a time CRC it
+// replaced, and the multicast registers the driver programs as the list
+// churns.
+
+#include <random>
+
+#include "sim/host.h"
+
+#include "check.h"
+
+#include "multicast_reference.h"
+
+using namespace sim;
+
+UCHAR
+GetMulticastBit(
+    _In_reads_bytes_(ETH_LENGTH_OF_ADDRESS) UCHAR const *address
+    );
+
+static void
+CheckMulticastBit(UCHAR const *address)
+{
+    UCHAR const actual = GetMulticastBit(address);
+    UCHAR const expected = ReferenceMulticastBit(address);
+
+    if (actual != expected)
+    {
+        fprintf(stderr, "%02x-%02x-%02x-%02x-%02x-%02x: bit %u, expected %u\n",
+            address[0], address[1], address[2], address[3], address[4], address[5],
+            actual, expected);
+    }
+
+    CHECK_EQ(actual, expected);
+}
+
+static void
+TestMulticastBit()
+{
+    UCHAR address[ETH_LENGTH_OF_ADDRESS] = {};
+    CheckMulticastBit(address);
+
+    // Every single bit, and every byte value in every position
+    for (UINT bit = 0; bit < ETH_LENGTH_OF_ADDRESS * 8; bit++)
+    {
+        memset(address, 0, sizeof(address));
+        address[bit / 8] = (UCHAR)(1 << (bit % 8));
+        CheckMulticastBit(address);
+    }
+
+    for (UINT position = 0; position < ETH_LENGTH_OF_ADDRESS; position++)
+    {
+        for (UINT value = 0; value < 256; value++)
+        {
+            memset(address, 0xa5, sizeof(address));
+            address[position] = (UCHAR)value;
+            CheckMulticastBit(address);
+        }
+    }
+
+    // IPv4 and IPv6 multicast ranges, then anything
+    std::mt19937 random(8168);
+
+    for (UINT i = 0; i < 100000; i++)
+    {
+        UINT32 const value = random();
+        UCHAR const ipv4[ETH_LENGTH_OF_ADDRESS] =
+            { 0x01, 0x00, 0x5e, (UCHAR)((value >> 16) & 0x7f), (UCHAR)(value >> 8), (UCHAR)value };
+        UCHAR const ipv6[ETH_LENGTH_OF_ADDRESS] =
+            { 0x33, 0x33, (UCHAR)(value >> 24), (UCHAR)(value >> 16), (UCHAR)(value >> 8), (UCHAR)value };
+
+        CheckMulticastBit(ipv4);
+        CheckMulticastBit(ipv6);
+
+        for (UCHAR &byte : address)
+        {
+            byte = (UCHAR)random();
+        }
+
+        CheckMulticastBit(address);
+    }
+}
+
+// The registers the driver should program for a list, MAR0 first
+static std::vector<UCHAR>
+ExpectedRegisters(std::vector<std::vector<UCHAR>> const &addresses)
+{
+    std::vector<UCHAR> registers(MAX_NIC_MULTICAST_REG);
+
+    for (std::vector<UCHAR> const &address : addresses)
+    {
+        UCHAR const bit = ReferenceMulticastBit(address.data());
+        registers[bit / 8] |= (UCHAR)(1 << (bit % 8));
+    }
+
+    return registers;
+}
+
+static std::vector<UCHAR>
+ProgrammedRegisters(Host &host)
+{
+    RT_MAC const *mac = host.Device().Registers();
+
+    return {
+        mac->MulticastReg0, mac->MulticastReg1, mac->MulticastReg2, mac->MulticastReg3,
+        mac->MulticastReg4, mac->MulticastReg5, mac->MulticastReg6, mac->MulticastReg7,
+    };
+}
+
+static std::vector<UCHAR>
+GroupAddress(UINT32 group)
+{
+    return { 0x01, 0x00, 0x5e, (UCHAR)((group >> 16) & 0x7f), (UCHAR)(group >> 8), (UCHAR)group };
+}
+
+static void
+TestMulticastRegisters()
+{
+    HostConfig config;
+    Host host(config);
+    CHECK(host.RunUntilIdle());
+
+    std::vector<std::vector<UCHAR>> list;
+    for (UINT32 group = 1; group <= 40; group++)
+    {
+        list.push_back(GroupAddress(group * 7919));
+    }
+
+    host.SetMulticastList(list);
+    CHECK(ProgrammedRegisters(host) == ExpectedRegisters(list));
+
+    // Joins and leaves, a few at a time, as a feed handler would
+    std::mt19937 random(1);
+
+    for (UINT round = 0; round < 200; round++)
+    {
+        for (UINT i = 0; i < 3 && ! list.empty(); i++)
+        {
+            list.erase(list.begin() + random() % list.size());
+        }
+
+        for (UINT i = 0; i < 3; i++)
+        {
+            list.push_back(GroupAddress(random()));
+        }
+
+        host.SetMulticastList(list);
+        CHECK(ProgrammedRegisters(host) == ExpectedRegisters(list));
+    }
+
+    host.SetMulticastList({});
+    CHECK(ProgrammedRegisters(host) == std::vector<UCHAR>(MAX_NIC_MULTICAST_REG, 0));
+
+    // More than the driver tracks: receive all multicast
+    list.clear();
+    for (UINT32 group = 0; group <= RT_MAX_MCAST_LIST; group++)
+    {
+        list.push_back(GroupAddress(group));
+    }
+
+    host.SetMulticastList(list);
+    CHECK(ProgrammedRegisters(host) == std::vector<UCHAR>(MAX_NIC_MULTICAST_REG, 0xff));
+}
+
+int
+main()
+{
+    TestMulticastBit();
+    TestMulticastRegisters();
+
+    return CheckResult("multicast_test");
+}